@@ -67,6 +67,7 @@ typedef struct
 static bool              m_is_tx_allocated;                         /**< Boolean value to determine if the TX buffer is allocated. */
 static rx_buffer_elem_t  m_rx_buffer_elem_queue[HCI_RX_BUF_QUEUE_SIZE] __ALIGN(4); /**< RX buffer element instances. */
 static rx_buffer_queue_t m_rx_buffer_queue;                         /**< RX buffer queue element instance. */
+static uint32_t          m_rx_buffer_peak;                          /**< Maximum number of RX buffer elements in use at once. */
 
 
 uint32_t hci_mem_pool_open(void)
@@ -141,6 +142,11 @@ uint32_t hci_mem_pool_rx_produce(uint32_t length, void ** pp_buffer)
             --(m_rx_buffer_queue.free_window_count);
             ++(m_rx_buffer_queue.read_available_count);
 
+            if (HCI_RX_BUF_QUEUE_SIZE - m_rx_buffer_queue.free_window_count > m_rx_buffer_peak)
+            {
+                m_rx_buffer_peak = HCI_RX_BUF_QUEUE_SIZE - m_rx_buffer_queue.free_window_count;
+            }
+
             *pp_buffer                    =
                     m_rx_buffer_queue.p_buffer[m_rx_buffer_queue.write_index].rx_buffer;
 
@@ -215,6 +221,12 @@ uint32_t hci_mem_pool_rx_consume(uint8_t * p_buffer)
 }
 
 
+uint32_t hci_mem_pool_rx_peak_get(void)
+{
+    return m_rx_buffer_peak;
+}
+
+
 uint32_t hci_mem_pool_rx_data_size_set(uint32_t length)
 {
     // @note: Adjust the write_index making use of the fact that the buffer size is of power
@@ -158,6 +158,12 @@ uint32_t hci_mem_pool_rx_extract(uint8_t ** pp_buffer, uint32_t * p_length);
  */
 uint32_t hci_mem_pool_rx_consume(uint8_t * p_buffer);
 
+/**@brief Function for getting the maximum number of RX memory blocks in use at once since open.
+ *
+ * @return Peak of RX memory blocks produced and not yet consumed, up to HCI_RX_BUF_QUEUE_SIZE.
+ */
+uint32_t hci_mem_pool_rx_peak_get(void);
+
 
 #ifdef __cplusplus
 }
@@ -293,6 +293,12 @@ uint32_t pstorage_clear(pstorage_handle_t * p_base_id, pstorage_size_t size);
  */
 uint32_t pstorage_access_status_get(uint32_t * p_count);
 
+/**@brief Function for getting the maximum number of operations queued at once since init.
+ *
+ * @return     Peak of pending storage operations, up to PSTORAGE_CMD_QUEUE_SIZE.
+ */
+uint32_t pstorage_queue_peak_get(void);
+
 #ifdef PSTORAGE_RAW_MODE_ENABLE
 
 /**@brief Function for registering with the persistent storage interface.
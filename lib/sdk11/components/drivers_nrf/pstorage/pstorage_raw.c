@@ -94,6 +94,7 @@ typedef struct
 }cmd_queue_t;
 
 static cmd_queue_t             m_cmd_queue;                             /**< Flash operation request queue. */
+static uint8_t                 m_cmd_queue_peak;                        /**< Maximum number of elements in the queue since init. */
 static pstorage_module_table_t m_app_table[PSTORAGE_NUM_OF_PAGES];      /**< Registered application information table. */
 static pstorage_size_t         m_next_app_instance;                     /**< Points to the application module instance that can be allocated next */
 static pstorage_size_t         m_round_val;                             /**< Round value for multiple round operations. For erase operations, the round value will contain current round counter which is identical to number of pages erased. For store operations, the round value contains current round of operation * SOC_MAX_WRITE_SIZE to ensure each store to the SoC Flash API is within the SoC limit. */
@@ -207,6 +208,11 @@ static uint32_t cmd_queue_enqueue(uint8_t             opcode,
             }
         }
         m_cmd_queue.count++;
+
+        if (m_cmd_queue.count > m_cmd_queue_peak)
+        {
+            m_cmd_queue_peak = m_cmd_queue.count;
+        }
     }
     else
     {
@@ -466,6 +472,12 @@ uint32_t pstorage_clear(pstorage_handle_t * p_dest, pstorage_size_t size)
 }
 
 
+uint32_t pstorage_queue_peak_get(void)
+{
+    return m_cmd_queue_peak;
+}
+
+
 /**
  * @}
  */
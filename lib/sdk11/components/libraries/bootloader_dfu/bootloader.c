@@ -31,6 +31,10 @@
 #include "app_timer.h"
 
 #include "boards.h"
+#include "flash_nrf5x.h"
+#include "flash_wear.h"
+#include "sha256.h"
+#include "usb/uf2/uf2cfg.h"
 
 #ifdef NRF_USBD
 #include "tusb.h"
@@ -66,8 +70,9 @@ static void pstorage_callback_handler(pstorage_handle_t * p_handle,
                                       uint32_t            data_len)
 {
     // If we are in BOOTLOADER_SETTINGS_SAVING state and we receive an PSTORAGE_STORE_OP_CODE
-    // response then settings has been saved and update has completed.
-    if ((m_update_status == BOOTLOADER_SETTINGS_SAVING) && (op_code == PSTORAGE_STORE_OP_CODE))
+    // response for the flash erase counters, stored last, then settings has been saved and update has completed.
+    if ((m_update_status == BOOTLOADER_SETTINGS_SAVING) && (op_code == PSTORAGE_STORE_OP_CODE) &&
+        (p_data == (uint8_t const *) flash_wear_get()))
     {
         m_update_status = BOOTLOADER_COMPLETE;
     }
@@ -89,7 +94,8 @@ static void dfu_startup_timer_handler(void * p_context)
 
   // nRF52832 forced DFU on startup
   // No packets are received within timeout, exit DFU mode
-  // dfu_startup_packet_received is set by process_dfu_packet() in dfu_transport_serial.c
+  // dfu_startup_packet_received is set by process_dfu_packet() in dfu_transport_serial.c and
+  // by a BLE connection in dfu_transport_ble.c
   if (!dfu_startup_packet_received)
   {
     dfu_update_status_t update_status;
@@ -176,28 +182,93 @@ bool bootloader_app_is_valid(void)
     }
 
     success = (image_crc == p_bootloader_settings->bank_0_crc);
+
+#if BOOT_VERIFY_APP_SHA256
+    if ( success && (p_bootloader_settings->bank_0_digest == BANK_DIGEST_SHA256) )
+    {
+      uint8_t digest[SHA256_DIGEST_SIZE];
+
+#ifdef CFG_DEBUG
+      // cycle counter to report the cost of verification on boot path
+      CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+      DWT->CYCCNT = 0;
+      DWT->CTRL  |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+      sha256_compute((void const*) app_addr, p_bootloader_settings->bank_0_size, digest);
+      success = sha256_equal(digest, p_bootloader_settings->bank_0_sha256);
+
+#ifdef CFG_DEBUG
+      uint32_t const us = DWT->CYCCNT / (SystemCoreClock / 1000000);
+      PRINTF("SHA-256 of %lu bytes in %lu us (%lu KB/s)\r\n", p_bootloader_settings->bank_0_size, us,
+             us ? (p_bootloader_settings->bank_0_size / 1024) * 1000000UL / us : 0);
+#endif
+    }
+#endif
+
+#ifdef ENABLE_QSPI_XIP_APP
+    // Part of the application executing in place from QSPI must be intact as well.
+    // Out of range size (e.g settings written by an older bootloader) means there is none.
+    uint32_t const xip_size = p_bootloader_settings->xip_image_size;
+
+    if ( success && (xip_size != 0) && (xip_size <= QSPI_XIP_APP_SIZE) )
+    {
+      success = (flash_nrf5x_qspi_crc16(QSPI_XIP_APP_OFFSET, xip_size) == p_bootloader_settings->xip_image_crc);
+      if ( !success ) PRINTF("XIP image is corrupted\r\n");
+    }
+#endif
   }
 
   return success;
 }
 
 
+STATIC_ASSERT(sizeof(bootloader_settings_t) <= FLASH_WEAR_OFFSET);
+STATIC_ASSERT(FLASH_WEAR_OFFSET + sizeof(flash_wear_t) <= CODE_PAGE_SIZE);
+STATIC_ASSERT((sizeof(bootloader_settings_t) % 4 == 0) && (sizeof(flash_wear_t) % 4 == 0));
+
 static void bootloader_settings_save(bootloader_settings_t * p_settings)
 {
+  // Settings and flash erase counters share the page, both are programmed again after the erase
+  // straight from where they are kept (caller's static and flash_wear.c). Counters go last, their
+  // store completes the save, see pstorage_callback_handler()
+  uint8_t * p_wear = (uint8_t *) flash_wear_get();
+
+  flash_wear_erased(BOOTLOADER_SETTINGS_ADDRESS, CODE_PAGE_SIZE);
+
   if ( is_ota() )
   {
-    uint32_t err_code = pstorage_clear(&m_bootsettings_handle, sizeof(bootloader_settings_t));
+    uint32_t err_code = pstorage_clear(&m_bootsettings_handle, FLASH_WEAR_OFFSET + sizeof(flash_wear_t));
     APP_ERROR_CHECK(err_code);
 
     err_code = pstorage_store(&m_bootsettings_handle, (uint8_t *) p_settings, sizeof(bootloader_settings_t), 0);
     APP_ERROR_CHECK(err_code);
+
+    err_code = pstorage_store(&m_bootsettings_handle, p_wear, sizeof(flash_wear_t), FLASH_WEAR_OFFSET);
+    APP_ERROR_CHECK(err_code);
   }
   else
   {
     nrfx_nvmc_page_erase(BOOTLOADER_SETTINGS_ADDRESS);
-    nrfx_nvmc_words_write(BOOTLOADER_SETTINGS_ADDRESS, (uint32_t *) p_settings, sizeof(bootloader_settings_t) / 4);
+    nrfx_nvmc_words_write(BOOTLOADER_SETTINGS_ADDRESS, p_settings, sizeof(bootloader_settings_t) / 4);
+    nrfx_nvmc_words_write(BOOTLOADER_SETTINGS_ADDRESS + FLASH_WEAR_OFFSET, p_wear, sizeof(flash_wear_t) / 4);
 
-    pstorage_callback_handler(&m_bootsettings_handle, PSTORAGE_STORE_OP_CODE, NRF_SUCCESS, (uint8_t *) p_settings, sizeof(bootloader_settings_t));
+    pstorage_callback_handler(&m_bootsettings_handle, PSTORAGE_STORE_OP_CODE, NRF_SUCCESS, p_wear, sizeof(flash_wear_t));
+  }
+}
+
+
+/**@brief Function for recording the pages a staged commit copies, all of them if p_pages is NULL.
+ */
+static void bootloader_staged_pages_set(uint8_t * p_dst, uint8_t const * p_pages)
+{
+  if ( p_pages )
+  {
+    memcpy(p_dst, p_pages, BOOTLOADER_STAGED_PAGES_MAX / 8);
+  }
+  else
+  {
+    memset(p_dst, 0xFF, BOOTLOADER_STAGED_PAGES_MAX / 8);
   }
 }
 
@@ -216,19 +287,91 @@ void bootloader_dfu_update_process(dfu_update_status_t update_status)
     settings.bank_0      = BANK_VALID_APP;
     settings.bank_1      = BANK_INVALID_APP;
 
+    if ( update_status.p_app_sha256 )
+    {
+      settings.bank_0_digest = BANK_DIGEST_SHA256;
+      memcpy(settings.bank_0_sha256, update_status.p_app_sha256, sizeof(settings.bank_0_sha256));
+    }
+    else
+    {
+      settings.bank_0_digest = BANK_DIGEST_NONE;
+    }
+
+    settings.staged_image_start = 0;
+    settings.staged_image_size  = 0;
+    settings.staged_image_crc   = 0;
+    memset(settings.staged_pages, 0, sizeof(settings.staged_pages));
+    settings.xip_image_size     = update_status.xip_size;
+    settings.xip_image_crc      = update_status.xip_crc;
+
     m_update_status      = BOOTLOADER_SETTINGS_SAVING;
     bootloader_settings_save(&settings);
   }
+  else if (update_status.status_code == DFU_UPDATE_APP_STAGED)
+  {
+    // Bank 0 is invalidated up front: it is about to be overwritten by the commit on next boot.
+    // Digest of bank 0 once committed is recorded along, the commit keeps it.
+    settings.bank_0_crc         = 0;
+    settings.bank_0             = BANK_INVALID_APP;
+    settings.bank_1             = BANK_VALID_STAGED_APP;
+
+    if ( update_status.p_app_sha256 )
+    {
+      settings.bank_0_size   = update_status.app_digest_size;
+      settings.bank_0_digest = BANK_DIGEST_SHA256;
+      memcpy(settings.bank_0_sha256, update_status.p_app_sha256, sizeof(settings.bank_0_sha256));
+    }
+    else
+    {
+      settings.bank_0_size   = 0;
+      settings.bank_0_digest = BANK_DIGEST_NONE;
+    }
+
+    settings.staged_image_start = update_status.app_image_start;
+    settings.staged_image_size  = update_status.app_size;
+    settings.staged_image_crc   = update_status.app_crc;
+    bootloader_staged_pages_set(settings.staged_pages, update_status.p_staged_pages);
+    settings.xip_image_size     = update_status.xip_size;
+    settings.xip_image_crc      = update_status.xip_crc;
+
+    m_update_status             = BOOTLOADER_SETTINGS_SAVING;
+    bootloader_settings_save(&settings);
+  }
+  else if (update_status.status_code == DFU_UPDATE_APP_BACKED_UP)
+  {
+    // Pages of bank 0 are about to be borrowed by a bootloader update. Its record is kept for the
+    // staged commit to restore, but no bootloader (including one without the commit) may start it
+    // in the meantime.
+    settings.bank_0             = (p_bootloader_settings->bank_0 == BANK_VALID_APP) ? BANK_BACKED_UP_APP : p_bootloader_settings->bank_0;
+    settings.bank_0_crc         = p_bootloader_settings->bank_0_crc;
+    settings.bank_0_size        = p_bootloader_settings->bank_0_size;
+    settings.bank_0_digest      = p_bootloader_settings->bank_0_digest;
+    memcpy(settings.bank_0_sha256, p_bootloader_settings->bank_0_sha256, sizeof(settings.bank_0_sha256));
+    settings.xip_image_size     = p_bootloader_settings->xip_image_size;
+    settings.xip_image_crc      = p_bootloader_settings->xip_image_crc;
+    settings.bank_1             = BANK_VALID_STAGED_APP;
+    settings.staged_image_start = update_status.app_image_start;
+    settings.staged_image_size  = update_status.app_size;
+    settings.staged_image_crc   = update_status.app_crc;
+    bootloader_staged_pages_set(settings.staged_pages, update_status.p_staged_pages);
+
+    m_update_status             = BOOTLOADER_SETTINGS_SAVING;
+    bootloader_settings_save(&settings);
+  }
   else if (update_status.status_code == DFU_UPDATE_SD_COMPLETE)
   {
     settings.bank_0_crc     = update_status.app_crc;
     settings.bank_0_size    = update_status.sd_size + update_status.bl_size + update_status.app_size;
     settings.bank_0         = BANK_VALID_SD;
+    settings.bank_0_digest  = BANK_DIGEST_NONE;
     settings.bank_1         = BANK_INVALID_APP;
     settings.sd_image_size  = update_status.sd_size;
     settings.bl_image_size  = update_status.bl_size;
     settings.app_image_size = update_status.app_size;
     settings.sd_image_start = update_status.sd_image_start;
+    settings.sd_swap_next   = 0;
+    settings.xip_image_size = 0;
+    settings.xip_image_crc  = 0;
 
     m_update_status         = BOOTLOADER_SETTINGS_SAVING;
     bootloader_settings_save(&settings);
@@ -238,6 +381,10 @@ void bootloader_dfu_update_process(dfu_update_status_t update_status)
     settings.bank_0         = p_bootloader_settings->bank_0;
     settings.bank_0_crc     = p_bootloader_settings->bank_0_crc;
     settings.bank_0_size    = p_bootloader_settings->bank_0_size;
+    settings.bank_0_digest  = p_bootloader_settings->bank_0_digest;
+    memcpy(settings.bank_0_sha256, p_bootloader_settings->bank_0_sha256, sizeof(settings.bank_0_sha256));
+    settings.xip_image_size = p_bootloader_settings->xip_image_size;
+    settings.xip_image_crc  = p_bootloader_settings->xip_image_crc;
     settings.bank_1         = BANK_VALID_BOOT;
     settings.sd_image_size  = update_status.sd_size;
     settings.bl_image_size  = update_status.bl_size;
@@ -253,6 +400,9 @@ void bootloader_dfu_update_process(dfu_update_status_t update_status)
       settings.bank_0_crc     = 0;
       settings.bank_0_size    = 0;
       settings.bank_0         = BANK_INVALID_APP;
+      settings.bank_0_digest  = BANK_DIGEST_NONE;
+      settings.xip_image_size = 0;
+      settings.xip_image_crc  = 0;
     }
     // This handles cases where SoftDevice was not updated, hence bank0 keeps its settings.
     else
@@ -260,16 +410,30 @@ void bootloader_dfu_update_process(dfu_update_status_t update_status)
       settings.bank_0         = p_bootloader_settings->bank_0;
       settings.bank_0_crc     = p_bootloader_settings->bank_0_crc;
       settings.bank_0_size    = p_bootloader_settings->bank_0_size;
+      settings.bank_0_digest  = p_bootloader_settings->bank_0_digest;
+      memcpy(settings.bank_0_sha256, p_bootloader_settings->bank_0_sha256, sizeof(settings.bank_0_sha256));
+      settings.xip_image_size = p_bootloader_settings->xip_image_size;
+      settings.xip_image_crc  = p_bootloader_settings->xip_image_crc;
     }
 
     settings.bank_1         = BANK_INVALID_APP;
     settings.sd_image_size  = 0;
     settings.bl_image_size  = 0;
     settings.app_image_size = 0;
+    settings.sd_swap_next   = 0;
 
     m_update_status         = BOOTLOADER_SETTINGS_SAVING;
     bootloader_settings_save(&settings);
   }
+  else if (update_status.status_code == DFU_UPDATE_SD_SWAP_PROGRESS)
+  {
+    // Everything else is kept, SoftDevice swap resumes from here after a reset
+    bootloader_settings_get(&settings);
+    settings.sd_swap_next = update_status.sd_swap_next;
+
+    m_update_status       = BOOTLOADER_SETTINGS_SAVING;
+    bootloader_settings_save(&settings);
+  }
   else if (update_status.status_code == DFU_TIMEOUT)
   {
     // Timeout has occurred. Close the connection with the DFU Controller.
@@ -287,10 +451,19 @@ void bootloader_dfu_update_process(dfu_update_status_t update_status)
   }
   else if (update_status.status_code == DFU_BANK_0_ERASED)
   {
-    settings.bank_0_crc  = 0;
-    settings.bank_0_size = 0;
-    settings.bank_0      = BANK_INVALID_APP;
-    settings.bank_1      = p_bootloader_settings->bank_1;
+    // DFU carries on, m_update_status is left alone. Everything but bank 0 is kept e.g a staged
+    // image whose commit failed is retried on next boot, along with the digest recorded for it.
+    bootloader_settings_get(&settings);
+    settings.bank_0_crc     = 0;
+    settings.bank_0         = BANK_INVALID_APP;
+    settings.xip_image_size = 0;
+    settings.xip_image_crc  = 0;
+
+    if ( settings.bank_1 != BANK_VALID_STAGED_APP )
+    {
+      settings.bank_0_size   = 0;
+      settings.bank_0_digest = BANK_DIGEST_NONE;
+    }
 
     bootloader_settings_save(&settings);
   }
@@ -316,6 +489,8 @@ uint32_t bootloader_init(void)
   m_bootsettings_handle.block_id = BOOTLOADER_SETTINGS_ADDRESS;
   err_code = pstorage_register(&storage_params, &m_bootsettings_handle);
 
+  flash_wear_init();
+
   return err_code;
 }
 
@@ -326,26 +501,36 @@ uint32_t bootloader_dfu_start(bool ota, uint32_t timeout_ms, bool cancel_timeout
 
   m_cancel_timeout_on_usb = cancel_timeout_on_usb && !ota;
 
+  // settings saved before e.g by SoftDevice swap on boot must not end this DFU session
+  m_update_status = BOOTLOADER_UPDATING;
+
   // Clear swap if banked update is used.
   err_code = dfu_init();
   VERIFY_SUCCESS(err_code);
 
+  // DFU mode with timeout can be
+  // - Forced startup DFU for nRF52832 or
+  // - Makecode single tap reset but no enumerated (battery power)
+  // - Warm entry from the application with a timeout
+  if ( timeout_ms )
+  {
+    dfu_startup_packet_received = false;
+
+    app_timer_create(&_dfu_startup_timer, APP_TIMER_MODE_SINGLE_SHOT, dfu_startup_timer_handler);
+    app_timer_start(_dfu_startup_timer, APP_TIMER_TICKS(timeout_ms), NULL);
+  }
+
   if ( ota )
   {
     err_code = dfu_transport_ble_update_start();
-  }else
-  {
-    // DFU mode with timeout can be
-    // - Forced startup DFU for nRF52832 or
-    // - Makecode single tap reset but no enumerated (battery power)
-    if ( timeout_ms )
-    {
-      dfu_startup_packet_received = false;
 
-      app_timer_create(&_dfu_startup_timer, APP_TIMER_MODE_SINGLE_SHOT, dfu_startup_timer_handler);
-      app_timer_start(_dfu_startup_timer, APP_TIMER_TICKS(timeout_ms), NULL);
+    // USB serial listens as well, started last since BLE start resets the buffer pool it shares
+    if ( (err_code == NRF_SUCCESS) && is_dfu_dual() )
+    {
+      err_code = dfu_transport_serial_update_start();
     }
-
+  }else
+  {
     err_code = dfu_transport_serial_update_start();
   }
 
@@ -458,6 +643,106 @@ uint32_t bootloader_dfu_sd_update_finalize(void)
 }
 
 
+bool bootloader_dfu_app_staged(void)
+{
+#ifdef ENABLE_QSPI_STAGING
+  bootloader_settings_t const * p_bootloader_settings;
+
+  bootloader_util_settings_get(&p_bootloader_settings);
+
+  return (p_bootloader_settings->bank_1 == BANK_VALID_STAGED_APP) &&
+         (p_bootloader_settings->staged_image_size != 0);
+#else
+  return false;
+#endif
+}
+
+
+uint32_t bootloader_dfu_staged_app_commit(void)
+{
+#ifdef ENABLE_QSPI_STAGING
+  bootloader_settings_t const * p_bootloader_settings;
+
+  bootloader_util_settings_get(&p_bootloader_settings);
+
+  uint32_t const dst  = p_bootloader_settings->staged_image_start;
+  uint32_t const size = p_bootloader_settings->staged_image_size;
+  uint32_t const src  = CFG_UF2_QSPI_STAGING_OFFSET + (dst - USER_FLASH_START);
+
+  // Ensure that flash operations are not executed within the first 100 ms seconds to allow
+  // a debugger to be attached.
+  NRFX_DELAY_MS(100);
+
+  uint32_t const first_page = dst & ~(CODE_PAGE_SIZE - 1);
+  uint8_t const * p_pages   = p_bootloader_settings->staged_pages;
+
+  // Second pass only re-programs pages that did not take the first time
+  for (uint8_t attempt = 0; attempt < 2; attempt++)
+  {
+    bool copied = true;
+
+    // Pages the uf2 session did not write already hold what the staged image expects there
+    for (uint32_t page_addr = first_page; page_addr < dst + size; page_addr += CODE_PAGE_SIZE)
+    {
+      uint32_t const page = (page_addr - first_page) / CODE_PAGE_SIZE;
+
+      if ( !(p_pages[page / 8] & (1 << (page % 8))) ) continue;
+
+      uint32_t const start = (page_addr < dst) ? dst : page_addr;
+      uint32_t const end   = (page_addr + CODE_PAGE_SIZE < dst + size) ? (page_addr + CODE_PAGE_SIZE) : (dst + size);
+
+      if ( !flash_nrf5x_copy_from_qspi(start, src + (start - dst), end - start) ) copied = false;
+    }
+
+    if ( copied && (crc16_compute((uint8_t const *) dst, size, NULL) == p_bootloader_settings->staged_image_crc) )
+    {
+      PRINTF("Staged app committed\r\n");
+
+      // same as uf2 update: crc is not checked on boot, XIP part recorded when staged is kept
+      dfu_update_status_t update_status = { 0 };
+      update_status.status_code = DFU_UPDATE_APP_COMPLETE;
+      update_status.xip_size    = p_bootloader_settings->xip_image_size;
+      update_status.xip_crc     = p_bootloader_settings->xip_image_crc;
+
+      // Restore of pages borrowed by a bootloader update: app keeps what was recorded for it
+      if ( p_bootloader_settings->bank_0 == BANK_BACKED_UP_APP )
+      {
+        update_status.app_crc  = p_bootloader_settings->bank_0_crc;
+        update_status.app_size = p_bootloader_settings->bank_0_size;
+      }
+
+      // Digest recorded when the app was staged (or along with the backed up app)
+      if ( p_bootloader_settings->bank_0_digest == BANK_DIGEST_SHA256 )
+      {
+        update_status.app_size     = p_bootloader_settings->bank_0_size;
+        update_status.p_app_sha256 = p_bootloader_settings->bank_0_sha256;
+      }
+
+      bootloader_dfu_update_process(update_status);
+
+      return NRF_SUCCESS;
+    }
+  }
+
+  // Partially restored app must not be started. A backed up one is not started either, its record
+  // is kept for the retry.
+  if ( p_bootloader_settings->bank_0 == BANK_VALID_APP )
+  {
+    dfu_update_status_t update_status = { 0 };
+    update_status.status_code = DFU_BANK_0_ERASED;
+
+    bootloader_dfu_update_process(update_status);
+  }
+
+  // Staged image is kept, commit is retried on next boot. Bank 0 stays invalid so that DFU is entered.
+  PRINTF("Staged app commit failed\r\n");
+  return NRF_ERROR_INVALID_DATA;
+#else
+  return NRF_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+
 void bootloader_settings_get(bootloader_settings_t * const p_settings)
 {
   bootloader_settings_t const * p_bootloader_settings;
@@ -472,4 +757,18 @@ void bootloader_settings_get(bootloader_settings_t * const p_settings)
   p_settings->bl_image_size  = p_bootloader_settings->bl_image_size;
   p_settings->app_image_size = p_bootloader_settings->app_image_size;
   p_settings->sd_image_start = p_bootloader_settings->sd_image_start;
+
+  p_settings->staged_image_start = p_bootloader_settings->staged_image_start;
+  p_settings->staged_image_size  = p_bootloader_settings->staged_image_size;
+  p_settings->staged_image_crc   = p_bootloader_settings->staged_image_crc;
+
+  p_settings->bank_0_digest = p_bootloader_settings->bank_0_digest;
+  memcpy(p_settings->bank_0_sha256, p_bootloader_settings->bank_0_sha256, sizeof(p_settings->bank_0_sha256));
+
+  p_settings->xip_image_size = p_bootloader_settings->xip_image_size;
+  p_settings->xip_image_crc  = p_bootloader_settings->xip_image_crc;
+
+  p_settings->sd_swap_next   = p_bootloader_settings->sd_swap_next;
+
+  memcpy(p_settings->staged_pages, p_bootloader_settings->staged_pages, sizeof(p_settings->staged_pages));
 }
@@ -90,6 +90,21 @@ uint32_t bootloader_dfu_sd_update_continue(void);
 uint32_t bootloader_dfu_sd_update_finalize(void);
 
 
+/**@brief Function getting state of a QSPI staged application waiting to be committed.
+ *
+ * @retval     true          An application image is held in QSPI staging slot and has not yet
+ *                           been (completely) copied into bank 0.
+ * @retval     false         No staged application.
+ */
+bool bootloader_dfu_app_staged(void);
+
+/**@brief Function for committing the QSPI staged application into bank 0.
+ *        Copy is resumable, pages already committed before a power loss are skipped.
+ *
+ * @retval     NRF_SUCCESS   If committed image matches the staged CRC.
+ */
+uint32_t bootloader_dfu_staged_app_commit(void);
+
 void bootloader_mbr_addrs_populate(void);
 
 #endif // BOOTLOADER_H__
@@ -36,10 +36,22 @@ typedef enum
     BANK_VALID_APP   = 0x01,
     BANK_VALID_SD    = 0xA5,
     BANK_VALID_BOOT  = 0xAA,
+    BANK_VALID_STAGED_APP = 0x5A,
+    BANK_BACKED_UP_APP    = 0x55, /**< Application pages borrowed by a bootloader update, not started until the staged commit puts them back. */
     BANK_ERASED      = 0xFE,
     BANK_INVALID_APP = 0xFF,
 } bootloader_bank_code_t;
 
+/**@brief Digest stored for bank 0 in addition to the CRC. Erased flash reads as no digest.
+  */
+typedef enum
+{
+    BANK_DIGEST_SHA256 = 0x5A,
+    BANK_DIGEST_NONE   = 0xFFFF,
+} bootloader_digest_code_t;
+
+#define BOOTLOADER_STAGED_PAGES_MAX 256  /**< Code pages of a staged image tracked in staged_pages. */
+
 /**@brief Structure holding bootloader settings for application and bank data.
  */
 typedef struct
@@ -52,6 +64,15 @@ typedef struct
     uint32_t bl_image_size;   /**< Size of Bootloader image in bank0 if bank_0 code is BANK_VALID_SD. */
     uint32_t app_image_size;  /**< Size of Application image in bank0 if bank_0 code is BANK_VALID_SD. */
     uint32_t sd_image_start;  /**< Location in flash where SoftDevice image is stored for SoftDevice update. */
+    uint32_t staged_image_start; /**< Internal flash address the QSPI staged application is committed to, if bank_1 code is BANK_VALID_STAGED_APP. */
+    uint32_t staged_image_size;  /**< Size of application image held in QSPI staging slot, if bank_1 code is BANK_VALID_STAGED_APP. */
+    uint16_t staged_image_crc;   /**< CRC of the staged image, checked against internal flash once committed. */
+    uint16_t bank_0_digest;      /**< Digest type stored in bank_0_sha256, see \ref bootloader_digest_code_t. */
+    uint8_t  bank_0_sha256[32];  /**< SHA-256 of the image in bank 0 if bank_0_digest is BANK_DIGEST_SHA256. */
+    uint32_t xip_image_size;     /**< Size of the part of bank 0 application executing in place from QSPI, 0 if none. */
+    uint16_t xip_image_crc;      /**< CRC of the QSPI XIP part, checked together with bank 0. */
+    uint32_t sd_swap_next;       /**< SoftDevice address an interrupted swap resumes from, end of SoftDevice once swapped, 0 if not started. */
+    uint8_t  staged_pages[BOOTLOADER_STAGED_PAGES_MAX / 8]; /**< Code pages of the staged image to commit, one bit per page counted from the page of staged_image_start. Other pages are left as they are. */
 } bootloader_settings_t;
 
 #endif // BOOTLOADER_TYPES_H__ 
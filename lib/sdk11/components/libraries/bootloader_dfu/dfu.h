@@ -117,7 +117,10 @@ uint32_t dfu_sd_image_validate(void);
 uint32_t dfu_bl_image_swap(void);
 
 /**@brief Function for swapping existing SoftDevice with newly received.
- *        
+ *
+ * @details Only pages that differ are copied. Progress is kept in the bootloader settings so that
+ *          an interrupted swap resumes where it left off.
+ *
  * @return NRF_SUCCESS on succesfull swapping. For error code please refer to 
  *         \ref sd_mbr_command_copy_sd_t.
  */
@@ -129,6 +132,16 @@ uint32_t dfu_sd_image_swap(void);
  */
 uint32_t dfu_init_pkt_complete(void);
 
+/**@brief Function for checking if a data packet completed the image.
+ *
+ * @details A data packet can be reported through the callback after \ref dfu_data_pkt_handle has
+ *          returned, e.g a compressed packet decoded once flash caught up. The transport reports
+ *          the transfer complete when the callback for the final packet arrives.
+ *
+ * @return    true if p_data is the data packet that completed the image.
+ */
+bool dfu_data_pkt_is_final(uint8_t const * p_data);
+
 #endif // DFU_H__
 
 /** @} */
@@ -42,6 +42,7 @@
 #define DFU_INIT_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "nrf.h"
 
 /**@brief Structure contained in an init packet. Contains information on device type, revision, and 
@@ -82,6 +83,10 @@ typedef struct
 #define DFU_DEVICE_REVISION_EMPTY           ((uint16_t)0xFFFF)                              /**< Mask indicating no device revision is present in UICR. 0xFFFF is default flash pattern when not written with data. */
 #define DFU_SOFTDEVICE_ANY                  ((uint16_t)0xFFFE)                              /**< Mask indicating that any SoftDevice is allowed for updating this application. Allows for easy development. Not to be used in production images. */
 
+#define DFU_INIT_FLAG_COMPRESSED            ((uint16_t)0x0001)                              /**< Image data is heatshrink compressed, see decompress.h. Image sizes and CRC in the start/init packet refer to the decompressed image. */
+#define DFU_INIT_FLAG_SHA256                ((uint16_t)0x0002)                              /**< Extended data carries the SHA-256 digest of the image, which is then used for validation instead of the CRC. */
+#define DFU_INIT_FLAG_SIGNED                ((uint16_t)0x0004)                              /**< Extended data carries an Ed25519 signature of the SHA-256 digest after the digest. Requires DFU_INIT_FLAG_SHA256. */
+
 
 /**@brief DFU prevalidate call for pre-checking the received init packet.
  *
@@ -129,6 +134,46 @@ uint32_t dfu_init_prevalidate(uint8_t * p_init_data, uint32_t init_data_len, uin
  */
 uint32_t dfu_init_postvalidate(uint8_t * p_image, uint32_t image_len);
 
+/**@brief Function for getting the flags carried in the extended data of the init packet.
+ *
+ * @details Flags follow the CRC in the extended data. Init packets without flags return 0.
+ *          Only valid after a successful call to \ref dfu_init_prevalidate.
+ *
+ * @return Bitmask of DFU_INIT_FLAG_xxx values.
+ */
+uint16_t dfu_init_flags_get(void);
+
+/**@brief Function for getting the SHA-256 digest of the image carried in the init packet.
+ *
+ * @details Only valid after a successful call to \ref dfu_init_prevalidate.
+ *
+ * @return Pointer to the 32-byte digest, NULL if the init packet does not carry one.
+ */
+uint8_t const * dfu_init_sha256_get(void);
+
+uint32_t dfu_init_signature_check(uint8_t const * p_digest);
+
+#ifdef DFU_SIGNING_PUBKEY
+bool dfu_init_signature_verify(uint8_t const * p_digest, uint8_t const * p_signature);
+#endif
+
+/**@brief Function for checking that the installed application is the base image of a delta update.
+ *
+ * @details The CRC and size of the base image are carried in the extended data after the flags.
+ *          Only valid after a successful call to \ref dfu_init_prevalidate.
+ *
+ * @retval NRF_SUCCESS              If bank 0 holds the base image the patch was generated from.
+ * @retval NRF_ERROR_INVALID_DATA   If the installed image does not match.
+ * @retval NRF_ERROR_INVALID_LENGTH If the init packet carries no base image information.
+ */
+uint32_t dfu_init_delta_base_check(void);
+
+/**@brief Function for getting the size of the delta base image.
+ *
+ * @return Size of the base image, only valid after \ref dfu_init_delta_base_check succeeded.
+ */
+uint32_t dfu_init_delta_base_size(void);
+
 #endif // DFU_INIT_H__
 
 /**@} */
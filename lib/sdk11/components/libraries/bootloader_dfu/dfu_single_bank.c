@@ -16,6 +16,7 @@
 #include "dfu_bank_internal.h"
 #include "nrf.h"
 #include "nrf_sdm.h"
+#include "nrf_soc.h"
 #include "app_error.h"
 #include "app_timer.h"
 #include "bootloader.h"
@@ -26,14 +27,32 @@
 #include "sdk_common.h"
 
 #include "boards.h"
+#include "decompress.h"
+#include "delta.h"
+#include "sha256.h"
+#include "flash_wear.h"
+
+#define DECOMP_CHUNK_SIZE               256                         /**< Size of decompressed chunk written to flash at a time. Must be word sized and a divisor of CODE_PAGE_SIZE. */
+#define DECOMP_CHUNK_COUNT              4                           /**< Number of decompressed chunks that can wait for pstorage completion at a time. */
+#define DECOMP_INPUT_COUNT              8                           /**< Number of compressed or delta data packets that can wait for decoding, at least the receive buffers of a transport. */
+
+typedef struct
+{
+    uint8_t       * p_pkt;                                          /**< Data packet, reported to the transport once decoded. */
+    uint8_t const * p_in;                                           /**< Next byte to decode. */
+    uint32_t        length;                                         /**< Number of bytes left to decode. */
+} decomp_input_t;
 
 static dfu_state_t                  m_dfu_state;                /**< Current DFU state. */
 static uint32_t                     m_image_size;               /**< Size of the image that will be transmitted. */
 
 static dfu_start_packet_t           m_start_packet;             /**< Start packet received for this update procedure. Contains update mode and image sizes information to be used for image transfer. */
-static uint8_t                      m_init_packet[64];          /**< Init packet, can hold CRC, Hash, Signed Hash and similar, for image validation, integrety check and authorization checking. */ 
+static uint8_t                      m_init_packet[160];         /**< Init packet, can hold CRC, Hash, Signed Hash and similar, for image validation, integrety check and authorization checking. */ 
 static uint8_t                      m_init_packet_length;       /**< Length of init packet received. */
 static uint16_t                     m_image_crc;                /**< Calculated CRC of the image received. */
+static sha256_t                     m_image_sha;                /**< SHA-256 of the image, updated as data is committed to flash. */
+static uint8_t                      m_image_digest[SHA256_DIGEST_SIZE]; /**< Final SHA-256 of the image, valid if m_image_digest_valid. */
+static bool                         m_image_digest_valid;       /**< Image is validated by SHA-256 instead of CRC. */
 
 static pstorage_handle_t            m_storage_handle_app;       /**< Pstorage handle for the application area (bank 0). Bank used when updating a SoftDevice w/wo bootloader. Handle also used when swapping received application from bank 1 to bank 0. */
 static pstorage_handle_t          * mp_storage_handle_active;   /**< Pointer to the pstorage handle for the active bank for receiving of data packets. */
@@ -41,6 +60,36 @@ static pstorage_handle_t          * mp_storage_handle_active;   /**< Pointer to
 static dfu_callback_t               m_data_pkt_cb;              /**< Callback from DFU Bank module for notification of asynchronous operation such as flash prepare. */
 static dfu_bank_func_t              m_functions;                /**< Structure holding operations for the selected update process. */
 
+static bool                         m_compressed;               /**< Data packets carry a compressed image, see \ref DFU_INIT_FLAG_COMPRESSED. */
+static decompress_t                 m_decomp;                   /**< Decoder state, kept across data packets. */
+static uint32_t                     m_decomp_buf[DECOMP_CHUNK_COUNT][DECOMP_CHUNK_SIZE/4]; /**< Decompressed chunks, word aligned for pstorage and flash writes. */
+static uint8_t                      m_decomp_wr_idx;            /**< Chunk currently being filled. */
+static uint16_t                     m_decomp_fill;              /**< Number of bytes in the chunk currently being filled. */
+static uint8_t                      m_decomp_pending;           /**< Number of chunks stored but not yet completed by pstorage. */
+static uint8_t                    * mp_final_pkt;               /**< Final data packet of a compressed or delta update, its callback is deferred until all data is written. */
+static uint8_t                    * mp_last_pkt;                /**< Data packet that completed the image, see \ref dfu_data_pkt_is_final. */
+static decomp_input_t               m_decomp_in[DECOMP_INPUT_COUNT]; /**< Compressed or delta data packets waiting for decoding, oldest first. */
+static uint8_t                      m_decomp_in_rd;             /**< Oldest entry of m_decomp_in. */
+static uint8_t                      m_decomp_in_count;          /**< Number of entries in m_decomp_in. */
+
+static bool                         m_delta;                    /**< Data packets carry a patch against the installed application, see \ref DFU_UPDATE_APP_DELTA. */
+static delta_t                      m_delta_state;              /**< Patch applier state, kept across data packets. */
+static uint32_t                     m_delta_page[CODE_PAGE_SIZE/4]; /**< New content of the page being patched when running with SoftDevice. */
+static uint32_t                     m_delta_page_addr;          /**< Address of the page held in m_delta_page. */
+static bool                         m_delta_page_busy;          /**< Page write is in progress, patching carries on once it is written. */
+
+static uint32_t dfu_decomp_run(void);
+static uint32_t dfu_delta_run(void);
+
+
+/**@brief Function for checking if a pstorage buffer is one of the decompressed chunks.
+ */
+static bool is_decomp_chunk(uint8_t const * p_data)
+{
+    return (p_data >= (uint8_t const *)m_decomp_buf) &&
+           (p_data <  (uint8_t const *)m_decomp_buf + sizeof(m_decomp_buf));
+}
+
 
 /**@brief Function for handling callbacks from pstorage module.
  *
@@ -56,6 +105,58 @@ static void pstorage_callback_handler(pstorage_handle_t * p_handle,
     switch (op_code)
     {
         case PSTORAGE_STORE_OP_CODE:
+            if (p_data == (uint8_t *)m_delta_page)
+            {
+                // Patched page is written, patching carries on with the queued packets. The final
+                // data packet is reported once its last page is written.
+                m_delta_page_busy = false;
+                if (result == NRF_SUCCESS)
+                {
+                    result = dfu_delta_run();
+                }
+
+                if ((result == NRF_SUCCESS) && (m_delta_page_busy || (mp_final_pkt == NULL)))
+                {
+                    break;
+                }
+
+                p_data       = (mp_final_pkt != NULL) ? mp_final_pkt :
+                               (m_decomp_in_count != 0) ? m_decomp_in[m_decomp_in_rd].p_pkt : NULL;
+                mp_final_pkt = NULL;
+
+                if (result != NRF_SUCCESS)
+                {
+                    // Transfer fails, queued packets are not patched any further.
+                    m_decomp_in_count = 0;
+                }
+            }
+            else if (is_decomp_chunk(p_data))
+            {
+                // A decompressed chunk is written, decoding carries on if it waited for one. The
+                // final data packet is reported once all chunks are written, other packets are
+                // reported when decoded.
+                m_decomp_pending--;
+                if (result == NRF_SUCCESS)
+                {
+                    result = dfu_decomp_run();
+                }
+
+                if ((result == NRF_SUCCESS) && ((m_decomp_pending != 0) || (mp_final_pkt == NULL)))
+                {
+                    break;
+                }
+
+                p_data       = (mp_final_pkt != NULL) ? mp_final_pkt :
+                               (m_decomp_in_count != 0) ? m_decomp_in[m_decomp_in_rd].p_pkt : NULL;
+                mp_final_pkt = NULL;
+
+                if (result != NRF_SUCCESS)
+                {
+                    // Transfer fails, queued packets are not decoded any further.
+                    m_decomp_in_count = 0;
+                }
+            }
+
             if ((m_dfu_state == DFU_STATE_RX_DATA_PKT) && (m_data_pkt_cb != NULL))
             {
                 m_data_pkt_cb(DATA_PACKET, result, p_data);
@@ -94,6 +195,8 @@ static void dfu_prepare_func_app_erase(uint32_t image_size)
   // for new SoftDevice.
   m_dfu_state = DFU_STATE_PREPARING;
 
+  flash_wear_erased(DFU_BANK_0_REGION_START, m_image_size);
+
   if ( is_ota() )
   {
     uint32_t err_code = pstorage_clear(&m_storage_handle_app, m_image_size);
@@ -116,6 +219,31 @@ static void dfu_prepare_func_app_erase(uint32_t image_size)
 }
 
 
+/**@brief   Function for preparing flash before receiving a delta patch.
+ *
+ * @details Bank 0 holds the base image of the patch and is rewritten in place, nothing is erased
+ *          up front. Only pages which actually change are erased while the patch is applied.
+ */
+static void dfu_prepare_func_app_delta(uint32_t image_size)
+{
+    mp_storage_handle_active = &m_storage_handle_app;
+    m_dfu_state              = DFU_STATE_PREPARING;
+
+    // invoke complete callback
+    pstorage_callback_handler(&m_storage_handle_app, PSTORAGE_CLEAR_OP_CODE, NRF_SUCCESS, NULL, 0);
+}
+
+
+/**@brief   Function for handling behaviour when delta preparation has completed.
+ *
+ * @details Bank 0 is still valid at this point. It is invalidated in \ref dfu_init_pkt_complete
+ *          once the init packet has confirmed that it is the base image of the patch.
+ */
+static void dfu_cleared_func_app_delta(void)
+{
+}
+
+
 /**@brief   Function for handling behaviour when clear operation has completed.
  */
 static void dfu_cleared_func_app(void)
@@ -197,6 +325,11 @@ static uint32_t dfu_activate_app(void)
     update_status.app_crc     = m_image_crc;
     update_status.app_size    = m_start_packet.app_image_size;
 
+    if (m_image_digest_valid)
+    {
+        update_status.p_app_sha256 = m_image_digest;
+    }
+
     bootloader_dfu_update_process(update_status);
 
     return err_code;
@@ -234,6 +367,8 @@ uint32_t dfu_init(void)
 
     m_init_packet_length = 0;
     m_image_crc          = 0;
+    m_compressed         = false;
+    m_delta              = false;
 
     err_code = pstorage_register(&storage_module_param, &m_storage_handle_app);
     if (err_code != NRF_SUCCESS)
@@ -294,8 +429,24 @@ uint32_t dfu_start_pkt_handle(dfu_update_packet_t * p_packet)
     {
         return NRF_ERROR_DATA_SIZE;
     }
-    m_functions.prepare  = dfu_prepare_func_app_erase;
-    m_functions.cleared  = dfu_cleared_func_app;
+    m_delta = (m_start_packet.dfu_update_mode & DFU_UPDATE_APP_DELTA) != 0;
+
+    if (m_delta && !IS_UPDATING_APP(m_start_packet))
+    {
+        // Patches only apply to the application.
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+
+    if (m_delta)
+    {
+        m_functions.prepare = dfu_prepare_func_app_delta;
+        m_functions.cleared = dfu_cleared_func_app_delta;
+    }
+    else
+    {
+        m_functions.prepare = dfu_prepare_func_app_erase;
+        m_functions.cleared = dfu_cleared_func_app;
+    }
     
     if (IS_UPDATING_SD(m_start_packet))
     {
@@ -318,6 +469,311 @@ uint32_t dfu_start_pkt_handle(dfu_update_packet_t * p_packet)
 }
 
 
+/**@brief Function for failing the transfer when flash written without SoftDevice did not verify.
+ *
+ * @return NRF_ERROR_INTERNAL, the packet is reported with it through the callback as well.
+ */
+static uint32_t dfu_flash_failed(uint8_t * p_data)
+{
+    // Image is never complete, validation fails.
+    m_data_received = 0xFFFFFFFF;
+
+    pstorage_callback_handler(mp_storage_handle_active, PSTORAGE_STORE_OP_CODE, NRF_ERROR_INTERNAL, p_data, 0);
+    return NRF_ERROR_INTERNAL;
+}
+
+
+/**@brief Function for decoding the queued compressed data packets into bank 0.
+ *
+ * @details Decoded data is gathered into word sized chunks which are written to flash as they
+ *          fill up. When running with SoftDevice the chunks are queued to pstorage, decoding pauses
+ *          while all of them wait for flash and carries on from pstorage_callback_handler() once
+ *          one is written. A packet is reported to the transport once it is fully decoded, so that
+ *          the peer is paced by flash. The final packet is reported once all chunks are written.
+ *
+ * @return NRF_SUCCESS on success, error code otherwise.
+ */
+static uint32_t dfu_decomp_run(void)
+{
+    uint32_t err_code;
+
+    while (m_decomp_in_count != 0)
+    {
+        decomp_input_t * p_in = &m_decomp_in[m_decomp_in_rd];
+
+        while (m_data_received < m_image_size)
+        {
+            if (is_ota() && (m_decomp_fill == 0) && (m_decomp_pending == DECOMP_CHUNK_COUNT))
+            {
+                // All chunks are still waiting for flash, the packet is kept until one is written.
+                return NRF_SUCCESS;
+            }
+
+            uint8_t * p_chunk = (uint8_t *)m_decomp_buf[m_decomp_wr_idx];
+            uint32_t  in_used;
+            uint32_t  wanted  = MIN((uint32_t)(DECOMP_CHUNK_SIZE - m_decomp_fill), m_image_size - m_data_received);
+            uint32_t  count   = decompress_run(&m_decomp, p_in->p_in, p_in->length, &in_used,
+                                               p_chunk + m_decomp_fill, wanted);
+
+            p_in->p_in      += in_used;
+            p_in->length    -= in_used;
+            m_decomp_fill   += count;
+            m_data_received += count;
+
+            if ((m_decomp_fill == DECOMP_CHUNK_SIZE) || (m_data_received == m_image_size))
+            {
+                uint32_t const offset = m_data_received - m_decomp_fill;
+
+                sha256_update(&m_image_sha, p_chunk, m_decomp_fill);
+
+                if (is_ota())
+                {
+                    err_code = pstorage_store(mp_storage_handle_active, p_chunk, m_decomp_fill, offset);
+                    VERIFY_SUCCESS(err_code);
+
+                    m_decomp_pending++;
+                    m_decomp_wr_idx = (m_decomp_wr_idx + 1) % DECOMP_CHUNK_COUNT;
+                }
+                else if (!flash_nrf5x_write(DFU_BANK_0_REGION_START + offset, p_chunk, m_decomp_fill, false))
+                {
+                    return dfu_flash_failed(p_in->p_pkt);
+                }
+
+                m_decomp_fill = 0;
+            }
+            else if (count < wanted)
+            {
+                // Input exhausted, wait for next packet.
+                break;
+            }
+        }
+
+        uint8_t * p_pkt = p_in->p_pkt;
+
+        m_decomp_in_rd = (m_decomp_in_rd + 1) % DECOMP_INPUT_COUNT;
+        m_decomp_in_count--;
+
+        if (m_data_received != m_image_size)
+        {
+            pstorage_callback_handler(mp_storage_handle_active, PSTORAGE_STORE_OP_CODE, NRF_SUCCESS, p_pkt, 0);
+        }
+        else if (mp_last_pkt != NULL)
+        {
+            // Queued behind the packet that completed the image.
+            pstorage_callback_handler(mp_storage_handle_active, PSTORAGE_STORE_OP_CODE, NRF_ERROR_DATA_SIZE, p_pkt, 0);
+        }
+        else if (!is_ota() && !flash_nrf5x_flush(false))
+        {
+            return dfu_flash_failed(p_pkt);
+        }
+        else
+        {
+            mp_last_pkt = p_pkt;
+
+            if (is_ota())
+            {
+                // Reported when the last chunk is written, see pstorage_callback_handler().
+                mp_final_pkt = p_pkt;
+            }
+            else
+            {
+                pstorage_callback_handler(mp_storage_handle_active, PSTORAGE_STORE_OP_CODE, NRF_SUCCESS, p_pkt, 0);
+            }
+        }
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for queuing a compressed or delta data packet for decoding into bank 0.
+ *
+ * @return NRF_SUCCESS when the packet completed the image, NRF_ERROR_INVALID_LENGTH if more data
+ *         is expected, error code otherwise. The packet is reported through the callback once it
+ *         is decoded, which can be after this returns.
+ */
+static uint32_t dfu_queued_pkt_handle(uint8_t * p_data, uint32_t length)
+{
+    uint32_t err_code;
+
+    if ((mp_last_pkt != NULL) || (m_data_received > m_image_size))
+    {
+        m_data_received = 0xFFFFFFFF;
+        return NRF_ERROR_DATA_SIZE;
+    }
+
+    if (m_decomp_in_count == DECOMP_INPUT_COUNT)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    decomp_input_t * p_in = &m_decomp_in[(m_decomp_in_rd + m_decomp_in_count) % DECOMP_INPUT_COUNT];
+
+    p_in->p_pkt  = p_data;
+    p_in->p_in   = p_data;
+    p_in->length = length;
+    m_decomp_in_count++;
+
+    err_code = m_delta ? dfu_delta_run() : dfu_decomp_run();
+    if (err_code != NRF_SUCCESS)
+    {
+        m_decomp_in_count = 0;
+        return err_code;
+    }
+
+    return (mp_last_pkt == p_data) ? NRF_SUCCESS : NRF_ERROR_INVALID_LENGTH;
+}
+
+
+/**@brief Function for writing the patched page to flash when running with SoftDevice.
+ *
+ * @details Unchanged pages are neither erased nor written. Otherwise patching pauses until the
+ *          page is written, see pstorage_callback_handler(), and the packets received meanwhile are
+ *          queued. The peer is paced by flash through the deferred packet callbacks.
+ */
+static uint32_t dfu_delta_page_commit(void)
+{
+    uint32_t          err_code;
+    pstorage_handle_t handle = m_storage_handle_app;
+
+    if (memcmp(m_delta_page, (void const *)m_delta_page_addr, CODE_PAGE_SIZE) == 0)
+    {
+        return NRF_SUCCESS;
+    }
+
+    handle.block_id = m_delta_page_addr;
+
+    err_code = pstorage_clear(&handle, CODE_PAGE_SIZE);
+    VERIFY_SUCCESS(err_code);
+
+    flash_wear_erased(m_delta_page_addr, CODE_PAGE_SIZE);
+
+    err_code = pstorage_store(&handle, (uint8_t *)m_delta_page, CODE_PAGE_SIZE, 0);
+    VERIFY_SUCCESS(err_code);
+
+    m_delta_page_busy = true;
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for applying the queued delta data packets to bank 0 in place.
+ *
+ * @details The new image is produced in ascending order. Without SoftDevice it goes through the
+ *          flash page cache which skips unchanged pages, otherwise it is gathered a page at a time
+ *          in m_delta_page. A packet is reported to the transport once it is fully applied, the
+ *          final one once its last page is written.
+ *
+ * @return NRF_SUCCESS on success, error code otherwise.
+ */
+static uint32_t dfu_delta_run(void)
+{
+    uint32_t err_code;
+
+    while (m_decomp_in_count != 0)
+    {
+        decomp_input_t * p_in = &m_decomp_in[m_decomp_in_rd];
+
+        while (m_data_received < m_image_size)
+        {
+            if (m_delta_page_busy)
+            {
+                // Page buffer is being written, the packet is kept until it is.
+                return NRF_SUCCESS;
+            }
+
+            uint32_t const page_offset = m_data_received & (CODE_PAGE_SIZE - 1);
+            uint32_t const page_addr   = DFU_BANK_0_REGION_START + m_data_received - page_offset;
+            uint32_t       wanted      = MIN(CODE_PAGE_SIZE - page_offset, m_image_size - m_data_received);
+            uint8_t      * p_out;
+            uint32_t       in_used;
+
+            if (is_ota())
+            {
+                // Start from current content so that data past the image end is kept.
+                if (m_delta_page_addr != page_addr)
+                {
+                    memcpy(m_delta_page, (void const *)page_addr, CODE_PAGE_SIZE);
+                    m_delta_page_addr = page_addr;
+                }
+                p_out = (uint8_t *)m_delta_page + page_offset;
+            }
+            else
+            {
+                wanted = MIN(wanted, DECOMP_CHUNK_SIZE);
+                p_out  = (uint8_t *)m_decomp_buf[0];
+            }
+
+            int32_t const count = delta_run(&m_delta_state, p_in->p_in, p_in->length, &in_used, p_out, wanted);
+            if (count < 0)
+            {
+                return NRF_ERROR_INVALID_DATA;
+            }
+
+            p_in->p_in      += in_used;
+            p_in->length    -= in_used;
+            m_data_received += count;
+
+            sha256_update(&m_image_sha, p_out, count);
+
+            if (!is_ota())
+            {
+                if ((count > 0) && !flash_nrf5x_write(page_addr + page_offset, p_out, count, true))
+                {
+                    return dfu_flash_failed(p_in->p_pkt);
+                }
+            }
+            else if ((page_offset + count == CODE_PAGE_SIZE) || (m_data_received == m_image_size))
+            {
+                err_code = dfu_delta_page_commit();
+                VERIFY_SUCCESS(err_code);
+            }
+
+            if ((uint32_t)count < wanted)
+            {
+                // Input exhausted, wait for next packet.
+                break;
+            }
+        }
+
+        uint8_t * p_pkt = p_in->p_pkt;
+
+        m_decomp_in_rd = (m_decomp_in_rd + 1) % DECOMP_INPUT_COUNT;
+        m_decomp_in_count--;
+
+        if (m_data_received != m_image_size)
+        {
+            pstorage_callback_handler(mp_storage_handle_active, PSTORAGE_STORE_OP_CODE, NRF_SUCCESS, p_pkt, 0);
+        }
+        else if (mp_last_pkt != NULL)
+        {
+            // Queued behind the packet that completed the image.
+            pstorage_callback_handler(mp_storage_handle_active, PSTORAGE_STORE_OP_CODE, NRF_ERROR_DATA_SIZE, p_pkt, 0);
+        }
+        else if (!is_ota() && !flash_nrf5x_flush(true))
+        {
+            return dfu_flash_failed(p_pkt);
+        }
+        else
+        {
+            mp_last_pkt = p_pkt;
+
+            if (m_delta_page_busy)
+            {
+                // Reported when the last page is written, see pstorage_callback_handler().
+                mp_final_pkt = p_pkt;
+            }
+            else
+            {
+                pstorage_callback_handler(mp_storage_handle_active, PSTORAGE_STORE_OP_CODE, NRF_SUCCESS, p_pkt, 0);
+            }
+        }
+    }
+
+    return NRF_SUCCESS;
+}
+
+
 uint32_t dfu_data_pkt_handle(dfu_update_packet_t * p_packet)
 {
     uint32_t   data_length;
@@ -342,6 +798,11 @@ uint32_t dfu_data_pkt_handle(dfu_update_packet_t * p_packet)
         case DFU_STATE_RX_DATA_PKT:
             data_length = p_packet->params.data_packet.packet_length * sizeof(uint32_t);
 
+            if (m_delta || m_compressed)
+            {
+                return dfu_queued_pkt_handle((uint8_t *)p_packet->params.data_packet.p_data_packet, data_length);
+            }
+
             if ((m_data_received + data_length) > m_image_size)
             {
                 // The caller is trying to write more bytes into the flash than the size provided to
@@ -356,6 +817,8 @@ uint32_t dfu_data_pkt_handle(dfu_update_packet_t * p_packet)
 
             p_data = (uint32_t *)p_packet->params.data_packet.p_data_packet;
 
+            sha256_update(&m_image_sha, p_data, data_length);
+
             if ( is_ota() )
             {
               err_code = pstorage_store(mp_storage_handle_active, (uint8_t *)p_data, data_length, m_data_received);
@@ -363,7 +826,12 @@ uint32_t dfu_data_pkt_handle(dfu_update_packet_t * p_packet)
             }
             else
             {
-              flash_nrf5x_write(DFU_BANK_0_REGION_START + m_data_received, p_data, data_length, false);
+              // last page is programmed along with the final packet
+              if ( !flash_nrf5x_write(DFU_BANK_0_REGION_START + m_data_received, p_data, data_length, false) ||
+                   ((m_data_received + data_length == m_image_size) && !flash_nrf5x_flush(false)) )
+              {
+                return dfu_flash_failed((uint8_t *) p_data);
+              }
               pstorage_callback_handler(mp_storage_handle_active, PSTORAGE_STORE_OP_CODE, NRF_SUCCESS, (uint8_t *) p_data, data_length);
             }
 
@@ -376,10 +844,9 @@ uint32_t dfu_data_pkt_handle(dfu_update_packet_t * p_packet)
             }
             else
             {
-              if ( !is_ota() ) flash_nrf5x_flush(false);
-
               // The entire image has been received. Return NRF_SUCCESS.
-              err_code = NRF_SUCCESS;
+              mp_last_pkt = (uint8_t *)p_data;
+              err_code    = NRF_SUCCESS;
             }
             break;
 
@@ -392,6 +859,12 @@ uint32_t dfu_data_pkt_handle(dfu_update_packet_t * p_packet)
 }
 
 
+bool dfu_data_pkt_is_final(uint8_t const * p_data)
+{
+    return (p_data != NULL) && (p_data == mp_last_pkt);
+}
+
+
 uint32_t dfu_init_pkt_complete(void)
 {
     uint32_t err_code = NRF_ERROR_INVALID_STATE;
@@ -406,9 +879,52 @@ uint32_t dfu_init_pkt_complete(void)
     if (m_dfu_state == DFU_STATE_RX_INIT_PKT)
     {
         err_code = dfu_init_prevalidate(m_init_packet, m_init_packet_length, m_start_packet.dfu_update_mode);
+
+        if ((err_code == NRF_SUCCESS) && m_delta)
+        {
+            if (dfu_init_flags_get() & DFU_INIT_FLAG_COMPRESSED)
+            {
+                err_code = NRF_ERROR_NOT_SUPPORTED;
+            }
+            else if (!bootloader_app_is_valid())
+            {
+                // Patch only applies to an intact base, e.g not to bank 0 left half patched by an
+                // interrupted session. A full image is needed then.
+                err_code = NRF_ERROR_INVALID_STATE;
+            }
+            else
+            {
+                err_code = dfu_init_delta_base_check();
+            }
+
+            if (err_code == NRF_SUCCESS)
+            {
+                delta_init(&m_delta_state, (void const *)DFU_BANK_0_REGION_START,
+                           dfu_init_delta_base_size(), CODE_PAGE_SIZE);
+                m_delta_page_addr = 0xFFFFFFFF;
+                m_delta_page_busy = false;
+
+                // Base image is verified and about to be rewritten in place. Bank 0 is invalidated
+                // before its first page is erased: the settings are queued to pstorage ahead of it.
+                dfu_cleared_func_app();
+            }
+        }
+
         if (err_code == NRF_SUCCESS)
         {
             m_dfu_state = DFU_STATE_RX_DATA_PKT;
+
+            m_compressed        = (dfu_init_flags_get() & DFU_INIT_FLAG_COMPRESSED) != 0;
+            m_image_digest_valid = false;
+            sha256_init(&m_image_sha);
+            m_decomp_wr_idx     = 0;
+            m_decomp_fill       = 0;
+            m_decomp_pending    = 0;
+            m_decomp_in_rd      = 0;
+            m_decomp_in_count   = 0;
+            mp_final_pkt = NULL;
+            mp_last_pkt  = NULL;
+            decompress_init(&m_decomp);
         }
         else
         {
@@ -477,8 +993,28 @@ uint32_t dfu_image_validate()
             {
                 m_dfu_state = DFU_STATE_VALIDATE;
 
-                err_code = dfu_init_postvalidate((uint8_t *)mp_storage_handle_active->block_id, m_image_size);
-                VERIFY_SUCCESS(err_code);
+                uint8_t const * p_expected_digest = dfu_init_sha256_get();
+
+                if (p_expected_digest != NULL)
+                {
+                    // Digest is streamed while data is committed, no extra pass over flash.
+                    sha256_final(&m_image_sha, m_image_digest);
+
+                    if (!sha256_equal(m_image_digest, p_expected_digest))
+                    {
+                        return NRF_ERROR_INVALID_DATA;
+                    }
+
+                    err_code = dfu_init_signature_check(m_image_digest);
+                    VERIFY_SUCCESS(err_code);
+
+                    m_image_digest_valid = true;
+                }
+                else
+                {
+                    err_code = dfu_init_postvalidate((uint8_t *)mp_storage_handle_active->block_id, m_image_size);
+                    VERIFY_SUCCESS(err_code);
+                }
                 m_dfu_state = DFU_STATE_WAIT_4_ACTIVATE;
             }
             break;
@@ -543,38 +1079,77 @@ static uint32_t dfu_copy_sd(uint32_t * src, uint32_t * dst, uint32_t len)
     sd_mbr_cmd.params.copy_sd.dst = dst;
     sd_mbr_cmd.params.copy_sd.len = len / sizeof(uint32_t);
 
+    // MBR erases the destination pages before copying
+    flash_wear_erased((uint32_t)dst, len);
+
     return sd_mbr_command(&sd_mbr_cmd);
 }
 
 
-static uint32_t dfu_sd_img_block_swap(uint32_t * src, 
-                                      uint32_t * dst, 
-                                      uint32_t len, 
-                                      uint32_t block_size)
+/**@brief   Function for saving how far the SoftDevice swap has come, see \ref dfu_sd_page_diff_copy.
+ */
+static void dfu_sd_swap_progress_save(uint32_t next)
 {
-    // It is neccesarry to swap the new SoftDevice in 3 rounds to ensure correct copy of data
-    // and verifucation of data in case power reset occurs during write to flash. 
-    // To ensure the robustness of swapping the images are compared backwards till start of
-    // image swap. If the back is identical everything is swapped.
-    uint32_t err_code = dfu_compare_block(src, dst, len);
-    if (err_code == NRF_SUCCESS)
-    {
-        return err_code;
-    }
+    dfu_update_status_t update_status = { 0 };
+    update_status.status_code  = DFU_UPDATE_SD_SWAP_PROGRESS;
+    update_status.sd_swap_next = next;
+    bootloader_dfu_update_process(update_status);
+}
+
 
-    if ((uint32_t)dst > SOFTDEVICE_REGION_START)
+/**@brief   Function for copying the pages of the received SoftDevice that differ from the
+ *          installed one, in ascending order.
+ *
+ * @details Runs of differing pages are copied with a single power-fail safe MBR command, pages
+ *          that already match are not erased at all. The received image is stored above the
+ *          SoftDevice region, so a destination page can only be a source page that was already
+ *          consumed. Resuming from the saved checkpoint re-reads sources from checkpoint + shift
+ *          upwards, hence a new checkpoint is saved before a copy reaches into them.
+ *
+ * @param[in] src     Start of the received image.
+ * @param[in] dst     Start of the SoftDevice region.
+ * @param[in] len     Size of the image.
+ * @param[in] resume  First destination address not known to be final.
+ *
+ * @return NRF_SUCCESS on success. For error code please refer to \ref sd_mbr_command_copy_sd_t.
+ */
+static uint32_t dfu_sd_page_diff_copy(uint32_t src, uint32_t dst, uint32_t len, uint32_t resume)
+{
+    uint32_t const shift      = src - dst;
+    uint32_t const end        = dst + len;
+    uint32_t       checkpoint = resume;
+    uint32_t       addr       = resume;
+
+    while (addr < end)
     {
-        err_code = dfu_sd_img_block_swap((uint32_t *)((uint32_t)src - block_size), 
-                                         (uint32_t *)((uint32_t)dst - block_size), 
-                                         block_size, 
-                                         block_size);
+        if (dfu_compare_block((uint32_t *)(addr + shift), (uint32_t *)addr, MIN(CODE_PAGE_SIZE, end - addr)) == NRF_SUCCESS)
+        {
+            addr += CODE_PAGE_SIZE;
+            continue;
+        }
+
+        // Extend the run by at most shift bytes, so that a single checkpoint covers it.
+        uint32_t run_end = addr + CODE_PAGE_SIZE;
+        while ((run_end < end) && (run_end + CODE_PAGE_SIZE - addr <= shift) &&
+               (dfu_compare_block((uint32_t *)(run_end + shift), (uint32_t *)run_end, MIN(CODE_PAGE_SIZE, end - run_end)) != NRF_SUCCESS))
+        {
+            run_end += CODE_PAGE_SIZE;
+        }
+        run_end = MIN(run_end, end);
+
+        if ((run_end > checkpoint + shift) && (addr < src + len))
+        {
+            checkpoint = addr;
+            dfu_sd_swap_progress_save(checkpoint);
+        }
+
+        uint32_t err_code = dfu_copy_sd((uint32_t *)(addr + shift), (uint32_t *)addr, run_end - addr);
         VERIFY_SUCCESS(err_code);
-    }
 
-    err_code = dfu_copy_sd(src, dst, len);
-    VERIFY_SUCCESS(err_code);
+        addr = run_end;
+    }
 
-    return dfu_compare_block(src, dst, len);
+    return NRF_SUCCESS;
 }
 
 
@@ -588,47 +1163,49 @@ uint32_t dfu_sd_image_swap(void)
     {
         return NRF_SUCCESS;
     }
-    
-    if ((SOFTDEVICE_REGION_START + boot_settings.sd_image_size) > boot_settings.sd_image_start)
+
+    uint32_t       err_code;
+    uint32_t const sd_start = SOFTDEVICE_REGION_START;
+    uint32_t const sd_end   = sd_start + boot_settings.sd_image_size;
+    bool const     overlap  = (sd_end > boot_settings.sd_image_start);
+    uint32_t       resume   = boot_settings.sd_swap_next;
+
+    if (resume == sd_end)
     {
-        uint32_t err_code;
-        uint32_t sd_start        = SOFTDEVICE_REGION_START;
-        uint32_t block_size      = (boot_settings.sd_image_start - sd_start) / 2;
-        
-        /* ##### FIX START ##### */
-        block_size &= ~(uint32_t)(CODE_PAGE_SIZE - 1); 
-        /* ##### FIX END ##### */       
-        
-        uint32_t image_end       = boot_settings.sd_image_start + boot_settings.sd_image_size;
+        return NRF_SUCCESS;
+    }
 
-        uint32_t img_block_start = boot_settings.sd_image_start + 2 * block_size;
-        uint32_t sd_block_start  = sd_start + 2 * block_size;
-        
-        if (SD_SIZE_GET(MBR_SIZE) < boot_settings.sd_image_size)
+    // Nothing recorded (or left over by an older bootloader), start from the bottom.
+    if ((resume < sd_start) || (resume > sd_end))
+    {
+        resume = sd_start;
+
+        if (overlap && (SD_SIZE_GET(MBR_SIZE) < boot_settings.sd_image_size))
         {
+            uint32_t block_size = (boot_settings.sd_image_start - sd_start) / 2;
+
+            /* ##### FIX START ##### */
+            block_size &= ~(uint32_t)(CODE_PAGE_SIZE - 1);
+            /* ##### FIX END ##### */
+
             // This will clear a page thus ensuring the old image is invalidated before swapping.
-            err_code = dfu_copy_sd((uint32_t *)(sd_start + block_size), 
-                                   (uint32_t *)(sd_start + block_size), 
+            err_code = dfu_copy_sd((uint32_t *)(sd_start + block_size),
+                                   (uint32_t *)(sd_start + block_size),
                                    sizeof(uint32_t));
             VERIFY_SUCCESS(err_code);
 
             err_code = dfu_copy_sd((uint32_t *)sd_start, (uint32_t *)sd_start, sizeof(uint32_t));
             VERIFY_SUCCESS(err_code);
         }
-        
-        return dfu_sd_img_block_swap((uint32_t *)img_block_start, 
-                                     (uint32_t *)sd_block_start, 
-                                     image_end - img_block_start, 
-                                     block_size);
     }
-    else
+
+    err_code = dfu_sd_page_diff_copy(boot_settings.sd_image_start, sd_start, boot_settings.sd_image_size, resume);
+    VERIFY_SUCCESS(err_code);
+
+    // Bottom of the received image has been overwritten, validation relies on this record.
+    if (overlap)
     {
-        if (boot_settings.sd_image_size != 0)
-        {
-            return dfu_copy_sd((uint32_t *)boot_settings.sd_image_start,
-                               (uint32_t *)SOFTDEVICE_REGION_START, 
-                               boot_settings.sd_image_size);
-        }
+        dfu_sd_swap_progress_save(sd_end);
     }
 
     return NRF_SUCCESS;
@@ -687,7 +1264,6 @@ uint32_t dfu_bl_image_validate(void)
 uint32_t dfu_sd_image_validate(void)
 {
     bootloader_settings_t bootloader_settings;
-    sd_mbr_command_t      sd_mbr_cmd;
 
     bootloader_settings_get(&bootloader_settings);
 
@@ -695,35 +1271,28 @@ uint32_t dfu_sd_image_validate(void)
     {
         return NRF_SUCCESS;
     }
-    
-    if ((SOFTDEVICE_REGION_START + bootloader_settings.sd_image_size) > bootloader_settings.sd_image_start)
-    {
-        uint32_t sd_start        = SOFTDEVICE_REGION_START;
-        uint32_t block_size      = (bootloader_settings.sd_image_start - sd_start) / 2;
-        uint32_t image_end       = bootloader_settings.sd_image_start + 
-                                   bootloader_settings.sd_image_size;
 
-        /* ##### FIX START ##### */
-        block_size &= ~(uint32_t)(CODE_PAGE_SIZE - 1); 
-        /* ##### FIX END ##### */       
-        uint32_t img_block_start = bootloader_settings.sd_image_start + 2 * block_size;
-        uint32_t sd_block_start  = sd_start + 2 * block_size;
+    uint32_t const sd_start = SOFTDEVICE_REGION_START;
+    uint32_t const sd_end   = sd_start + bootloader_settings.sd_image_size;
+    uint32_t const shift    = bootloader_settings.sd_image_start - sd_start;
+    uint32_t       compare  = sd_start;
 
+    if (sd_end > bootloader_settings.sd_image_start)
+    {
         if (SD_SIZE_GET(MBR_SIZE) < bootloader_settings.sd_image_size)
         {
             return NRF_ERROR_NULL;
         }
 
-        return dfu_sd_img_block_swap((uint32_t *)img_block_start, 
-                                     (uint32_t *)sd_block_start, 
-                                     image_end - img_block_start, 
-                                     block_size);
+        // Swap overwrites the received image from its bottom: it is only complete once recorded,
+        // and only pages whose source is still intact can be compared.
+        if (bootloader_settings.sd_swap_next != sd_end)
+        {
+            return NRF_ERROR_NULL;
+        }
+
+        compare = sd_end - shift;
     }
-    
-    sd_mbr_cmd.command             = SD_MBR_COMMAND_COMPARE;
-    sd_mbr_cmd.params.compare.ptr1 = (uint32_t *)SOFTDEVICE_REGION_START;
-    sd_mbr_cmd.params.compare.ptr2 = (uint32_t *)bootloader_settings.sd_image_start;
-    sd_mbr_cmd.params.compare.len  = bootloader_settings.sd_image_size / sizeof(uint32_t);
 
-    return sd_mbr_command(&sd_mbr_cmd);
+    return dfu_compare_block((uint32_t *)(compare + shift), (uint32_t *)compare, sd_end - compare);
 }
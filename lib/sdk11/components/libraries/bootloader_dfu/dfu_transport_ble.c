@@ -13,6 +13,7 @@
 #include <stdio.h>
 #include "dfu_transport.h"
 #include "dfu.h"
+#include "dfu_init.h"
 #include <dfu_types.h>
 #include <stddef.h>
 #include "boards.h"
@@ -38,6 +39,8 @@
 
 #define BLEGAP_EVENT_LENGTH             6
 #define BLEGATT_ATT_MTU_MAX             23
+#define BLEL2CAP_MPS_MAX                247
+#define BLEL2CAP_RX_QUEUE_SIZE          3
 enum { BLE_CONN_CFG_HIGH_BANDWIDTH = 1 };
 
 #define DFU_REV_MAJOR                        0x00                                                    /** DFU Major revision number to be exposed. */
@@ -80,6 +83,11 @@ enum { BLE_CONN_CFG_HIGH_BANDWIDTH = 1 };
 #define BL_IMAGE_SIZE_OFFSET                 4                                                       /**< Offset in start packet for the size information for bootloader. */
 #define APP_IMAGE_SIZE_OFFSET                8                                                       /**< Offset in start packet for the size information for application. */
 
+#define DFU_L2CAP_PSM                        0x0081                                                  /**< LE PSM of the L2CAP CoC data channel, in the dynamic range. Firmware data only, control stays on the DFU Control Point. */
+#define DFU_L2CAP_SDU_SIZE                   1024                                                    /**< Size of an SDU buffer, each received SDU is one flash write. Multiple of 4 bytes. */
+#define DFU_L2CAP_SDU_COUNT                  BLEL2CAP_RX_QUEUE_SIZE                                  /**< Number of SDU buffers, all of them can be queued to the SoftDevice. */
+#define DFU_L2CAP_SDU_CREDITS                CEIL_DIV(DFU_L2CAP_SDU_SIZE + 2, BLEL2CAP_MPS_MAX)      /**< Credits issued to the peer for each SDU buffer, enough for a full SDU (2 bytes SDU length in first PDU). */
+
 /**@brief Packet type enumeration.
  */
 typedef enum
@@ -105,7 +113,13 @@ static bool                 m_is_advertising         = false;
 static dfu_ble_peer_data_t  m_ble_peer_data;                                                         /**< BLE Peer data exchanged from application on buttonless update mode. */
 static bool                 m_ble_peer_data_valid    = false;                                        /**< True if BLE Peer data has been exchanged from application. */
 static uint32_t             m_direct_adv_cnt         = APP_DIRECTED_ADV_TIMEOUT;                     /**< Counter of direct advertisements. */
-static uint8_t            * mp_final_packet;                                                         /**< Pointer to final data packet received. When callback for succesful packet handling is received from dfu bank handling a transfer complete response can be sent to peer. */
+static uint16_t             m_l2cap_cid              = BLE_L2CAP_CID_INVALID;                        /**< Local CID of the L2CAP CoC data channel, invalid if not set up. */
+static uint32_t             m_l2cap_sdu_buf[DFU_L2CAP_SDU_COUNT][DFU_L2CAP_SDU_SIZE / sizeof(uint32_t)]; /**< SDU buffers of the L2CAP CoC data channel, word aligned for the DFU module. */
+static uint8_t              m_l2cap_sd_mask;                                                         /**< SDU buffers queued to the SoftDevice for reception, one bit per buffer. */
+static uint8_t              m_l2cap_flash_mask;                                                      /**< SDU buffers holding data not yet written to flash, one bit per buffer. */
+
+STATIC_ASSERT(DFU_L2CAP_SDU_COUNT <= 8);
+STATIC_ASSERT((DFU_L2CAP_SDU_SIZE & (sizeof(uint32_t) - 1)) == 0);
 
 
 static ble_gap_addr_t      const * m_whitelist[1];                                                  /**< List of peers in whitelist (only one) */
@@ -209,6 +223,79 @@ static ble_dfu_resp_val_t nrf_err_code_translate(uint32_t                  err_c
 }
 
 
+/**@brief     Function for getting the index of an L2CAP CoC SDU buffer.
+ *
+ * @param[in] p_data    Pointer to a firmware data buffer.
+ *
+ * @return    Index of the SDU buffer, DFU_L2CAP_SDU_COUNT if p_data is not an SDU buffer (i.e it is
+ *            taken from the HCI memory pool for a write to the DFU Packet Characteristic).
+ */
+static uint32_t l2cap_sdu_buf_index(uint8_t const * p_data)
+{
+    uint8_t const * p_start = (uint8_t const *)m_l2cap_sdu_buf;
+
+    if ((p_data < p_start) || (p_data >= p_start + sizeof(m_l2cap_sdu_buf)))
+    {
+        return DFU_L2CAP_SDU_COUNT;
+    }
+
+    return (uint32_t)(p_data - p_start) / DFU_L2CAP_SDU_SIZE;
+}
+
+
+/**@brief     Function for handing a free SDU buffer to the SoftDevice for reception.
+ *
+ * @details   The SoftDevice gives the peer credits for a full SDU each time it starts using a new
+ *            buffer. A buffer is only handed over once its previous data is in flash, so the peer
+ *            is paced by the flash pipeline instead of packet receipt notifications.
+ *
+ * @param[in] index     Index of the SDU buffer.
+ */
+static void l2cap_sdu_buf_give(uint32_t index)
+{
+    uint8_t const bit = (uint8_t)(1UL << index);
+
+    if ((m_l2cap_cid == BLE_L2CAP_CID_INVALID) || ((m_l2cap_sd_mask | m_l2cap_flash_mask) & bit))
+    {
+        return;
+    }
+
+    ble_data_t sdu_buf = { .p_data = (uint8_t *)m_l2cap_sdu_buf[index], .len = DFU_L2CAP_SDU_SIZE };
+
+    // Only fails while the channel is being released, the buffer then stays free for the next one.
+    if (sd_ble_l2cap_ch_rx(m_conn_handle, m_l2cap_cid, &sdu_buf) == NRF_SUCCESS)
+    {
+        m_l2cap_sd_mask |= bit;
+    }
+}
+
+
+/**@brief     Function for releasing a firmware data buffer once its data is written to flash.
+ *
+ * @param[in] p_data    Pointer to the buffer, from the HCI memory pool or an L2CAP CoC SDU buffer.
+ *
+ * @return    NRF_SUCCESS on success, otherwise error code from the HCI memory pool.
+ */
+static uint32_t rx_buffer_release(uint8_t * p_data)
+{
+    uint32_t const index = l2cap_sdu_buf_index(p_data);
+
+    if (index == DFU_L2CAP_SDU_COUNT)
+    {
+        return hci_mem_pool_rx_consume(p_data);
+    }
+
+    // Completion can be reported more than once for a buffer, hand it over only once.
+    if (m_l2cap_flash_mask & (1UL << index))
+    {
+        m_l2cap_flash_mask &= ~(1UL << index);
+        l2cap_sdu_buf_give(index);
+    }
+
+    return NRF_SUCCESS;
+}
+
+
 /**@brief     Function for handling the callback events from the dfu module.
  *            Callbacks are expected when \ref dfu_data_pkt_handle has been executed.
  *
@@ -233,14 +320,20 @@ static void dfu_cb_handler(uint32_t packet, uint32_t result, uint8_t * p_data)
                                                      BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
                     APP_ERROR_CHECK(err_code);
                 }
+
+                // Keep the SDU buffer usable for a channel on the next connection.
+                if (l2cap_sdu_buf_index(p_data) != DFU_L2CAP_SDU_COUNT)
+                {
+                    (void)rx_buffer_release(p_data);
+                }
             }
             else
             {
-                err_code = hci_mem_pool_rx_consume(p_data);
+                err_code = rx_buffer_release(p_data);
                 APP_ERROR_CHECK(err_code);
 
                 // If the callback matches final data packet received then the peer is notified.
-                if (mp_final_packet == p_data)
+                if (dfu_data_pkt_is_final(p_data))
                 {
                     // Notify the DFU Controller about the success of the procedure.
                     err_code = ble_dfu_response_send(&m_dfu,
@@ -248,6 +341,21 @@ static void dfu_cb_handler(uint32_t packet, uint32_t result, uint8_t * p_data)
                                                      BLE_DFU_RESP_VAL_SUCCESS);
                     APP_ERROR_CHECK(err_code);
                 }
+                else if (m_pkt_rcpt_notif_enabled)
+                {
+                    // Packets are counted once handled rather than when received, so that the peer
+                    // is paced by flash (and by decoding of compressed or delta images).
+                    m_pkt_notif_target_cnt--;
+
+                    if (m_pkt_notif_target_cnt == 0)
+                    {
+                        err_code = ble_dfu_pkts_rcpt_notify(&m_dfu, m_num_of_firmware_bytes_rcvd);
+                        APP_ERROR_CHECK(err_code);
+
+                        // Reset the counter for the number of firmware packets.
+                        m_pkt_notif_target_cnt = m_pkt_notif_target;
+                    }
+                }
             }
             break;
 
@@ -389,6 +497,40 @@ static void init_data_process(ble_dfu_t * p_dfu, ble_dfu_evt_t * p_evt)
 }
 
 
+/**@brief     Function for passing firmware data to the DFU module.
+ *
+ * @param[in] p_dfu     DFU Service Structure.
+ * @param[in] p_data    Word aligned buffer holding the data, see \ref rx_buffer_release.
+ * @param[in] length    Length of the data in bytes, multiple of 4.
+ */
+static void firmware_data_process(ble_dfu_t * p_dfu, uint8_t * p_data, uint32_t length)
+{
+    uint32_t            err_code;
+    dfu_update_packet_t dfu_pkt;
+
+    dfu_pkt.packet_type                      = DATA_PACKET;
+    dfu_pkt.params.data_packet.packet_length = length / sizeof(uint32_t);
+    dfu_pkt.params.data_packet.p_data_packet = (uint32_t *)p_data;
+
+    // Counted before handing over, the DFU module may report the packet as handled right away.
+    // Response or packet receipt notification is sent once it is, see dfu_cb_handler().
+    m_num_of_firmware_bytes_rcvd += length;
+
+    err_code = dfu_data_pkt_handle(&dfu_pkt);
+
+    if ((err_code != NRF_SUCCESS) && (err_code != NRF_ERROR_INVALID_LENGTH))
+    {
+        uint32_t hci_error = rx_buffer_release(p_data);
+        if (hci_error != NRF_SUCCESS)
+        {
+            dfu_error_notify(p_dfu, hci_error);
+        }
+
+        dfu_error_notify(p_dfu, err_code);
+    }
+}
+
+
 /**@brief     Function for processing application data written by the peer to the DFU Packet
  *            Characteristic.
  *
@@ -436,54 +578,102 @@ static void app_data_process(ble_dfu_t * p_dfu, ble_dfu_evt_t * p_evt)
         return;
     }
 
-    dfu_update_packet_t dfu_pkt;
+    firmware_data_process(p_dfu, mp_rx_buffer, length);
+}
 
-    dfu_pkt.packet_type                      = DATA_PACKET;
-    dfu_pkt.params.data_packet.packet_length = length / sizeof(uint32_t);
-    dfu_pkt.params.data_packet.p_data_packet = (uint32_t *)mp_rx_buffer;
 
-    err_code = dfu_data_pkt_handle(&dfu_pkt);
+/**@brief     Function for processing an SDU received on the L2CAP CoC data channel.
+ *
+ * @details   An SDU carries firmware data just like a write to the DFU Packet Characteristic, only
+ *            larger. SDUs are accepted once the DFU Controller has started the Receive Firmware
+ *            Image procedure on the Control Point, each one counts as a packet for packet receipt
+ *            notifications. Compressed images are refused: a 1 KB SDU can decode to more than the
+ *            decompressed chunks waiting on pstorage can hold, they must be sent over GATT.
+ *
+ * @param[in] p_dfu     DFU Service Structure.
+ * @param[in] p_rx      SDU received event.
+ */
+static void l2cap_sdu_process(ble_dfu_t * p_dfu, ble_l2cap_evt_ch_rx_t const * p_rx)
+{
+    uint8_t      * p_data = p_rx->sdu_buf.p_data;
+    uint32_t const index  = l2cap_sdu_buf_index(p_data);
 
-    if (err_code == NRF_SUCCESS)
+    if (index == DFU_L2CAP_SDU_COUNT)
     {
-        m_num_of_firmware_bytes_rcvd += p_evt->evt.ble_dfu_pkt_write.len;
+        return;
+    }
+
+    m_l2cap_sd_mask &= ~(1UL << index);
 
-        // All the expected firmware data has been received and processed successfully.
-        // Response will be sent when flash operation for final packet is completed.
-        mp_final_packet = mp_rx_buffer;
+    if (m_pkt_type != PKT_TYPE_FIRMWARE_DATA)
+    {
+        // Not expecting firmware data. Ignore, as for the DFU Packet Characteristic.
+        l2cap_sdu_buf_give(index);
+        return;
     }
-    else if (err_code == NRF_ERROR_INVALID_LENGTH)
+
+    if ((p_rx->sdu_len == 0) || (p_rx->sdu_len > p_rx->sdu_buf.len) ||
+        ((p_rx->sdu_len & (sizeof(uint32_t) - 1)) != 0) ||
+        (dfu_init_flags_get() & DFU_INIT_FLAG_COMPRESSED))
     {
-        // Firmware data packet was handled successfully. And more firmware data is expected.
-        m_num_of_firmware_bytes_rcvd += p_evt->evt.ble_dfu_pkt_write.len;
+        // SDU truncated by the SoftDevice, data length is not a multiple of 4 (word size) or
+        // compressed image.
+        l2cap_sdu_buf_give(index);
 
-        // Check if a packet receipt notification is needed to be sent.
-        if (m_pkt_rcpt_notif_enabled)
-        {
-            // Decrement the counter for the number firmware packets needed for sending the
-            // next packet receipt notification.
-            m_pkt_notif_target_cnt--;
+        uint32_t err_code = ble_dfu_response_send(p_dfu,
+                                                  BLE_DFU_RECEIVE_APP_PROCEDURE,
+                                                  BLE_DFU_RESP_VAL_NOT_SUPPORTED);
+        APP_ERROR_CHECK(err_code);
+        return;
+    }
 
-            if (m_pkt_notif_target_cnt == 0)
-            {
-                err_code = ble_dfu_pkts_rcpt_notify(p_dfu, m_num_of_firmware_bytes_rcvd);
-                APP_ERROR_CHECK(err_code);
+    led_state(STATE_WRITING_STARTED);
 
-                // Reset the counter for the number of firmware packets.
-                m_pkt_notif_target_cnt = m_pkt_notif_target;
-            }
-        }
+    // Set before handing over, the DFU module may report the write as done right away.
+    m_l2cap_flash_mask |= (1UL << index);
+
+    firmware_data_process(p_dfu, p_data, p_rx->sdu_len);
+}
+
+
+/**@brief     Function for replying to a request from the peer to set up an L2CAP channel.
+ *
+ * @details   A single channel on DFU_L2CAP_PSM is accepted. No buffer is given in the reply, the
+ *            peer gets its credits as SDU buffers are handed over, see \ref l2cap_sdu_buf_give.
+ *
+ * @param[in] p_l2cap_evt  L2CAP Channel Setup Request event.
+ */
+static void l2cap_ch_setup_reply(ble_l2cap_evt_t const * p_l2cap_evt)
+{
+    uint32_t                    err_code;
+    uint16_t                    local_cid = p_l2cap_evt->local_cid;
+    ble_l2cap_ch_setup_params_t params;
+
+    memset(&params, 0, sizeof(params));
+
+    if (p_l2cap_evt->params.ch_setup_request.le_psm != DFU_L2CAP_PSM)
+    {
+        params.status = BLE_L2CAP_CH_STATUS_CODE_LE_PSM_NOT_SUPPORTED;
+    }
+    else if (m_l2cap_cid != BLE_L2CAP_CID_INVALID)
+    {
+        params.status = BLE_L2CAP_CH_STATUS_CODE_NO_RESOURCES;
     }
     else
     {
-        uint32_t hci_error = hci_mem_pool_rx_consume(mp_rx_buffer);
-        if (hci_error != NRF_SUCCESS)
-        {
-            dfu_error_notify(p_dfu, hci_error);
-        }
-
-        dfu_error_notify(p_dfu, err_code);
+        params.status           = BLE_L2CAP_CH_STATUS_CODE_SUCCESS;
+        params.rx_params.rx_mtu = DFU_L2CAP_SDU_SIZE;
+        params.rx_params.rx_mps = BLEL2CAP_MPS_MAX;
+
+        err_code = sd_ble_l2cap_ch_flow_control(p_l2cap_evt->conn_handle,
+                                                BLE_L2CAP_CID_INVALID,
+                                                DFU_L2CAP_SDU_CREDITS,
+                                                NULL);
+        APP_ERROR_CHECK(err_code);
     }
+
+    err_code = sd_ble_l2cap_ch_setup(p_l2cap_evt->conn_handle, &local_cid, &params);
+    APP_ERROR_CHECK(err_code);
 }
 
 
@@ -565,6 +755,16 @@ static void on_dfu_evt(ble_dfu_t * p_dfu, ble_dfu_evt_t * p_evt)
             break;
 
         case BLE_DFU_START:
+            // Dual transport DFU: USB already took the flash over
+            if (!dfu_transport_claim(true))
+            {
+                err_code = ble_dfu_response_send(p_dfu, BLE_DFU_START_PROCEDURE, BLE_DFU_RESP_VAL_OPER_FAILED);
+                APP_ERROR_CHECK(err_code);
+                break;
+            }
+
+            dfu_register_callback(dfu_cb_handler);
+
             m_pkt_type    = PKT_TYPE_START;
             m_update_mode = (uint8_t)p_evt->evt.ble_dfu_pkt_write.p_data[0];
             break;
@@ -745,6 +945,12 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
         case BLE_GAP_EVT_CONNECTED:
             m_conn_handle    = p_ble_evt->evt.gap_evt.conn_handle;
             m_is_advertising = false;
+
+            // A connected central keeps the DFU startup timeout from ending the session
+            {
+                extern volatile bool dfu_startup_packet_received;
+                dfu_startup_packet_received = true;
+            }
             break;
 
         case BLE_GAP_EVT_DISCONNECTED:
@@ -770,7 +976,9 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
                 advertising_start();
             }
 
-            m_conn_handle = BLE_CONN_HANDLE_INVALID;
+            m_conn_handle   = BLE_CONN_HANDLE_INVALID;
+            m_l2cap_cid     = BLE_L2CAP_CID_INVALID;
+            m_l2cap_sd_mask = 0;
 
             break;
 
@@ -905,6 +1113,46 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
         }
         break;
 
+        case BLE_L2CAP_EVT_CH_SETUP_REQUEST:
+            l2cap_ch_setup_reply(&p_ble_evt->evt.l2cap_evt);
+            break;
+
+        case BLE_L2CAP_EVT_CH_SETUP:
+            {
+                uint32_t i;
+
+                m_l2cap_cid = p_ble_evt->evt.l2cap_evt.local_cid;
+
+                for (i = 0; i < DFU_L2CAP_SDU_COUNT; i++)
+                {
+                    l2cap_sdu_buf_give(i);
+                }
+
+                // Ask for the longest link layer packet, so that each L2CAP PDU is sent in one.
+                (void) sd_ble_gap_data_length_update(m_conn_handle, NULL, NULL);
+            }
+            break;
+
+        case BLE_L2CAP_EVT_CH_RX:
+            l2cap_sdu_process(&m_dfu, &p_ble_evt->evt.l2cap_evt.params.rx);
+            break;
+
+        case BLE_L2CAP_EVT_CH_SDU_BUF_RELEASED:
+            {
+                uint32_t index = l2cap_sdu_buf_index(p_ble_evt->evt.l2cap_evt.params.ch_sdu_buf_released.sdu_buf.p_data);
+
+                if (index != DFU_L2CAP_SDU_COUNT)
+                {
+                    m_l2cap_sd_mask &= ~(1UL << index);
+                }
+            }
+            break;
+
+        case BLE_L2CAP_EVT_CH_RELEASED:
+            m_l2cap_cid     = BLE_L2CAP_CID_INVALID;
+            m_l2cap_sd_mask = 0;
+            break;
+
         default:
             // No implementation needed.
             break;
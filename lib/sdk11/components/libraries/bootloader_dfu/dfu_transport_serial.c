@@ -201,6 +201,15 @@ static void process_dfu_packet(void * p_event_data, uint16_t event_size)
     extern bool dfu_startup_packet_received;
     dfu_startup_packet_received = true;
 
+    // Dual transport DFU: BLE already took the flash over
+    if (!dfu_transport_claim(false))
+    {
+        data_queue_flush();
+        return;
+    }
+
+    dfu_register_callback(dfu_cb_handler);
+
     while (false == DATA_QUEUE_EMPTY())
     {
         // Fetch the element to be processed.
@@ -89,6 +89,7 @@ static inline bool is_sd_existed(void)
 #define DFU_UPDATE_SD                   0x01                                                            /**< Bit field indicating update of SoftDevice is ongoing. */
 #define DFU_UPDATE_BL                   0x02                                                            /**< Bit field indicating update of bootloader is ongoing. */
 #define DFU_UPDATE_APP                  0x04                                                            /**< Bit field indicating update of application is ongoing. */
+#define DFU_UPDATE_APP_DELTA            0x08                                                            /**< Bit field indicating application data is a delta patch against the installed application, used together with DFU_UPDATE_APP. */
 
 #define DFU_INIT_RX                     0x00                                                            /**< Op Code identifies for receiving init packet. */
 #define DFU_INIT_COMPLETE               0x01                                                            /**< Op Code identifies for transmission complete of init packet. */
@@ -137,7 +138,10 @@ typedef enum
     DFU_BANK_0_ERASED,                                                                                  /**< Status bank 0 erased.*/
     DFU_TIMEOUT,                                                                                        /**< Status timeout.*/
     DFU_RESET,                                                                                           /**< Status Reset to indicate current update procedure has been aborted and system should reset. */
-    DFU_UF2_BOOTLOADER_COMPLETE
+    DFU_UF2_BOOTLOADER_COMPLETE,
+    DFU_UPDATE_APP_STAGED,                                                                              /**< Status application received into QSPI staging slot, commit into bank 0 is done on next boot. */
+    DFU_UPDATE_APP_BACKED_UP,                                                                           /**< Status application pages borrowed by a bootloader update saved into QSPI staging slot, restored on next boot. */
+    DFU_UPDATE_SD_SWAP_PROGRESS                                                                         /**< Status SoftDevice swap progressed up to sd_swap_next, swap resumes from there after a reset. */
 } dfu_update_status_code_t;
 
 /**@brief Structure holding DFU complete event.
@@ -150,6 +154,13 @@ typedef struct
     uint32_t                 bl_size;                                                                   /**< Size of the recieved BootLoader. */
     uint32_t                 app_size;                                                                  /**< Size of the recieved Application. */
     uint32_t                 sd_image_start;                                                            /**< Location in flash where the received SoftDevice image is stored. */
+    uint32_t                 app_image_start;                                                           /**< Location in flash where the staged Application image is committed to. */
+    uint8_t const *          p_app_sha256;                                                              /**< SHA-256 digest of the received Application, NULL if not available. */
+    uint32_t                 app_digest_size;                                                           /**< Size of bank 0 covered by p_app_sha256, used with DFU_UPDATE_APP_STAGED. */
+    uint32_t                 xip_size;                                                                  /**< Size of the Application part executing in place from QSPI, 0 if none. */
+    uint16_t                 xip_crc;                                                                   /**< CRC of the Application part executing in place from QSPI. */
+    uint32_t                 sd_swap_next;                                                              /**< SoftDevice address the swap resumes from, used with DFU_UPDATE_SD_SWAP_PROGRESS. */
+    uint8_t const *          p_staged_pages;                                                            /**< Code pages of the staged Application to commit, see staged_pages of \ref bootloader_settings_t. NULL if all. */
 } dfu_update_status_t;
 
 /**@brief Update complete handler type. */
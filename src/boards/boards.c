@@ -50,6 +50,10 @@ void SysTick_Handler(void) {
   led_tick();
 }
 
+uint32_t board_millis(void) {
+  return _systick_count;
+}
+
 void button_init(uint32_t pin) {
   if (BUTTON_PULL == NRF_GPIO_PIN_PULLDOWN) {
     nrf_gpio_cfg_sense_input(pin, BUTTON_PULL, NRF_GPIO_PIN_SENSE_HIGH);
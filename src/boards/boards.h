@@ -1,163 +1,208 @@
-/*
- * The MIT License (MIT)
- *
- * Copyright (c) 2018 Ha Thach for Adafruit Industries
- *
- * Permission is hereby granted, free of charge, to any person obtaining a copy
- * of this software and associated documentation files (the "Software"), to deal
- * in the Software without restriction, including without limitation the rights
- * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
- * copies of the Software, and to permit persons to whom the Software is
- * furnished to do so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in
- * all copies or substantial portions of the Software.
- *
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
- * THE SOFTWARE.
- */
-
-#ifndef BOARDS_H
-#define BOARDS_H
-
-#include <stdbool.h>
-#include <stdint.h>
-#include <string.h>
-#include "nrf.h"
-#include "nrf_gpio.h"
-
-#include "board.h"
-
-#ifndef UF2_VOLUME_LABEL
-#define UF2_VOLUME_LABEL   "NRF52BOOT  "
-#endif
-
-#ifndef BUTTON_DFU
-#define BUTTON_DFU      BUTTON_1
-#endif
-
-#ifndef BUTTON_FRESET
-#define BUTTON_FRESET   BUTTON_2
-#endif
-
-// The primary LED is usually Red but not in all cases.
-#define LED_PRIMARY 0
-// The secondary LED, when available, is usually blue.
-#define LED_SECONDARY 1
-
-// Its more common for LEDs to be sinking to the MCU pin. Setting is only for individual LEDs, not
-// RGB LEDs.
-#ifndef LED_STATE_ON
-#define LED_STATE_ON   0
-#endif
-
-// Internal status colors are masked by this brightness setting.
-#ifndef BOARD_RGB_BRIGHTNESS
-#define BOARD_RGB_BRIGHTNESS 0x101010
-#endif
-
-// Power configuration - should we enable DC/DC converters? (requires inductors on board)
-#ifndef ENABLE_DCDC_0
-#define ENABLE_DCDC_0 0
-#endif
-#ifndef ENABLE_DCDC_1
-#define ENABLE_DCDC_1 0
-#endif
-
-// Helper function
-#define memclr(buffer, size)                memset(buffer, 0, size)
-#define varclr(_var)                        memclr(_var, sizeof(*(_var)))
-#define arrclr(_arr)                        memclr(_arr, sizeof(_arr))
-#define arrcount(_arr)                      ( sizeof(_arr) / sizeof(_arr[0]) )
-
-void board_init(void);
-void board_teardown(void);
-
-//--------------------------------------------------------------------+
-// LED
-//--------------------------------------------------------------------+
-
-enum {
-  STATE_BOOTLOADER_STARTED = 0,
-  STATE_USB_MOUNTED,
-  STATE_USB_UNMOUNTED,
-  STATE_FACTORY_RESET_STARTED,
-  STATE_FACTORY_RESET_FINISHED,
-  STATE_WRITING_STARTED,
-  STATE_WRITING_FINISHED,
-  STATE_BLE_CONNECTED,
-  STATE_BLE_DISCONNECTED
-};
-
-void led_pwm_init(uint32_t led_index, uint32_t led_pin);
-void led_pwm_teardown(void);
-void led_pwm_disable(uint32_t led_index);
-void led_pwm_enable(uint32_t led_index);
-void led_state(uint32_t state);
-void led_tick(void);
-
-//--------------------------------------------------------------------+
-// BUTTONS
-//--------------------------------------------------------------------+
-// Make sure we have at least two buttons (DFU + FRESET since DFU+FRST=OTA)
-#if BUTTONS_NUMBER < 2
-#error "At least two buttons required in the BSP (see 'BUTTONS_NUMBER')"
-#endif
-
-void button_init(uint32_t pin);
-bool button_pressed(uint32_t pin);
-
-bool is_ota(void);
-
-//--------------------------------------------------------------------+
-// Display
-//--------------------------------------------------------------------+
-#ifdef DISPLAY_PIN_SCK
-void board_display_init(void);
-void board_display_teardown(void);
-void board_display_draw_line(uint16_t y, uint8_t const* buf, size_t nbytes);
-void screen_draw_drag(void);
-#endif
-
-//--------------------------------------------------------------------+
-// DEBUG
-//--------------------------------------------------------------------+
-
-#ifdef CFG_DEBUG
-
-#include <stdio.h>
-
-#define PRINTF                printf
-#define PRINT_LOCATION()      printf("%s: %d:\n", __PRETTY_FUNCTION__, __LINE__)
-#define PRINT_MESS(x)         printf("%s: %d: %s \n"   , __FUNCTION__, __LINE__, (char*)(x))
-#define PRINT_STR(x)          printf("%s: %d: " #x " = %s\n"   , __FUNCTION__, __LINE__, (char*)(x) )
-#define PRINT_INT(x)          printf("%s: %d: " #x " = %ld\n"  , __FUNCTION__, __LINE__, (uint32_t) (x) )
-#define PRINT_HEX(x)          printf("%s: %d: " #x " = 0x%lX\n"  , __FUNCTION__, __LINE__, (uint32_t) (x) )
-
-#define PRINT_BUFFER(buf, n) \
-  do {\
-    uint8_t const* p8 = (uint8_t const*) (buf);\
-    printf(#buf ": ");\
-    for(uint32_t i=0; i<(n); i++) printf("%x ", p8[i]);\
-    printf("\n");\
-  }while(0)
-
-#else
-
-#define PRINTF(...)
-#define PRINT_LOCATION()
-#define PRINT_MESS(x)
-#define PRINT_STR(x)
-#define PRINT_INT(x)
-#define PRINT_HEX(x)
-#define PRINT_BUFFER(buf, n)
-
-#endif
-
-
-#endif
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2018 Ha Thach for Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef BOARDS_H
+#define BOARDS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "nrf.h"
+#include "nrf_gpio.h"
+
+#include "board.h"
+
+#ifndef UF2_VOLUME_LABEL
+#define UF2_VOLUME_LABEL   "NRF52BOOT  "
+#endif
+
+#ifndef BUTTON_DFU
+#define BUTTON_DFU      BUTTON_1
+#endif
+
+#ifndef BUTTON_FRESET
+#define BUTTON_FRESET   BUTTON_2
+#endif
+
+// The primary LED is usually Red but not in all cases.
+#define LED_PRIMARY 0
+// The secondary LED, when available, is usually blue.
+#define LED_SECONDARY 1
+
+// Its more common for LEDs to be sinking to the MCU pin. Setting is only for individual LEDs, not
+// RGB LEDs.
+#ifndef LED_STATE_ON
+#define LED_STATE_ON   0
+#endif
+
+// Internal status colors are masked by this brightness setting.
+#ifndef BOARD_RGB_BRIGHTNESS
+#define BOARD_RGB_BRIGHTNESS 0x101010
+#endif
+
+// Power configuration - should we enable DC/DC converters? (requires inductors on board)
+#ifndef ENABLE_DCDC_0
+#define ENABLE_DCDC_0 0
+#endif
+#ifndef ENABLE_DCDC_1
+#define ENABLE_DCDC_1 0
+#endif
+
+// Verify application SHA-256 (when recorded by DFU) on every boot. Costs a full pass over the
+// application image, debug builds print the time taken.
+#ifndef BOOT_VERIFY_APP_SHA256
+#define BOOT_VERIFY_APP_SHA256 0
+#endif
+
+// Programmed flash pages are read back, a mismatched page is erased and programmed again
+// up to this many times before giving up.
+#ifndef FLASH_VERIFY_RETRIES
+#define FLASH_VERIFY_RETRIES 2
+#endif
+
+// Application part executing in place from QSPI (board opts in with ENABLE_QSPI_XIP_APP).
+// QSPI_XIP_APP_OFFSET is mapped at 0x12000000 and QSPI clock raised to QSPI_XIP_SCK_FREQ before jumping to app
+#ifdef ENABLE_QSPI_XIP_APP
+#ifndef QSPI_XIP_APP_OFFSET
+#define QSPI_XIP_APP_OFFSET 0
+#endif
+#ifndef QSPI_XIP_APP_SIZE
+#define QSPI_XIP_APP_SIZE (1024*1024)
+#endif
+#ifndef QSPI_XIP_SCK_FREQ
+#define QSPI_XIP_SCK_FREQ NRF_QSPI_FREQ_32MDIV2
+#endif
+#endif
+
+// Helper function
+#define memclr(buffer, size)                memset(buffer, 0, size)
+#define varclr(_var)                        memclr(_var, sizeof(*(_var)))
+#define arrclr(_arr)                        memclr(_arr, sizeof(_arr))
+#define arrcount(_arr)                      ( sizeof(_arr) / sizeof(_arr[0]) )
+
+void board_init(void);
+void board_teardown(void);
+
+// milliseconds since board_init(), SysTick is stopped by board_teardown()
+uint32_t board_millis(void);
+
+//--------------------------------------------------------------------+
+// LED
+//--------------------------------------------------------------------+
+
+enum {
+  STATE_BOOTLOADER_STARTED = 0,
+  STATE_USB_MOUNTED,
+  STATE_USB_UNMOUNTED,
+  STATE_FACTORY_RESET_STARTED,
+  STATE_FACTORY_RESET_FINISHED,
+  STATE_WRITING_STARTED,
+  STATE_WRITING_FINISHED,
+  STATE_BLE_CONNECTED,
+  STATE_BLE_DISCONNECTED
+};
+
+void led_pwm_init(uint32_t led_index, uint32_t led_pin);
+void led_pwm_teardown(void);
+void led_pwm_disable(uint32_t led_index);
+void led_pwm_enable(uint32_t led_index);
+void led_state(uint32_t state);
+void led_tick(void);
+
+//--------------------------------------------------------------------+
+// BUTTONS
+//--------------------------------------------------------------------+
+// Make sure we have at least two buttons (DFU + FRESET since DFU+FRST=OTA)
+#if BUTTONS_NUMBER < 2
+#error "At least two buttons required in the BSP (see 'BUTTONS_NUMBER')"
+#endif
+
+void button_init(uint32_t pin);
+bool button_pressed(uint32_t pin);
+
+bool is_ota(void);
+
+// Opt-in per board (USB boards only): entering DFU without a transport asked for (button, double
+// reset, no valid app) listens on USB and BLE at once, the first one starting a transfer takes the
+// flash over
+#ifndef DFU_DUAL_TRANSPORT
+  #define DFU_DUAL_TRANSPORT  0
+#endif
+
+#if DFU_DUAL_TRANSPORT && !defined(NRF_USBD)
+  #error "DFU_DUAL_TRANSPORT requires USB"
+#endif
+
+bool is_dfu_dual(void);
+
+// Called by a transport before it touches the flash, false if the other transport owns it
+bool dfu_transport_claim(bool ota);
+
+//--------------------------------------------------------------------+
+// Display
+//--------------------------------------------------------------------+
+#ifdef DISPLAY_PIN_SCK
+void board_display_init(void);
+void board_display_teardown(void);
+void board_display_draw_line(uint16_t y, uint8_t const* buf, size_t nbytes);
+void screen_draw_drag(void);
+#endif
+
+//--------------------------------------------------------------------+
+// DEBUG
+//--------------------------------------------------------------------+
+
+#ifdef CFG_DEBUG
+
+#include <stdio.h>
+
+#define PRINTF                printf
+#define PRINT_LOCATION()      printf("%s: %d:\n", __PRETTY_FUNCTION__, __LINE__)
+#define PRINT_MESS(x)         printf("%s: %d: %s \n"   , __FUNCTION__, __LINE__, (char*)(x))
+#define PRINT_STR(x)          printf("%s: %d: " #x " = %s\n"   , __FUNCTION__, __LINE__, (char*)(x) )
+#define PRINT_INT(x)          printf("%s: %d: " #x " = %ld\n"  , __FUNCTION__, __LINE__, (uint32_t) (x) )
+#define PRINT_HEX(x)          printf("%s: %d: " #x " = 0x%lX\n"  , __FUNCTION__, __LINE__, (uint32_t) (x) )
+
+#define PRINT_BUFFER(buf, n) \
+  do {\
+    uint8_t const* p8 = (uint8_t const*) (buf);\
+    printf(#buf ": ");\
+    for(uint32_t i=0; i<(n); i++) printf("%x ", p8[i]);\
+    printf("\n");\
+  }while(0)
+
+#else
+
+#define PRINTF(...)
+#define PRINT_LOCATION()
+#define PRINT_MESS(x)
+#define PRINT_STR(x)
+#define PRINT_INT(x)
+#define PRINT_HEX(x)
+#define PRINT_BUFFER(buf, n)
+
+#endif
+
+
+#endif
@@ -77,6 +77,12 @@
 // QSPI Flash XIPOFFSET (start address after internal flash)
 #define QSPI_XIP_OFFSET 0x100000
 
+// Stage uf2 application updates at the top of QSPI and commit them into internal flash on next boot
+// #define ENABLE_QSPI_STAGING 1
+
+// Part of the application executes in place from QSPI, see QSPI_XIP_APP_OFFSET/SIZE in boards.h
+// #define ENABLE_QSPI_XIP_APP 1
+
 // QSPI Flash pins configuration
 #define QSPI_SCK_PIN 3
 #define QSPI_CSN_PIN 26
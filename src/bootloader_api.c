@@ -0,0 +1,339 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include "nrf.h"
+#include "nrf_sdm.h"
+#include "nrf_soc.h"
+#include "nrf_error.h"
+#include "nrfx_nvmc.h"
+#include "app_util.h"
+#include "crc16.h"
+#include "sha256.h"
+#include "dfu_types.h"
+#include "bootloader_util.h"
+#include "bootloader_api.h"
+
+//--------------------------------------------------------------------+
+// Everything here runs in the application context: only arguments, app stack and peripherals are
+// used. Bootloader .data/.bss overlaps the app RAM by then and must not be referenced.
+//--------------------------------------------------------------------+
+
+STATIC_ASSERT(sizeof(sha256_t) <= sizeof(bootloader_api_sha256_t));
+STATIC_ASSERT(sizeof(bootloader_api_t) <= BOOTLOADER_API_SIZE);
+
+static bool api_sd_enabled (void)
+{
+  uint8_t enabled = 0;
+
+  // without SoftDevice, MBR would forward the SVC to the app
+  if ( is_sd_existed() ) (void) sd_softdevice_is_enabled(&enabled);
+
+  return enabled != 0;
+}
+
+// Anything between SoftDevice and bootloader, including app data
+static bool api_in_app_flash (uint32_t addr, uint32_t len)
+{
+  return (addr >= CODE_REGION_1_START) && (len <= BOOTLOADER_REGION_START) && (addr <= BOOTLOADER_REGION_START - len);
+}
+
+//--------------------------------------------------------------------+
+// Internal flash
+//--------------------------------------------------------------------+
+
+static bool api_flash_is_blank (uint32_t addr, uint32_t len)
+{
+  uint32_t const* word = (uint32_t const*) addr;
+
+  for ( uint32_t i = 0; i < len / 4; i++ )
+  {
+    if ( word[i] != 0xFFFFFFFFUL ) return false;
+  }
+
+  return true;
+}
+
+static uint32_t api_flash_page_erase (uint32_t addr, bool* p_pending)
+{
+  if ( p_pending ) *p_pending = false;
+
+  if ( (addr % CODE_PAGE_SIZE) || !api_in_app_flash(addr, CODE_PAGE_SIZE) ) return NRF_ERROR_INVALID_ADDR;
+  if ( api_flash_is_blank(addr, CODE_PAGE_SIZE) ) return NRF_SUCCESS;
+
+  if ( api_sd_enabled() )
+  {
+    uint32_t const err = sd_flash_page_erase(addr / CODE_PAGE_SIZE);
+    if ( (err == NRF_SUCCESS) && p_pending ) *p_pending = true;
+    return err;
+  }
+
+  nrfx_nvmc_page_erase(addr);
+  return NRF_SUCCESS;
+}
+
+static uint32_t api_flash_program (uint32_t addr, void const* src, uint32_t len, bool* p_pending)
+{
+  if ( p_pending ) *p_pending = false;
+
+  if ( (addr & 3) || (((uint32_t) src) & 3) || !api_in_app_flash(addr, len) ) return NRF_ERROR_INVALID_ADDR;
+  if ( (len == 0) || (len & 3) || (addr / CODE_PAGE_SIZE != (addr + len - 1) / CODE_PAGE_SIZE) ) return NRF_ERROR_INVALID_LENGTH;
+
+  uint32_t const* current = (uint32_t const*) addr;
+  uint32_t const* data    = (uint32_t const*) src;
+  bool same = true;
+
+  // programming only clears bits
+  for ( uint32_t i = 0; i < len / 4; i++ )
+  {
+    if ( (current[i] & data[i]) != data[i] ) return NRF_ERROR_INVALID_STATE;
+    same = same && (current[i] == data[i]);
+  }
+
+  if ( same ) return NRF_SUCCESS;
+
+  if ( api_sd_enabled() )
+  {
+    uint32_t const err = sd_flash_write((uint32_t*) addr, data, len / 4);
+    if ( (err == NRF_SUCCESS) && p_pending ) *p_pending = true;
+    return err;
+  }
+
+  nrfx_nvmc_words_write(addr, data, len / 4);
+  return NRF_SUCCESS;
+}
+
+//--------------------------------------------------------------------+
+// QSPI
+//--------------------------------------------------------------------+
+#ifdef NRF_QSPI
+
+static uint32_t api_qspi_check (void const* buf, uint32_t addr, uint32_t len)
+{
+  if ( !NRF_QSPI->ENABLE ) return NRF_ERROR_INVALID_STATE;
+  if ( (addr & 3) || (((uint32_t) buf) & 3) || !nrfx_is_in_ram(buf) ) return NRF_ERROR_INVALID_ADDR;
+  if ( (len == 0) || (len & 3) ) return NRF_ERROR_INVALID_LENGTH;
+
+  return NRF_SUCCESS;
+}
+
+// READY is also signalled after write/erase once the flash is no longer busy
+static void api_qspi_run (volatile uint32_t* task)
+{
+  NRF_QSPI->EVENTS_READY = 0;
+  *task = 1;
+  while ( !NRF_QSPI->EVENTS_READY ) { }
+  NRF_QSPI->EVENTS_READY = 0;
+}
+
+static uint32_t api_qspi_read (uint32_t addr, void* dst, uint32_t len)
+{
+  uint32_t const err = api_qspi_check(dst, addr, len);
+  if ( err ) return err;
+
+  NRF_QSPI->READ.SRC = addr;
+  NRF_QSPI->READ.DST = (uint32_t) dst;
+  NRF_QSPI->READ.CNT = len;
+  api_qspi_run(&NRF_QSPI->TASKS_READSTART);
+
+  return NRF_SUCCESS;
+}
+
+static uint32_t api_qspi_program (uint32_t addr, void const* src, uint32_t len)
+{
+  uint32_t const err = api_qspi_check(src, addr, len);
+  if ( err ) return err;
+
+  NRF_QSPI->WRITE.DST = addr;
+  NRF_QSPI->WRITE.SRC = (uint32_t) src;
+  NRF_QSPI->WRITE.CNT = len;
+  api_qspi_run(&NRF_QSPI->TASKS_WRITESTART);
+
+  return NRF_SUCCESS;
+}
+
+static uint32_t api_qspi_erase_sector (uint32_t addr)
+{
+  uint32_t buf[16];
+
+  if ( addr % 4096 ) return NRF_ERROR_INVALID_ADDR;
+
+  // blank check through a small buffer on the caller's stack
+  bool blank = true;
+  for ( uint32_t offset = 0; blank && (offset < 4096); offset += sizeof(buf) )
+  {
+    uint32_t const err = api_qspi_read(addr + offset, buf, sizeof(buf));
+    if ( err ) return err;
+
+    for ( uint32_t i = 0; i < sizeof(buf) / 4; i++ ) blank = blank && (buf[i] == 0xFFFFFFFFUL);
+  }
+
+  if ( blank ) return NRF_SUCCESS;
+
+  NRF_QSPI->ERASE.PTR = addr;
+  NRF_QSPI->ERASE.LEN = QSPI_ERASE_LEN_LEN_4KB;
+  api_qspi_run(&NRF_QSPI->TASKS_ERASESTART);
+
+  return NRF_SUCCESS;
+}
+
+#else
+
+static uint32_t api_qspi_read (uint32_t addr, void* dst, uint32_t len)
+{
+  (void) addr; (void) dst; (void) len;
+  return NRF_ERROR_NOT_SUPPORTED;
+}
+
+static uint32_t api_qspi_program (uint32_t addr, void const* src, uint32_t len)
+{
+  (void) addr; (void) src; (void) len;
+  return NRF_ERROR_NOT_SUPPORTED;
+}
+
+static uint32_t api_qspi_erase_sector (uint32_t addr)
+{
+  (void) addr;
+  return NRF_ERROR_NOT_SUPPORTED;
+}
+
+#endif
+
+//--------------------------------------------------------------------+
+// Hash, DFU entry
+//--------------------------------------------------------------------+
+
+static void api_sha256_init (bootloader_api_sha256_t* ctx)
+{
+  sha256_init((sha256_t*) ctx);
+}
+
+static void api_sha256_update (bootloader_api_sha256_t* ctx, void const* data, uint32_t len)
+{
+  sha256_update((sha256_t*) ctx, data, len);
+}
+
+static void api_sha256_final (bootloader_api_sha256_t* ctx, uint8_t digest[32])
+{
+  sha256_final((sha256_t*) ctx, digest);
+}
+
+static void api_enter_dfu (uint8_t mode)
+{
+  if ( api_sd_enabled() )
+  {
+    sd_power_gpregret_clr(0, 0xFF);
+    sd_power_gpregret_set(0, mode);
+  }
+  else
+  {
+    NRF_POWER->GPREGRET = mode;
+  }
+
+  NVIC_SystemReset();
+}
+
+static void api_enter_dfu_warm (uint8_t mode, uint32_t timeout_ms)
+{
+  // CONTROL can only be cleared from privileged code, an unprivileged caller can't be handed over
+  if ( __get_CONTROL() & CONTROL_nPRIV_Msk ) return;
+
+  bootloader_handoff_t handoff =
+  {
+    .magic      = BOOTLOADER_HANDOFF_MAGIC,
+    .timeout_ms = timeout_ms,
+    .mode       = mode,
+  };
+  handoff.crc = crc16_compute((uint8_t const*) &handoff, offsetof(bootloader_handoff_t, crc), NULL);
+
+  // Bootloader enables the SoftDevice again with its own RAM layout if needed
+  if ( api_sd_enabled() ) (void) sd_softdevice_disable();
+
+  // Disable all interrupts. PRIMASK is left alone, the SVCs below must still be taken
+  NVIC->ICER[0]=0xFFFFFFFF;
+  NVIC->ICPR[0]=0xFFFFFFFF;
+#if defined(__NRF_NVIC_ISER_COUNT) && __NRF_NVIC_ISER_COUNT == 2
+  NVIC->ICER[1]=0xFFFFFFFF;
+  NVIC->ICPR[1]=0xFFFFFFFF;
+#endif
+  SysTick->CTRL = 0;
+
+#ifdef NRF_USBD
+  // Detach so that host enumerates the bootloader, USBD is started over by tinyusb
+  if ( NRF_USBD->ENABLE )
+  {
+    NRF_USBD->USBPULLUP = 0;
+    NRF_USBD->ENABLE    = 0;
+  }
+#endif
+
+  // Forward interrupts to the bootloader, reversed by bootloader_app_start() when it is done
+  if ( is_sd_existed() )
+  {
+    (void) sd_softdevice_vector_table_base_set(BOOTLOADER_REGION_START);
+  }
+  else
+  {
+    sd_mbr_command_t command =
+    {
+      .command = SD_MBR_COMMAND_IRQ_FORWARD_ADDRESS_SET,
+      .params.irq_forward_address_set.address = BOOTLOADER_REGION_START,
+    };
+    (void) sd_mbr_command(&command);
+  }
+
+  *((bootloader_handoff_t volatile*) BOOTLOADER_HANDOFF_ADDR) = handoff;
+
+  // Bootloader runs privileged on MSP like after a reset, an app thread on PSP would keep its stack
+  __set_CONTROL(0);
+  __ISB();
+
+  bootloader_util_app_start(BOOTLOADER_REGION_START);
+}
+
+__attribute__((used, section(".bootloaderApi")))
+const bootloader_api_t bootloader_api =
+{
+  .magic              = BOOTLOADER_API_MAGIC,
+  .version            = BOOTLOADER_API_VERSION,
+  .size               = sizeof(bootloader_api_t),
+  .bootloader_version = MK_BOOTLOADER_VERSION,
+
+  .flash_is_blank     = api_flash_is_blank,
+  .flash_page_erase   = api_flash_page_erase,
+  .flash_program      = api_flash_program,
+
+  .qspi_read          = api_qspi_read,
+  .qspi_program       = api_qspi_program,
+  .qspi_erase_sector  = api_qspi_erase_sector,
+
+  .crc16              = crc16_compute,
+
+  .sha256_init        = api_sha256_init,
+  .sha256_update      = api_sha256_update,
+  .sha256_final       = api_sha256_final,
+
+  .enter_dfu          = api_enter_dfu,
+  .enter_dfu_warm     = api_enter_dfu_warm,
+};
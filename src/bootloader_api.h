@@ -0,0 +1,140 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef BOOTLOADER_API_H_
+#define BOOTLOADER_API_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Services the bootloader offers to the application: SoftDevice aware internal flash with blank
+ * check, raw QSPI, CRC16 and SHA-256. The table sits in the last BOOTLOADER_API_SIZE bytes before
+ * the MBR params page, whose address is stored in UICR, so the app finds it without knowing the
+ * bootloader build. This header is self-contained and can be copied into application projects.
+ *
+ * Functions run in the caller's context on its stack, they never touch bootloader RAM. New
+ * functions are only appended: check version (or size) before using a member added later.
+ *
+ * Internal flash operations return immediately with *p_pending = true when the SoftDevice is
+ * enabled, the app then waits for NRF_EVT_FLASH_OPERATION_SUCCESS/ERROR as with sd_flash_*().
+ * Otherwise they complete synchronously through NVMC. Erase of a blank page and program of data
+ * already in flash are skipped, program returns NRF_ERROR_INVALID_STATE if it needs an erase.
+ *
+ * QSPI functions drive the peripheral registers directly: the app must have QSPI configured and
+ * activated, READY interrupt disabled while calling them. Buffers must be word aligned in RAM.
+ *
+ * enter_dfu_warm() jumps into the bootloader without a chip reset: the SoftDevice is disabled, all
+ * interrupts are disabled and forwarded to the bootloader, USB is detached, then the bootloader
+ * starts with mode and timeout from a handoff block retained in RAM. MBR init, app validation and
+ * double reset detection are skipped. Other peripherals used by the app (UARTE, TIMER, PWM,
+ * GPIOTE ...) must be stopped by the app before calling it. It must be called from privileged
+ * code, it returns without doing anything otherwise. timeout_ms applies to every mode, for OTA
+ * it ends once a central connects.
+ */
+
+#define BOOTLOADER_API_MAGIC      0x49504142UL  // "BAPI"
+#define BOOTLOADER_API_VERSION    2
+#define BOOTLOADER_API_SIZE       128
+
+#define BOOTLOADER_API_UICR_MBR_PARAMS   0x10001018UL
+
+// Values for enter_dfu(), same as GPREGRET magic handled by bootloader main.c
+enum {
+  BOOTLOADER_API_DFU_OTA        = 0xA8,
+  BOOTLOADER_API_DFU_SERIAL     = 0x4e,
+  BOOTLOADER_API_DFU_UF2        = 0x57,
+  BOOTLOADER_API_DFU_SKIP       = 0x6d,
+};
+
+// Warm handoff block, written by enter_dfu_warm() right below the double reset magic
+#define BOOTLOADER_HANDOFF_ADDR       0x20007F70UL
+#define BOOTLOADER_HANDOFF_MAGIC      0x46464f48UL  // "HOFF"
+#define BOOTLOADER_HANDOFF_NO_TIMEOUT 0xFFFFFFFFUL  // stay in DFU until updated or reset
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t timeout_ms;  // 0: default (3 seconds unless USB is enumerated), or BOOTLOADER_HANDOFF_NO_TIMEOUT
+  uint8_t  mode;        // BOOTLOADER_API_DFU_OTA, _SERIAL or _UF2
+  uint8_t  reserved;
+  uint16_t crc;         // crc16 of the above
+} bootloader_handoff_t;
+
+// Opaque SHA-256 context, allocated by the caller
+typedef struct
+{
+  uint32_t opaque[26];
+} bootloader_api_sha256_t;
+
+typedef struct
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;                // sizeof(bootloader_api_t) in this bootloader
+  uint32_t bootloader_version;  // (major << 16) | (minor << 8) | patch
+
+  // Internal flash, address from end of SoftDevice up to the bootloader
+  bool     (*flash_is_blank)    (uint32_t addr, uint32_t len);
+  uint32_t (*flash_page_erase)  (uint32_t addr, bool* p_pending);
+  uint32_t (*flash_program)     (uint32_t addr, void const* src, uint32_t len, bool* p_pending); // within one page
+
+  // QSPI, blocking. Erase is 4 KB sector and skipped if already blank
+  uint32_t (*qspi_read)         (uint32_t addr, void* dst, uint32_t len);
+  uint32_t (*qspi_program)      (uint32_t addr, void const* src, uint32_t len);
+  uint32_t (*qspi_erase_sector) (uint32_t addr);
+
+  uint16_t (*crc16)             (uint8_t const* data, uint32_t len, uint16_t const* p_crc);
+
+  void     (*sha256_init)       (bootloader_api_sha256_t* ctx);
+  void     (*sha256_update)     (bootloader_api_sha256_t* ctx, void const* data, uint32_t len);
+  void     (*sha256_final)      (bootloader_api_sha256_t* ctx, uint8_t digest[32]);
+
+  // Reset into the bootloader with one of BOOTLOADER_API_DFU_*, does not return
+  void     (*enter_dfu)         (uint8_t mode);
+
+  //------------- version 2 -------------//
+
+  // Jump into the bootloader with one of BOOTLOADER_API_DFU_* (except SKIP), does not return if privileged
+  void     (*enter_dfu_warm)    (uint8_t mode, uint32_t timeout_ms);
+} bootloader_api_t;
+
+// Locate the table, NULL if the bootloader does not provide one
+static inline bootloader_api_t const* bootloader_api_get(void)
+{
+  uint32_t const mbr_params = *((uint32_t const volatile*) BOOTLOADER_API_UICR_MBR_PARAMS);
+  if ( (mbr_params == 0xFFFFFFFFUL) || (mbr_params < BOOTLOADER_API_SIZE) ) return 0;
+
+  bootloader_api_t const* api = (bootloader_api_t const*) (mbr_params - BOOTLOADER_API_SIZE);
+  return (api->magic == BOOTLOADER_API_MAGIC) ? api : 0;
+}
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* BOOTLOADER_API_H_ */
@@ -0,0 +1,138 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include "decompress.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+#define WINDOW_MASK   (DECOMPRESS_WINDOW_SIZE - 1)
+
+enum
+{
+  STATE_TAG = 0,
+  STATE_LITERAL,
+  STATE_INDEX,
+  STATE_COUNT,
+  STATE_BACKREF,
+};
+
+// Accumulate bits into dc->acc until it has count bits, return false if input runs out first
+static bool get_bits (decompress_t* dc, uint8_t count, uint8_t const** p_in, uint8_t const* in_end)
+{
+  while ( dc->acc_len < count )
+  {
+    if ( dc->cur_mask == 0 )
+    {
+      if ( *p_in == in_end ) return false;
+
+      dc->cur_byte = *(*p_in)++;
+      dc->cur_mask = 0x80;
+    }
+
+    dc->acc = (dc->acc << 1) | ((dc->cur_byte & dc->cur_mask) ? 1 : 0);
+    dc->cur_mask >>= 1;
+    dc->acc_len++;
+  }
+
+  return true;
+}
+
+// Take accumulated value and reset accumulator for the next field
+static inline uint16_t take_bits (decompress_t* dc)
+{
+  uint16_t const value = dc->acc;
+  dc->acc = 0;
+  dc->acc_len = 0;
+  return value;
+}
+
+static inline uint8_t push_byte (decompress_t* dc, uint8_t b)
+{
+  dc->window[dc->head & WINDOW_MASK] = b;
+  dc->head++;
+  return b;
+}
+
+//--------------------------------------------------------------------+
+// API
+//--------------------------------------------------------------------+
+void decompress_init (decompress_t* dc)
+{
+  // window starts zeroed, same as heatshrink reference implementation
+  memset(dc, 0, sizeof(decompress_t));
+  dc->state = STATE_TAG;
+}
+
+uint32_t decompress_run (decompress_t* dc, uint8_t const* in, uint32_t in_len, uint32_t* in_used,
+                         uint8_t* out, uint32_t out_size)
+{
+  uint8_t const* p_in = in;
+  uint8_t const* const in_end = in + in_len;
+  uint32_t count = 0;
+
+  while ( count < out_size )
+  {
+    if ( dc->state == STATE_TAG )
+    {
+      if ( !get_bits(dc, 1, &p_in, in_end) ) break;
+      dc->state = take_bits(dc) ? STATE_LITERAL : STATE_INDEX;
+    }
+    else if ( dc->state == STATE_LITERAL )
+    {
+      if ( !get_bits(dc, 8, &p_in, in_end) ) break;
+      out[count++] = push_byte(dc, (uint8_t) take_bits(dc));
+      dc->state = STATE_TAG;
+    }
+    else if ( dc->state == STATE_INDEX )
+    {
+      if ( !get_bits(dc, DECOMPRESS_WINDOW_BITS, &p_in, in_end) ) break;
+      dc->offset = take_bits(dc) + 1;
+      dc->state = STATE_COUNT;
+    }
+    else if ( dc->state == STATE_COUNT )
+    {
+      if ( !get_bits(dc, DECOMPRESS_LOOKAHEAD_BITS, &p_in, in_end) ) break;
+      dc->remaining = take_bits(dc) + 1;
+      dc->state = STATE_BACKREF;
+    }
+    else
+    {
+      // back reference may overlap with itself (run-length), copy byte by byte
+      while ( dc->remaining && count < out_size )
+      {
+        out[count++] = push_byte(dc, dc->window[(dc->head - dc->offset) & WINDOW_MASK]);
+        dc->remaining--;
+      }
+
+      if ( dc->remaining == 0 ) dc->state = STATE_TAG;
+    }
+  }
+
+  if ( in_used ) *in_used = (uint32_t) (p_in - in);
+
+  return count;
+}
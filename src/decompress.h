@@ -0,0 +1,79 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef DECOMPRESS_H_
+#define DECOMPRESS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Streaming decoder for heatshrink-compatible LZSS streams.
+// Bits are read MSB first:
+//  - tag 1: 8-bit literal
+//  - tag 0: back reference with WINDOW_BITS index (offset - 1) then LOOKAHEAD_BITS count (length - 1)
+// Host must compress with matching parameters e.g heatshrink -w 8 -l 4 or tools/uf2compress.py
+#ifndef DECOMPRESS_WINDOW_BITS
+#define DECOMPRESS_WINDOW_BITS      8
+#endif
+
+#ifndef DECOMPRESS_LOOKAHEAD_BITS
+#define DECOMPRESS_LOOKAHEAD_BITS   4
+#endif
+
+#define DECOMPRESS_WINDOW_SIZE      (1UL << DECOMPRESS_WINDOW_BITS)
+
+typedef struct
+{
+  uint8_t  window[DECOMPRESS_WINDOW_SIZE];
+  uint16_t head;       // next write position in window
+
+  uint16_t offset;     // current back reference
+  uint16_t remaining;
+
+  uint16_t acc;        // bits accumulated for current field
+  uint8_t  acc_len;
+  uint8_t  cur_byte;   // input byte being consumed
+  uint8_t  cur_mask;   // next bit of cur_byte, 0 if need another byte
+
+  uint8_t  state;
+} decompress_t;
+
+void decompress_init (decompress_t* dc);
+
+// Decode from in[] into out[] until out_size bytes are produced or input is exhausted.
+// Number of input bytes used is returned in in_used (can be NULL), return number of
+// output bytes. State is kept in dc so that stream can be fed in arbitrary pieces.
+uint32_t decompress_run (decompress_t* dc, uint8_t const* in, uint32_t in_len, uint32_t* in_used,
+                         uint8_t* out, uint32_t out_size);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* DECOMPRESS_H_ */
@@ -0,0 +1,134 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include "delta.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+#define OP_NONE   0xff
+
+static inline uint32_t u32_decode (uint8_t const* p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline uint32_t hdr_size (uint8_t op)
+{
+  return (op == DELTA_OP_COPY) ? 9 : 5;
+}
+
+//--------------------------------------------------------------------+
+// API
+//--------------------------------------------------------------------+
+void delta_init (delta_t* dt, void const* base, uint32_t base_size, uint32_t page_size)
+{
+  memset(dt, 0, sizeof(delta_t));
+
+  dt->base      = (uint8_t const*) base;
+  dt->base_size = base_size;
+  dt->page_size = page_size;
+  dt->op        = OP_NONE;
+}
+
+int32_t delta_run (delta_t* dt, uint8_t const* in, uint32_t in_len, uint32_t* in_used,
+                   uint8_t* out, uint32_t out_size)
+{
+  uint8_t const* p_in = in;
+  uint8_t const* const in_end = in + in_len;
+  uint32_t count = 0;
+
+  while ( count < out_size )
+  {
+    if ( dt->op == OP_NONE )
+    {
+      // gather command header, it can be split across packets
+      while ( p_in < in_end )
+      {
+        dt->hdr[dt->hdr_len++] = *p_in++;
+        if ( dt->hdr[0] > DELTA_OP_INSERT ) return -1;
+        if ( dt->hdr_len == hdr_size(dt->hdr[0]) ) break;
+      }
+
+      if ( !dt->hdr_len || dt->hdr_len < hdr_size(dt->hdr[0]) ) break;
+
+      dt->op      = dt->hdr[0];
+      dt->hdr_len = 0;
+
+      if ( dt->op == DELTA_OP_COPY )
+      {
+        dt->src       = u32_decode(dt->hdr + 1);
+        dt->remaining = u32_decode(dt->hdr + 5);
+
+        if ( (dt->src > dt->base_size) || (dt->remaining > dt->base_size - dt->src) ) return -1;
+      }
+      else
+      {
+        dt->remaining = u32_decode(dt->hdr + 1);
+      }
+
+      if ( dt->remaining == 0 ) dt->op = OP_NONE;
+    }
+    else if ( dt->op == DELTA_OP_COPY )
+    {
+      uint32_t const page_start = dt->out_pos & ~(dt->page_size - 1);
+      uint32_t n = out_size - count;
+      if ( n > dt->remaining ) n = dt->remaining;
+
+      // source must still hold old data, i.e not in a page that is already rewritten
+      if ( dt->src < page_start ) return -1;
+
+      memcpy(out + count, dt->base + dt->src, n);
+
+      dt->src       += n;
+      dt->remaining -= n;
+      dt->out_pos   += n;
+      count         += n;
+
+      if ( dt->remaining == 0 ) dt->op = OP_NONE;
+    }
+    else
+    {
+      uint32_t n = out_size - count;
+      if ( n > dt->remaining ) n = dt->remaining;
+      if ( n > (uint32_t) (in_end - p_in) ) n = (uint32_t) (in_end - p_in);
+      if ( n == 0 ) break;
+
+      memcpy(out + count, p_in, n);
+
+      p_in          += n;
+      dt->remaining -= n;
+      dt->out_pos   += n;
+      count         += n;
+
+      if ( dt->remaining == 0 ) dt->op = OP_NONE;
+    }
+  }
+
+  if ( in_used ) *in_used = (uint32_t) (p_in - in);
+
+  return (int32_t) count;
+}
@@ -0,0 +1,77 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef DELTA_H_
+#define DELTA_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Streaming applier for in-place binary delta patches.
+// Patch is a sequence of little endian commands producing the new image from offset 0:
+//  - DELTA_OP_COPY   : u8 op, u32 src, u32 len  copy len bytes from old image at offset src
+//  - DELTA_OP_INSERT : u8 op, u32 len, data[len] insert literal bytes
+//
+// The new image is written over the old one in ascending page order, therefore a copy must
+// only read from pages which are not yet rewritten: src >= start of the output page.
+// Patches are generated by tools/dfudelta.py
+enum
+{
+  DELTA_OP_COPY   = 0,
+  DELTA_OP_INSERT = 1,
+};
+
+typedef struct
+{
+  uint8_t const* base;      // old image, memory mapped
+  uint32_t base_size;
+  uint32_t page_size;       // granularity that output is rewritten in place
+  uint32_t out_pos;         // number of bytes produced so far
+
+  uint32_t src;             // current copy source offset
+  uint32_t remaining;       // bytes left for current command
+  uint8_t  op;
+
+  uint8_t  hdr[9];          // command header being received
+  uint8_t  hdr_len;
+} delta_t;
+
+void delta_init (delta_t* dt, void const* base, uint32_t base_size, uint32_t page_size);
+
+// Apply patch from in[] and produce up to out_size bytes of new image into out[].
+// Output must not cross a page boundary within a call. Number of input bytes used is returned
+// in in_used. Return number of produced bytes, or -1 if patch is invalid.
+int32_t delta_run (delta_t* dt, uint8_t const* in, uint32_t in_len, uint32_t* in_used,
+                   uint8_t* out, uint32_t out_size);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* DELTA_H_ */
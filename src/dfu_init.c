@@ -73,6 +73,7 @@
 #include <dfu_types.h>
 #include "nrf_error.h"
 #include "crc16.h"
+#include "ed25519.h"
 
 /* ADAFRUIT
  * - All firmware init data must has Device Type ADAFRUIT_DEVICE_TYPE (nrf52832 and nrf52840)
@@ -96,11 +97,29 @@
 
 
 #define DFU_INIT_PACKET_EXT_LENGTH_MIN      2                       //< Minimum length of the extended init packet. The extended init packet may contain a CRC, a HASH, or other data. This value must be changed according to the requirements of the system. The template uses a minimum value of two in order to hold a CRC. */
-#define DFU_INIT_PACKET_EXT_LENGTH_MAX      10                      //< Maximum length of the extended init packet. The extended init packet may contain a CRC, a HASH, or other data. This value must be changed according to the requirements of the system. The template uses a maximum value of 10 in order to hold a CRC and any padded data on transport layer without overflow. */
+#define DFU_INIT_PACKET_EXT_LENGTH_MAX      112                     //< Maximum length of the extended init packet. The extended init packet may contain a CRC, a HASH, or other data. This value must be changed according to the requirements of the system. Adafruit uses 112 to hold CRC, flags, SHA-256 digest, signature, delta base information and any padded data on transport layer without overflow. */
 
 static uint8_t m_extended_packet[DFU_INIT_PACKET_EXT_LENGTH_MAX];   //< Data array for storage of the extended data received. The extended data follows the normal init data of type \ref dfu_init_packet_t. Extended data can be used for a CRC, hash, signature, or other data. */
 static uint8_t m_extended_packet_length;                            //< Length of the extended data received with init packet. */
 
+/* ADAFRUIT
+ * Extended data layout: CRC16 (2 bytes) followed by optional flags (2 bytes).
+ * Older tools pad the extended data with zeroes, which reads as no flags set.
+ * - DFU_INIT_FLAG_SHA256: SHA-256 digest of the image (32 bytes) follows the flags.
+ * - DFU_INIT_FLAG_SIGNED: Ed25519 signature of that digest (64 bytes) follows the digest.
+ * - Delta updates then append the CRC16 (2 bytes) and size (4 bytes) of the base image they apply to.
+ */
+#define DFU_INIT_EXT_FLAGS_OFFSET           2                       //< Offset of the flags field in the extended init packet. */
+#define DFU_INIT_EXT_SHA256_OFFSET          4                       //< Offset of the SHA-256 digest in the extended init packet. */
+#define DFU_INIT_SHA256_SIZE                32                      //< Size of the SHA-256 digest. */
+#define DFU_INIT_EXT_SIGNATURE_OFFSET       (DFU_INIT_EXT_SHA256_OFFSET + DFU_INIT_SHA256_SIZE) //< Offset of the signature in the extended init packet. */
+
+#ifdef DFU_SIGNING_PUBKEY
+static const uint8_t m_signing_pubkey[ED25519_PUBLIC_KEY_SIZE] = DFU_SIGNING_PUBKEY; //< Public key updates must be signed with. */
+#endif
+
+static uint8_t const * dfu_init_signature_get(void);
+
 
 uint32_t dfu_init_prevalidate(uint8_t * p_init_data, uint32_t init_data_len, uint8_t image_type)
 {
@@ -120,7 +139,8 @@ uint32_t dfu_init_prevalidate(uint8_t * p_init_data, uint32_t init_data_len, uin
 
     m_extended_packet_length = ((uint32_t)p_init_data + init_data_len) -
                                (uint32_t)&p_init_packet->softdevice[p_init_packet->softdevice_len];
-    if (m_extended_packet_length < DFU_INIT_PACKET_EXT_LENGTH_MIN)
+    if ((m_extended_packet_length < DFU_INIT_PACKET_EXT_LENGTH_MIN) ||
+        (m_extended_packet_length > DFU_INIT_PACKET_EXT_LENGTH_MAX))
     {
         return NRF_ERROR_INVALID_LENGTH;
     }
@@ -135,6 +155,15 @@ uint32_t dfu_init_prevalidate(uint8_t * p_init_data, uint32_t init_data_len, uin
            &p_init_packet->softdevice[p_init_packet->softdevice_len],
            m_extended_packet_length);
 
+#ifdef DFU_SIGNING_PUBKEY
+    // Refuse unsigned images before anything is erased. The signature itself is verified against
+    // the digest of the received image in dfu_init_signature_check().
+    if (dfu_init_signature_get() == NULL)
+    {
+        return NRF_ERROR_FORBIDDEN;
+    }
+#endif
+
     /** [DFU init application version] */
     // To support application versioning, this check should be updated.
     // This template allows for any application to be installed. However, 
@@ -212,3 +241,112 @@ uint32_t dfu_init_postvalidate(uint8_t * p_image, uint32_t image_len)
     return NRF_SUCCESS;
 }
 
+
+uint16_t dfu_init_flags_get(void)
+{
+    if (m_extended_packet_length < DFU_INIT_EXT_FLAGS_OFFSET + sizeof(uint16_t))
+    {
+        return 0;
+    }
+
+    return uint16_decode(&m_extended_packet[DFU_INIT_EXT_FLAGS_OFFSET]);
+}
+
+
+uint8_t const * dfu_init_sha256_get(void)
+{
+    if ((dfu_init_flags_get() & DFU_INIT_FLAG_SHA256) &&
+        (m_extended_packet_length >= DFU_INIT_EXT_SHA256_OFFSET + DFU_INIT_SHA256_SIZE))
+    {
+        return &m_extended_packet[DFU_INIT_EXT_SHA256_OFFSET];
+    }
+
+    return NULL;
+}
+
+
+/**@brief Function for getting the signature of the image digest, NULL if the image is not signed.
+ */
+static uint8_t const * dfu_init_signature_get(void)
+{
+    if ((dfu_init_sha256_get() != NULL) &&
+        (dfu_init_flags_get() & DFU_INIT_FLAG_SIGNED) &&
+        (m_extended_packet_length >= DFU_INIT_EXT_SIGNATURE_OFFSET + ED25519_SIGNATURE_SIZE))
+    {
+        return &m_extended_packet[DFU_INIT_EXT_SIGNATURE_OFFSET];
+    }
+
+    return NULL;
+}
+
+
+#ifdef DFU_SIGNING_PUBKEY
+bool dfu_init_signature_verify(uint8_t const * p_digest, uint8_t const * p_signature)
+{
+    return ed25519_verify(p_signature, p_digest, DFU_INIT_SHA256_SIZE, m_signing_pubkey);
+}
+#endif
+
+
+uint32_t dfu_init_signature_check(uint8_t const * p_digest)
+{
+#ifdef DFU_SIGNING_PUBKEY
+    uint8_t const * p_signature = dfu_init_signature_get();
+
+    if ((p_signature == NULL) || !dfu_init_signature_verify(p_digest, p_signature))
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+#else
+    // No key built in, a signature is carried along but cannot be checked.
+    (void) p_digest;
+#endif
+
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for getting the offset of the delta base image information in extended data.
+ */
+static uint32_t delta_base_offset(void)
+{
+    if (dfu_init_signature_get() != NULL)
+    {
+        return DFU_INIT_EXT_SIGNATURE_OFFSET + ED25519_SIGNATURE_SIZE;
+    }
+
+    return DFU_INIT_EXT_SHA256_OFFSET + ((dfu_init_sha256_get() != NULL) ? DFU_INIT_SHA256_SIZE : 0);
+}
+
+
+uint32_t dfu_init_delta_base_check(void)
+{
+    uint32_t const offset = delta_base_offset();
+
+    if (m_extended_packet_length < offset + sizeof(uint16_t) + sizeof(uint32_t))
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    uint16_t const base_crc  = uint16_decode(&m_extended_packet[offset]);
+    uint32_t const base_size = uint32_decode(&m_extended_packet[offset + sizeof(uint16_t)]);
+
+    if ((base_size == 0) || (base_size > DFU_IMAGE_MAX_SIZE_FULL))
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    // Patch is only meaningful against the exact image it was generated from.
+    if (crc16_compute((uint8_t const *)DFU_BANK_0_REGION_START, base_size, NULL) != base_crc)
+    {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t dfu_init_delta_base_size(void)
+{
+    return uint32_decode(&m_extended_packet[delta_base_offset() + sizeof(uint16_t)]);
+}
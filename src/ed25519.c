@@ -0,0 +1,654 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+#include "ed25519.h"
+
+/* Compact Ed25519 verification for the bootloader.
+ *
+ * Field elements mod p = 2^255 - 19 use 10 signed limbs of alternating 26/25 bits (radix 2^25.5)
+ * so that limb products fit 64-bit accumulators, which Cortex-M4 computes with SMLAL. Points are
+ * in extended twisted Edwards coordinates. [S]B - [k]A is evaluated with a joint double-and-add
+ * (Shamir's trick), roughly 250 doublings and 190 additions per signature.
+ */
+
+//--------------------------------------------------------------------+
+// SHA-512, only used to hash R || A || M
+//--------------------------------------------------------------------+
+#define ROR64(x, n)   (((x) >> (n)) | ((x) << (64 - (n))))
+
+typedef struct
+{
+  uint64_t state[8];
+  uint32_t count;
+  uint32_t buf_len;
+  uint8_t  buf[128];
+} sha512_t;
+
+static const uint64_t K512[80] =
+{
+  0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+  0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+  0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+  0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+  0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+  0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+  0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+  0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+  0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+  0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+  0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+  0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+  0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+  0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+  0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+  0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+  0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+  0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+  0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+  0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+static void sha512_transform (uint64_t state[8], uint8_t const block[128])
+{
+  uint64_t w[16];
+  uint64_t v[8];
+
+  memcpy(v, state, sizeof(v));
+
+  for ( uint32_t i = 0; i < 80; i++ )
+  {
+    uint64_t wi;
+
+    if ( i < 16 )
+    {
+      memcpy(&wi, block + 8*i, 8);
+      wi = w[i] = __builtin_bswap64(wi);
+    }
+    else
+    {
+      uint64_t const w2  = w[(i - 2) & 15];
+      uint64_t const w15 = w[(i - 15) & 15];
+      wi = w[i & 15] += (ROR64(w2, 19) ^ ROR64(w2, 61) ^ (w2 >> 6)) + w[(i - 7) & 15] +
+                        (ROR64(w15, 1) ^ ROR64(w15, 8) ^ (w15 >> 7));
+    }
+
+    uint64_t const t1 = v[7] + (ROR64(v[4], 14) ^ ROR64(v[4], 18) ^ ROR64(v[4], 41)) +
+                        (v[6] ^ (v[4] & (v[5] ^ v[6]))) + K512[i] + wi;
+    uint64_t const t2 = (ROR64(v[0], 28) ^ ROR64(v[0], 34) ^ ROR64(v[0], 39)) +
+                        ((v[0] & v[1]) | (v[2] & (v[0] | v[1])));
+
+    memmove(v + 1, v, 7 * sizeof(uint64_t));
+    v[4] += t1;
+    v[0]  = t1 + t2;
+  }
+
+  for ( uint32_t i = 0; i < 8; i++ ) state[i] += v[i];
+}
+
+static void sha512_init (sha512_t* ctx)
+{
+  static const uint64_t iv[8] =
+  {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+  };
+
+  memcpy(ctx->state, iv, sizeof(iv));
+  ctx->count   = 0;
+  ctx->buf_len = 0;
+}
+
+static void sha512_update (sha512_t* ctx, void const* data, uint32_t len)
+{
+  uint8_t const* p_data = (uint8_t const*) data;
+
+  ctx->count += len;
+
+  while ( len )
+  {
+    uint32_t const n = (len < sizeof(ctx->buf) - ctx->buf_len) ? len : (sizeof(ctx->buf) - ctx->buf_len);
+
+    memcpy(ctx->buf + ctx->buf_len, p_data, n);
+    ctx->buf_len += n;
+    p_data       += n;
+    len          -= n;
+
+    if ( ctx->buf_len == sizeof(ctx->buf) )
+    {
+      sha512_transform(ctx->state, ctx->buf);
+      ctx->buf_len = 0;
+    }
+  }
+}
+
+static void sha512_final (sha512_t* ctx, uint8_t digest[64])
+{
+  ctx->buf[ctx->buf_len++] = 0x80;
+
+  if ( ctx->buf_len > sizeof(ctx->buf) - 16 )
+  {
+    memset(ctx->buf + ctx->buf_len, 0, sizeof(ctx->buf) - ctx->buf_len);
+    sha512_transform(ctx->state, ctx->buf);
+    ctx->buf_len = 0;
+  }
+
+  // 128-bit big endian bit count, messages here are tiny
+  memset(ctx->buf + ctx->buf_len, 0, sizeof(ctx->buf) - ctx->buf_len);
+  uint64_t const bits = __builtin_bswap64(((uint64_t) ctx->count) << 3);
+  memcpy(ctx->buf + sizeof(ctx->buf) - 8, &bits, 8);
+  sha512_transform(ctx->state, ctx->buf);
+
+  for ( uint32_t i = 0; i < 8; i++ )
+  {
+    uint64_t const v = __builtin_bswap64(ctx->state[i]);
+    memcpy(digest + 8*i, &v, 8);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Field arithmetic mod 2^255 - 19
+//--------------------------------------------------------------------+
+typedef int32_t fe[10];
+
+// limb i holds 26 bits if i is even, 25 bits if odd
+#define LIMB_BITS(i)  (((i) & 1) ? 25 : 26)
+
+// Carry 64-bit accumulators into limbs bounded by 2^25 (even) and 2^24 (odd) in magnitude
+static void fe_carry (fe h, int64_t t[10])
+{
+  for ( int i = 0; i < 10; i++ )
+  {
+    int const bits = LIMB_BITS(i);
+    int64_t const c = (t[i] + (1LL << (bits - 1))) >> bits;
+
+    t[i] -= c * (1LL << bits);
+
+    // carry out of the top limb wraps around as 2^255 = 19
+    if ( i < 9 ) t[i + 1] += c;
+    else         t[0]     += 19 * c;
+  }
+
+  int64_t const c = (t[0] + (1LL << 25)) >> 26;
+  t[0] -= c * (1LL << 26);
+  t[1] += c;
+
+  for ( int i = 0; i < 10; i++ ) h[i] = (int32_t) t[i];
+}
+
+static void fe_set (fe h, int32_t v)
+{
+  memset(h, 0, sizeof(fe));
+  h[0] = v;
+}
+
+static void fe_add (fe h, fe const f, fe const g)
+{
+  int64_t t[10];
+  for ( int i = 0; i < 10; i++ ) t[i] = (int64_t) f[i] + g[i];
+  fe_carry(h, t);
+}
+
+static void fe_sub (fe h, fe const f, fe const g)
+{
+  int64_t t[10];
+  for ( int i = 0; i < 10; i++ ) t[i] = (int64_t) f[i] - g[i];
+  fe_carry(h, t);
+}
+
+static void fe_neg (fe h, fe const f)
+{
+  fe zero;
+  fe_set(zero, 0);
+  fe_sub(h, zero, f);
+}
+
+static void fe_mul (fe h, fe const f, fe const g)
+{
+  int64_t t[10] = { 0 };
+
+  for ( int i = 0; i < 10; i++ )
+  {
+    for ( int j = 0; j < 10; j++ )
+    {
+      // two odd limbs are each half a bit short of their weight in radix 2^25.5
+      int64_t const p = (int64_t) f[i] * ((i & j & 1) ? 2 * g[j] : g[j]);
+
+      if ( i + j < 10 ) t[i + j]      += p;
+      else              t[i + j - 10] += 19 * p;
+    }
+  }
+
+  fe_carry(h, t);
+}
+
+static void fe_sq (fe h, fe const f)
+{
+  fe_mul(h, f, f);
+}
+
+static void fe_sq_n (fe h, fe const f, int n)
+{
+  fe_sq(h, f);
+  while ( --n ) fe_sq(h, h);
+}
+
+// Load 255-bit little endian value, top bit is ignored
+static void fe_frombytes (fe h, uint8_t const s[32])
+{
+  int64_t t[10];
+  uint32_t offset = 0;
+
+  for ( int i = 0; i < 10; i++ )
+  {
+    int const bits = LIMB_BITS(i);
+    uint32_t const idx = offset / 8;
+    uint64_t v = 0;
+
+    for ( uint32_t k = 0; k < 5 && idx + k < 32; k++ ) v |= ((uint64_t) s[idx + k]) << (8*k);
+
+    t[i]    = (int64_t) ((v >> (offset % 8)) & ((1ULL << bits) - 1));
+    offset += bits;
+  }
+
+  fe_carry(h, t);
+}
+
+// Store fully reduced value
+static void fe_tobytes (uint8_t s[32], fe const f)
+{
+  int32_t h[10];
+  memcpy(h, f, sizeof(h));
+
+  // q = floor(h / p), limbs are carried so it is -1, 0 or 1
+  int32_t q = (19 * h[9] + (1 << 24)) >> 25;
+  for ( int i = 0; i < 10; i++ ) q = (h[i] + q) >> LIMB_BITS(i);
+
+  // h - q*p, the final carry out of 2^255 is dropped
+  h[0] += 19 * q;
+  for ( int i = 0; i < 9; i++ )
+  {
+    h[i + 1] += h[i] >> LIMB_BITS(i);
+    h[i]     &= (1 << LIMB_BITS(i)) - 1;
+  }
+  h[9] &= (1 << 25) - 1;
+
+  uint64_t acc = 0;
+  int acc_bits = 0;
+  int idx = 0;
+
+  for ( int i = 0; i < 10; i++ )
+  {
+    acc      |= ((uint64_t) h[i]) << acc_bits;
+    acc_bits += LIMB_BITS(i);
+
+    while ( acc_bits >= 8 )
+    {
+      s[idx++]   = (uint8_t) acc;
+      acc      >>= 8;
+      acc_bits  -= 8;
+    }
+  }
+
+  s[idx] = (uint8_t) acc;
+}
+
+static bool fe_isnegative (fe const f)
+{
+  uint8_t s[32];
+  fe_tobytes(s, f);
+  return s[0] & 1;
+}
+
+static bool fe_equal (fe const f, fe const g)
+{
+  uint8_t s1[32], s2[32];
+  fe_tobytes(s1, f);
+  fe_tobytes(s2, g);
+  return 0 == memcmp(s1, s2, 32);
+}
+
+// z^(2^250 - 1), also returns z^11 which both exponentiations below need
+static void fe_pow2250 (fe h, fe z11, fe const z)
+{
+  fe t0, t1, t2;
+
+  fe_sq(t0, z);                 // 2
+  fe_sq_n(t1, t0, 2);           // 8
+  fe_mul(t1, z, t1);            // 9
+  fe_mul(z11, t0, t1);          // 11
+  fe_sq(t0, z11);               // 22
+  fe_mul(t0, t1, t0);           // 2^5 - 1
+  fe_sq_n(t1, t0, 5);
+  fe_mul(t0, t1, t0);           // 2^10 - 1
+  fe_sq_n(t1, t0, 10);
+  fe_mul(t1, t1, t0);           // 2^20 - 1
+  fe_sq_n(t2, t1, 20);
+  fe_mul(t1, t2, t1);           // 2^40 - 1
+  fe_sq_n(t1, t1, 10);
+  fe_mul(t0, t1, t0);           // 2^50 - 1
+  fe_sq_n(t1, t0, 50);
+  fe_mul(t1, t1, t0);           // 2^100 - 1
+  fe_sq_n(t2, t1, 100);
+  fe_mul(t1, t2, t1);           // 2^200 - 1
+  fe_sq_n(t1, t1, 50);
+  fe_mul(h, t1, t0);            // 2^250 - 1
+}
+
+// z^(p - 2) = z^-1
+static void fe_invert (fe h, fe const z)
+{
+  fe t, z11;
+  fe_pow2250(t, z11, z);
+  fe_sq_n(t, t, 5);
+  fe_mul(h, t, z11);
+}
+
+// z^((p - 5) / 8) = z^(2^252 - 3), used for square root
+static void fe_pow22523 (fe h, fe const z)
+{
+  fe t, z11;
+  fe_pow2250(t, z11, z);
+  fe_sq_n(t, t, 2);
+  fe_mul(h, t, z);
+}
+
+//--------------------------------------------------------------------+
+// Group operations, extended coordinates x = X/Z, y = Y/Z, xy = T/Z
+//--------------------------------------------------------------------+
+typedef struct
+{
+  fe X, Y, Z, T;
+} ge_t;
+
+// -121665/121666
+static const uint8_t CURVE_D[32] =
+{
+  0xa3, 0x78, 0x59, 0x13, 0xca, 0x4d, 0xeb, 0x75, 0xab, 0xd8, 0x41, 0x41, 0x4d, 0x0a, 0x70, 0x00,
+  0x98, 0xe8, 0x79, 0x77, 0x79, 0x40, 0xc7, 0x8c, 0x73, 0xfe, 0x6f, 0x2b, 0xee, 0x6c, 0x03, 0x52
+};
+
+// 2^((p - 1) / 4)
+static const uint8_t SQRT_M1[32] =
+{
+  0xb0, 0xa0, 0x0e, 0x4a, 0x27, 0x1b, 0xee, 0xc4, 0x78, 0xe4, 0x2f, 0xad, 0x06, 0x18, 0x43, 0x2f,
+  0xa7, 0xd7, 0xfb, 0x3d, 0x99, 0x00, 0x4d, 0x2b, 0x0b, 0xdf, 0xc1, 0x4f, 0x80, 0x24, 0x83, 0x2b
+};
+
+// Encoded base point, y = 4/5 with positive x
+static const uint8_t BASE_POINT[32] =
+{
+  0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+  0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66
+};
+
+static fe _d, _d2;
+
+static void ge_identity (ge_t* r)
+{
+  fe_set(r->X, 0);
+  fe_set(r->Y, 1);
+  fe_set(r->Z, 1);
+  fe_set(r->T, 0);
+}
+
+// Unified addition (add-2008-hwcd-3), complete for a = -1, r may alias p or q
+static void ge_add (ge_t* r, ge_t const* p, ge_t const* q)
+{
+  fe a, b, c, d, e, f, g, h;
+
+  fe_sub(a, p->Y, p->X);
+  fe_sub(e, q->Y, q->X);
+  fe_mul(a, a, e);
+  fe_add(b, p->Y, p->X);
+  fe_add(e, q->Y, q->X);
+  fe_mul(b, b, e);
+  fe_mul(c, p->T, q->T);
+  fe_mul(c, c, _d2);
+  fe_mul(d, p->Z, q->Z);
+  fe_add(d, d, d);
+
+  fe_sub(e, b, a);
+  fe_sub(f, d, c);
+  fe_add(g, d, c);
+  fe_add(h, b, a);
+
+  fe_mul(r->X, e, f);
+  fe_mul(r->Y, g, h);
+  fe_mul(r->T, e, h);
+  fe_mul(r->Z, f, g);
+}
+
+// Doubling (dbl-2008-hwcd) with a = -1
+static void ge_double (ge_t* r, ge_t const* p)
+{
+  fe a, b, c, e, f, g, h;
+
+  fe_sq(a, p->X);
+  fe_sq(b, p->Y);
+  fe_sq(c, p->Z);
+  fe_add(c, c, c);
+  fe_add(e, p->X, p->Y);
+  fe_sq(e, e);
+  fe_sub(e, e, a);
+  fe_sub(e, e, b);
+
+  fe_sub(g, b, a);          // -A + B
+  fe_sub(f, g, c);
+  fe_add(h, a, b);
+  fe_neg(h, h);             // -A - B
+
+  fe_mul(r->X, e, f);
+  fe_mul(r->Y, g, h);
+  fe_mul(r->T, e, h);
+  fe_mul(r->Z, f, g);
+}
+
+static void ge_negate (ge_t* r)
+{
+  fe_neg(r->X, r->X);
+  fe_neg(r->T, r->T);
+}
+
+// Decode point, rejects non-canonical y and x that does not exist
+static bool ge_frombytes (ge_t* r, uint8_t const s[32])
+{
+  fe u, v, v3, vxx, check;
+  uint8_t y_bytes[32];
+
+  fe_frombytes(r->Y, s);
+  fe_tobytes(y_bytes, r->Y);
+  y_bytes[31] |= s[31] & 0x80;
+  if ( memcmp(y_bytes, s, 32) ) return false;
+
+  // x^2 = (y^2 - 1) / (d y^2 + 1) = u / v
+  fe_set(r->Z, 1);
+  fe_sq(u, r->Y);
+  fe_mul(v, u, _d);
+  fe_sub(u, u, r->Z);
+  fe_add(v, v, r->Z);
+
+  // x = u v^3 (u v^7)^((p - 5) / 8)
+  fe_sq(v3, v);
+  fe_mul(v3, v3, v);
+  fe_sq(r->X, v3);
+  fe_mul(r->X, r->X, v);
+  fe_mul(r->X, r->X, u);
+  fe_pow22523(r->X, r->X);
+  fe_mul(r->X, r->X, v3);
+  fe_mul(r->X, r->X, u);
+
+  fe_sq(vxx, r->X);
+  fe_mul(vxx, vxx, v);
+
+  if ( !fe_equal(vxx, u) )
+  {
+    fe_neg(check, u);
+    if ( !fe_equal(vxx, check) ) return false;
+
+    fe sqrt_m1;
+    fe_frombytes(sqrt_m1, SQRT_M1);
+    fe_mul(r->X, r->X, sqrt_m1);
+  }
+
+  bool const sign = (s[31] >> 7) != 0;
+  uint8_t x_bytes[32];
+  static const uint8_t zero[32] = { 0 };
+
+  fe_tobytes(x_bytes, r->X);
+  if ( sign && !memcmp(x_bytes, zero, 32) ) return false;
+
+  if ( (x_bytes[0] & 1) != sign ) fe_neg(r->X, r->X);
+
+  fe_mul(r->T, r->X, r->Y);
+
+  return true;
+}
+
+static void ge_tobytes (uint8_t s[32], ge_t const* p)
+{
+  fe recip, x, y;
+
+  fe_invert(recip, p->Z);
+  fe_mul(x, p->X, recip);
+  fe_mul(y, p->Y, recip);
+  fe_tobytes(s, y);
+  s[31] ^= fe_isnegative(x) << 7;
+}
+
+//--------------------------------------------------------------------+
+// Scalars mod L = 2^252 + 27742317777372353535851937790883648493
+//--------------------------------------------------------------------+
+static const int64_t SC_L[32] =
+{
+  0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10
+};
+
+// Reduce 512-bit little endian value mod L (radix 2^8, as in TweetNaCl)
+static void sc_reduce (uint8_t r[32], uint8_t const s[64])
+{
+  int64_t x[64];
+  int64_t carry;
+  int i, j;
+
+  for ( i = 0; i < 64; i++ ) x[i] = s[i];
+
+  for ( i = 63; i >= 32; i-- )
+  {
+    carry = 0;
+    for ( j = i - 32; j < i - 12; j++ )
+    {
+      x[j] += carry - 16 * x[i] * SC_L[j - (i - 32)];
+      carry = (x[j] + 128) >> 8;
+      x[j] -= carry * 256;
+    }
+    x[j] += carry;
+    x[i]  = 0;
+  }
+
+  carry = 0;
+  for ( j = 0; j < 32; j++ )
+  {
+    x[j] += carry - (x[31] >> 4) * SC_L[j];
+    carry = x[j] >> 8;
+    x[j] &= 255;
+  }
+
+  for ( j = 0; j < 32; j++ ) x[j] -= carry * SC_L[j];
+
+  for ( i = 0; i < 32; i++ )
+  {
+    x[i + 1] += x[i] >> 8;
+    r[i] = (uint8_t) (x[i] & 255);
+  }
+}
+
+// S must be canonical (< L) to rule out malleable signatures
+static bool sc_is_canonical (uint8_t const s[32])
+{
+  for ( int i = 31; i >= 0; i-- )
+  {
+    if ( s[i] < SC_L[i] ) return true;
+    if ( s[i] > SC_L[i] ) return false;
+  }
+
+  return false;
+}
+
+static inline uint32_t sc_bit (uint8_t const s[32], uint32_t i)
+{
+  return (s[i >> 3] >> (i & 7)) & 1;
+}
+
+//--------------------------------------------------------------------+
+// API
+//--------------------------------------------------------------------+
+bool ed25519_verify (uint8_t const signature[ED25519_SIGNATURE_SIZE], void const* msg, uint32_t len,
+                     uint8_t const public_key[ED25519_PUBLIC_KEY_SIZE])
+{
+  uint8_t const* const sig_r = signature;
+  uint8_t const* const sig_s = signature + 32;
+
+  if ( !sc_is_canonical(sig_s) ) return false;
+
+  fe_frombytes(_d, CURVE_D);
+  fe_add(_d2, _d, _d);
+
+  // table for joint scalar multiplication: B, -A, B - A
+  ge_t table[3];
+
+  if ( !ge_frombytes(&table[0], BASE_POINT) ) return false;
+  if ( !ge_frombytes(&table[1], public_key) ) return false;
+  ge_negate(&table[1]);
+  ge_add(&table[2], &table[0], &table[1]);
+
+  // k = SHA-512(R || A || M) mod L
+  uint8_t k[64];
+  sha512_t sha;
+
+  sha512_init(&sha);
+  sha512_update(&sha, sig_r, 32);
+  sha512_update(&sha, public_key, 32);
+  sha512_update(&sha, msg, len);
+  sha512_final(&sha, k);
+  sc_reduce(k, k);
+
+  // R' = [S]B - [k]A, both scalars are below L < 2^253
+  ge_t r;
+  ge_identity(&r);
+
+  for ( int i = 252; i >= 0; i-- )
+  {
+    ge_double(&r, &r);
+
+    uint32_t const sel = sc_bit(sig_s, i) | (sc_bit(k, i) << 1);
+    if ( sel ) ge_add(&r, &r, &table[sel - 1]);
+  }
+
+  uint8_t r_bytes[32];
+  ge_tobytes(r_bytes, &r);
+
+  return 0 == memcmp(r_bytes, sig_r, 32);
+}
@@ -25,11 +25,16 @@
 #include <string.h>
 #include "nrf_sdm.h"
 #include "flash_nrf5x.h"
+#include "flash_wear.h"
 #include "boards.h"
 #include "usb/uf2/uf2cfg.h"
 
+#define TRACE_MODULE_LEVEL  CFG_TRACE_LEVEL_FLASH
+#include "trace.h"
+
 #ifdef ENABLE_QSPI_FLASH
 #include "qspi_flash.h"
+#include "crc16.h"
 #endif
 
 #define FLASH_PAGE_SIZE           4096
@@ -38,14 +43,87 @@
 static uint32_t _fl_addr = FLASH_CACHE_INVALID_ADDR;
 static uint8_t _fl_buf[FLASH_PAGE_SIZE] __attribute__((aligned(4)));
 
+static flash_nrf5x_stats_t _stats;
+
 #ifdef ENABLE_QSPI_FLASH
-// Cache to track which QSPI sectors have been erased to avoid repeated erasures
-static uint32_t _qspi_erased_sector = 0xFFFFFFFF; // Track last erased sector
+// Bitmap of QSPI sectors erased in this session to avoid repeated erasures.
+// Blocks are not always written in order by host, a sector must never be erased twice
+static uint8_t _qspi_erased_mask[CFG_UF2_QSPI_FLASH_SIZE / W25Q16_SECTOR_SIZE / 8];
+#endif
+
+static bool page_matches (uint32_t addr, uint32_t const *buf)
+{
+  uint32_t const * p_word = (uint32_t const *) addr;
+
+  for ( uint32_t i = 0; i < FLASH_PAGE_SIZE / 4; i++ )
+  {
+    if ( p_word[i] != buf[i] ) return false;
+  }
+
+  return true;
+}
+
+// Program page and read it back word by word. Programming can only clear bits, a mismatched
+// page is therefore erased before each retry even if caller erased it in advance.
+static bool page_program (uint32_t addr, uint32_t const *buf, bool need_erase)
+{
+  for ( uint32_t attempt = 0; ; attempt++ )
+  {
+    if ( need_erase )
+    {
+      TRACE_DBG("Erase 0x%08lX", addr);
+      nrfx_nvmc_page_erase(addr);
+      flash_wear_erased(addr, FLASH_PAGE_SIZE);
+      _stats.pages_erased++;
+    }
+
+    TRACE_DBG("Write 0x%08lX", addr);
+    nrfx_nvmc_words_write(addr, buf, FLASH_PAGE_SIZE / 4);
+    _stats.pages_written++;
+
+    if ( page_matches(addr, buf) ) return true;
+    if ( attempt == FLASH_VERIFY_RETRIES ) break;
+
+    TRACE_ERR("Verify failed, retry 0x%08lX", addr);
+    _stats.verify_retries++;
+    need_erase = true;
+  }
+
+  _stats.verify_failures++;
+  return false;
+}
+
+#if CFG_FLASH_WEAR_HOT_PAGE
+// Program only the words that differ, without erasing. Possible if all of them are still blank:
+// each word is then written at most twice between erases (full page program + this), within nWRITE.
+static bool page_fill_blank (uint32_t addr, uint32_t const *buf)
+{
+  uint32_t const * p_word = (uint32_t const *) addr;
+
+  for ( uint32_t i = 0; i < FLASH_PAGE_SIZE / 4; i++ )
+  {
+    if ( (p_word[i] != buf[i]) && (p_word[i] != 0xFFFFFFFFUL) ) return false;
+  }
+
+  TRACE_DBG("Fill 0x%08lX", addr);
+
+  for ( uint32_t i = 0; i < FLASH_PAGE_SIZE / 4; i++ )
+  {
+    if ( p_word[i] != buf[i] ) nrfx_nvmc_word_write(addr + 4 * i, buf[i]);
+  }
+
+  if ( !page_matches(addr, buf) ) return false;
+
+  _stats.erases_avoided++;
+  return true;
+}
 #endif
 
-void flash_nrf5x_flush (bool need_erase)
+bool flash_nrf5x_flush (bool need_erase)
 {
-  if ( _fl_addr == FLASH_CACHE_INVALID_ADDR ) return;
+  bool ok = true;
+
+  if ( _fl_addr == FLASH_CACHE_INVALID_ADDR ) return true;
 
   // skip the write if contents matches
   if ( memcmp(_fl_buf, (void *) _fl_addr, FLASH_PAGE_SIZE) != 0 )
@@ -55,28 +133,93 @@ void flash_nrf5x_flush (bool need_erase)
     // - nRF52840 dfu serial/uf2 are USB-based which are DMA and should have no problems.
     //
     // Note: MSC uf2 does not erase page in advance like dfu serial
-    if ( need_erase )
-    {
-      PRINTF("Erase and ");
-      nrfx_nvmc_page_erase(_fl_addr);
-    }
-
-    PRINTF("Write 0x%08lX\r\n", _fl_addr);
-    nrfx_nvmc_words_write(_fl_addr, (uint32_t *) _fl_buf, FLASH_PAGE_SIZE / 4);
+#if CFG_FLASH_WEAR_HOT_PAGE
+    // hot page: spare an erase when new data only goes into blank words
+    if ( !(need_erase && (flash_wear_count(_fl_addr) >= CFG_FLASH_WEAR_HOT_PAGE) &&
+           page_fill_blank(_fl_addr, (uint32_t const *) _fl_buf)) )
+#endif
+    ok = page_program(_fl_addr, (uint32_t const *) _fl_buf, need_erase);
+  }
+  else
+  {
+    _stats.pages_skipped++;
   }
 
   _fl_addr = FLASH_CACHE_INVALID_ADDR;
+  return ok;
+}
+
+flash_nrf5x_stats_t const* flash_nrf5x_get_stats (void)
+{
+  return &_stats;
 }
 
 #ifdef ENABLE_QSPI_FLASH
 // Reset the QSPI sector erase cache - useful when starting a new write operation
 void flash_nrf5x_reset_qspi_erase_cache(void)
 {
-  _qspi_erased_sector = 0xFFFFFFFF;
+  memset(_qspi_erased_mask, 0, sizeof(_qspi_erased_mask));
+}
+
+// Read back through QSPI EasyDMA and compare, len must be word multiple
+static bool qspi_matches (uint32_t addr, uint8_t const *src, uint32_t len)
+{
+  uint32_t buf[64];
+
+  while ( len )
+  {
+    uint32_t const count = (len < sizeof(buf)) ? len : sizeof(buf);
+
+    if ( qspi_flash_read(addr, (uint8_t *) buf, count) != QSPI_FLASH_STATUS_SUCCESS ) return false;
+    if ( memcmp(buf, src, count) ) return false;
+
+    addr += count;
+    src  += count;
+    len  -= count;
+  }
+
+  return true;
+}
+
+// Program data that lies within one sector and verify it. On mismatch the whole sector is
+// rewritten since it may hold other data written earlier in this session.
+static bool qspi_program (uint32_t addr, uint8_t const *src, uint32_t len)
+{
+  _stats.qspi_writes++;
+
+  if ( (qspi_flash_write(addr, src, len) == QSPI_FLASH_STATUS_SUCCESS) && qspi_matches(addr, src, len) ) return true;
+
+  uint32_t const sector_addr = addr & ~(W25Q16_SECTOR_SIZE - 1);
+
+  // page cache is used as sector buffer, a pending page that fails to verify fails this write too
+  if ( !flash_nrf5x_flush(true) ) return false;
+
+  for ( uint32_t attempt = 0; attempt < FLASH_VERIFY_RETRIES; attempt++ )
+  {
+    TRACE_ERR("QSPI verify failed, rewrite sector 0x%08lX", sector_addr);
+    _stats.qspi_verify_retries++;
+
+    qspi_flash_read(sector_addr, _fl_buf, W25Q16_SECTOR_SIZE);
+    memcpy(_fl_buf + (addr - sector_addr), src, len);
+
+    if ( qspi_flash_erase_sector(sector_addr) != QSPI_FLASH_STATUS_SUCCESS ) continue;
+    flash_wear_qspi_erased(sector_addr);
+
+    bool ok = true;
+    for ( uint32_t offset = 0; ok && offset < W25Q16_SECTOR_SIZE; offset += W25Q16_PAGE_SIZE )
+    {
+      ok = (qspi_flash_write(sector_addr + offset, _fl_buf + offset, W25Q16_PAGE_SIZE) == QSPI_FLASH_STATUS_SUCCESS);
+    }
+
+    if ( ok && qspi_matches(sector_addr, _fl_buf, W25Q16_SECTOR_SIZE) ) return true;
+  }
+
+  _stats.qspi_verify_failures++;
+  return false;
 }
 #endif
 
-void flash_nrf5x_write (uint32_t dst, void const *src, int len, bool need_erase)
+bool flash_nrf5x_write (uint32_t dst, void const *src, int len, bool need_erase)
 {
   uint32_t newAddr = dst & ~(FLASH_PAGE_SIZE - 1);
 
@@ -96,7 +239,7 @@ void flash_nrf5x_write (uint32_t dst, void const *src, int len, bool need_erase)
       else
       {
         PRINTF("Failed to initialize QSPI Flash\r\n");
-        return;
+        return false;
       }
     }
     
@@ -106,42 +249,123 @@ void flash_nrf5x_write (uint32_t dst, void const *src, int len, bool need_erase)
       // Align address to sector boundary
       uint32_t sector_addr = (dst - CFG_UF2_QSPI_XIP_OFFSET) & ~(W25Q16_SECTOR_SIZE - 1);
       
+      uint32_t const sector_idx  = sector_addr / W25Q16_SECTOR_SIZE;
+      uint8_t  const sector_mask = 1 << (sector_idx % 8);
+
       // Avoid repeated erasure of the same sector
-      if (sector_addr != _qspi_erased_sector)
+      if ( !(_qspi_erased_mask[sector_idx / 8] & sector_mask) )
       {
-        PRINTF("Erasing QSPI Flash sector at 0x%08lX\r\n", sector_addr);
+        TRACE_DBG("Erasing QSPI Flash sector at 0x%08lX", sector_addr);
         
         qspi_flash_status_t erase_status = qspi_flash_erase_sector(sector_addr);
         if (erase_status != QSPI_FLASH_STATUS_SUCCESS)
         {
           PRINTF("Failed to erase QSPI Flash sector: status=%d\r\n", erase_status);
-          return;
+          return false;
         }
         
-        // Update the cache to track the last erased sector
-        _qspi_erased_sector = sector_addr;
+        // Update the cache to track erased sectors
+        _qspi_erased_mask[sector_idx / 8] |= sector_mask;
+        flash_wear_qspi_erased(sector_addr);
+        _stats.qspi_erases++;
       }
       else
       {
-        PRINTF("Skipping erase of already erased sector at 0x%08lX\r\n", sector_addr);
+        _stats.qspi_erases_skipped++;
+        TRACE_DBG("Skipping erase of already erased sector at 0x%08lX", sector_addr);
       }
     }
     
     // Write to QSPI Flash
-    qspi_flash_status_t status = qspi_flash_write(dst - CFG_UF2_QSPI_XIP_OFFSET, (uint8_t*)src, len);
-    if (status != QSPI_FLASH_STATUS_SUCCESS)
+    if ( !qspi_program(dst - CFG_UF2_QSPI_XIP_OFFSET, (uint8_t const*) src, len) )
     {
-      PRINTF("Failed to write to QSPI Flash: status=%d\r\n", status);
+      PRINTF("Failed to write to QSPI Flash at 0x%08lX\r\n", dst);
+      return false;
     }
-    return;
+    return true;
   }
 #endif
 
+  bool ok = true;
+
   if ( newAddr != _fl_addr )
   {
-    flash_nrf5x_flush(need_erase);
+    // previous page is programmed now, its verify status is reported by this write
+    ok = flash_nrf5x_flush(need_erase);
     _fl_addr = newAddr;
     memcpy(_fl_buf, (void *) newAddr, FLASH_PAGE_SIZE);
   }
   memcpy(_fl_buf + (dst & (FLASH_PAGE_SIZE - 1)), src, len);
+
+  return ok;
+}
+
+#ifdef ENABLE_QSPI_FLASH
+
+uint16_t flash_nrf5x_qspi_crc16 (uint32_t qspi_addr, uint32_t len)
+{
+  uint16_t crc = 0xFFFF;
+
+  // page cache is used as read buffer
+  flash_nrf5x_flush(true);
+  qspi_flash_init();
+
+  while ( len )
+  {
+    uint32_t const count = (len < FLASH_PAGE_SIZE) ? len : FLASH_PAGE_SIZE;
+
+    qspi_flash_read(qspi_addr, _fl_buf, count);
+    crc = crc16_compute(_fl_buf, count, &crc);
+
+    qspi_addr += count;
+    len       -= count;
+  }
+
+  return crc;
+}
+
+#endif
+
+#ifdef ENABLE_QSPI_STAGING
+
+static bool is_page_blank(uint32_t addr)
+{
+  uint32_t const * p_word = (uint32_t const *) addr;
+
+  for ( uint32_t i = 0; i < FLASH_PAGE_SIZE / 4; i++ )
+  {
+    if ( p_word[i] != 0xFFFFFFFFUL ) return false;
+  }
+
+  return true;
 }
+
+bool flash_nrf5x_copy_from_qspi (uint32_t dst, uint32_t qspi_addr, uint32_t len)
+{
+  uint32_t const dst_end = dst + len;
+  bool ok;
+
+  // page cache is used as copy buffer
+  ok = flash_nrf5x_flush(true);
+  qspi_flash_init();
+
+  for ( uint32_t page_addr = dst & ~(FLASH_PAGE_SIZE - 1); page_addr < dst_end; page_addr += FLASH_PAGE_SIZE )
+  {
+    // part of this page covered by the image, the rest keeps its current content
+    uint32_t const start = (page_addr < dst) ? dst : page_addr;
+    uint32_t const end   = (page_addr + FLASH_PAGE_SIZE < dst_end) ? (page_addr + FLASH_PAGE_SIZE) : dst_end;
+
+    memcpy(_fl_buf, (void *) page_addr, FLASH_PAGE_SIZE);
+    qspi_flash_read(qspi_addr + (start - dst), _fl_buf + (start - page_addr), end - start);
+
+    // skip unchanged page, this also skips pages already committed before a power loss
+    if ( memcmp(_fl_buf, (void *) page_addr, FLASH_PAGE_SIZE) == 0 ) continue;
+
+    TRACE_DBG("Commit 0x%08lX", page_addr);
+    if ( !page_program(page_addr, (uint32_t const *) _fl_buf, !is_page_blank(page_addr)) ) ok = false;
+  }
+
+  return ok;
+}
+
+#endif
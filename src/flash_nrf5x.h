@@ -34,8 +34,42 @@
  extern "C" {
 #endif
 
-void flash_nrf5x_write (uint32_t dst, void const *src, int len, bool need_erase);
-void flash_nrf5x_flush (bool need_erase);
+typedef struct
+{
+  uint32_t pages_erased;          // internal flash pages erased
+  uint32_t pages_written;         // internal flash pages programmed
+  uint32_t pages_skipped;         // pages not programmed since contents already matched
+  uint32_t erases_avoided;        // hot pages programmed into blank words without erase, see CFG_FLASH_WEAR_HOT_PAGE
+  uint32_t verify_retries;        // pages erased and programmed again after read-back mismatch
+  uint32_t verify_failures;       // pages still mismatching after all retries
+  uint32_t qspi_writes;           // QSPI program operations
+  uint32_t qspi_erases;           // QSPI sectors erased
+  uint32_t qspi_erases_skipped;   // QSPI sector erases avoided, sector already erased in this session
+  uint32_t qspi_verify_retries;   // QSPI sectors rewritten after read-back mismatch
+  uint32_t qspi_verify_failures;  // QSPI writes still mismatching after all retries
+} flash_nrf5x_stats_t;
+
+// Return false if a page programmed by the call still mismatches after read-back retries
+// (QSPI: also if it could not be initialized or erased)
+bool flash_nrf5x_write (uint32_t dst, void const *src, int len, bool need_erase);
+bool flash_nrf5x_flush (bool need_erase);
+
+// Counters of programming and read-back verification since reset
+flash_nrf5x_stats_t const* flash_nrf5x_get_stats (void);
+
+#ifdef ENABLE_QSPI_FLASH
+void flash_nrf5x_reset_qspi_erase_cache(void);
+
+// CRC16 of len bytes in QSPI starting at qspi_addr (QSPI address, not XIP)
+uint16_t flash_nrf5x_qspi_crc16 (uint32_t qspi_addr, uint32_t len);
+#endif
+
+#ifdef ENABLE_QSPI_STAGING
+// Copy len bytes from QSPI at qspi_addr into internal flash at dst page by page.
+// Unchanged pages are skipped and blank pages are programmed without erasing.
+// Return false if a page failed to verify.
+bool flash_nrf5x_copy_from_qspi (uint32_t dst, uint32_t qspi_addr, uint32_t len);
+#endif
 
 #ifdef __cplusplus
  }
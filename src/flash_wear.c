@@ -0,0 +1,122 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+#include "boards.h"
+#include "dfu_types.h"
+#include "flash_wear.h"
+
+#define FLASH_WEAR_PAGE_SIZE      4096
+
+static flash_wear_t _wear __attribute__((aligned(4)));
+
+void flash_wear_init(void)
+{
+  flash_wear_t const* stored = (flash_wear_t const*) (BOOTLOADER_SETTINGS_ADDRESS + FLASH_WEAR_OFFSET);
+
+  if ( (stored->magic == FLASH_WEAR_MAGIC) && (stored->page_count == FLASH_WEAR_PAGES) &&
+       (stored->qspi_count == FLASH_WEAR_QSPI_ENTRIES) )
+  {
+    memcpy(&_wear, stored, sizeof(_wear));
+  }
+  else
+  {
+    // first boot or layout changed: start from zero
+    memset(&_wear, 0, sizeof(_wear));
+    _wear.magic      = FLASH_WEAR_MAGIC;
+    _wear.page_count = FLASH_WEAR_PAGES;
+    _wear.qspi_count = FLASH_WEAR_QSPI_ENTRIES;
+  }
+}
+
+static inline void count_inc (uint32_t idx)
+{
+  if ( _wear.count[idx] != UINT16_MAX ) _wear.count[idx]++;
+}
+
+void flash_wear_erased(uint32_t addr, uint32_t len)
+{
+  uint32_t const first = addr / FLASH_WEAR_PAGE_SIZE;
+  uint32_t const last  = (addr + (len ? len : 1) - 1) / FLASH_WEAR_PAGE_SIZE;
+
+  for ( uint32_t page = first; page <= last && page < FLASH_WEAR_PAGES; page++ ) count_inc(page);
+}
+
+uint16_t flash_wear_count(uint32_t addr)
+{
+  uint32_t const page = addr / FLASH_WEAR_PAGE_SIZE;
+  return (page < FLASH_WEAR_PAGES) ? _wear.count[page] : 0;
+}
+
+#ifdef ENABLE_QSPI_FLASH
+void flash_wear_qspi_erased(uint32_t qspi_addr)
+{
+  uint32_t const entry = (qspi_addr / 4096) / FLASH_WEAR_QSPI_SECTORS_PER_ENTRY;
+  if ( entry < FLASH_WEAR_QSPI_ENTRIES ) count_inc(FLASH_WEAR_PAGES + entry);
+}
+#endif
+
+flash_wear_t const* flash_wear_get(void)
+{
+  return &_wear;
+}
+
+uint32_t flash_wear_hottest(bool qspi, uint32_t* addr, uint16_t* count, uint32_t n)
+{
+  uint32_t const base    = qspi ? FLASH_WEAR_PAGES : 0;
+  uint32_t const entries = qspi ? FLASH_WEAR_QSPI_ENTRIES : FLASH_WEAR_PAGES;
+#ifdef ENABLE_QSPI_FLASH
+  uint32_t const unit    = qspi ? (FLASH_WEAR_QSPI_SECTORS_PER_ENTRY * 4096) : FLASH_WEAR_PAGE_SIZE;
+#else
+  uint32_t const unit    = FLASH_WEAR_PAGE_SIZE;
+#endif
+
+  uint32_t found = 0;
+
+  // insertion into the short sorted output, n is small
+  for ( uint32_t i = 0; i < entries; i++ )
+  {
+    uint16_t const c = _wear.count[base + i];
+    if ( c == 0 ) continue;
+
+    uint32_t pos = (found < n) ? found++ : n;
+    while ( pos > 0 && count[pos - 1] < c )
+    {
+      if ( pos < n )
+      {
+        addr[pos]  = addr[pos - 1];
+        count[pos] = count[pos - 1];
+      }
+      pos--;
+    }
+
+    if ( pos < n )
+    {
+      addr[pos]  = i * unit;
+      count[pos] = c;
+    }
+  }
+
+  return found;
+}
@@ -0,0 +1,103 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef FLASH_WEAR_H_
+#define FLASH_WEAR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "boards.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Erase counters of internal flash pages and QSPI sectors, kept since the first boot with this
+ * bootloader. Counters are accumulated in RAM and persisted at FLASH_WEAR_OFFSET in the bootloader
+ * settings page, written together with the settings. That page is erased for every settings save
+ * anyway, keeping the counters never costs an erase of its own. Erases done after the last
+ * settings save of a session (e.g aborted transfer) are not recorded. Counters saturate at 0xFFFF.
+ */
+
+#if defined(NRF52840_XXAA)
+  #define FLASH_WEAR_PAGES        256
+#else
+  #define FLASH_WEAR_PAGES        128
+#endif
+
+#ifdef ENABLE_QSPI_FLASH
+  // large QSPI flash shares a counter between adjacent sectors to keep the store within the page
+  #define FLASH_WEAR_QSPI_MAX_ENTRIES     1024
+  #define FLASH_WEAR_QSPI_SECTORS         (QSPI_FLASH_SIZE / 4096)
+  #define FLASH_WEAR_QSPI_SECTORS_PER_ENTRY ((FLASH_WEAR_QSPI_SECTORS + FLASH_WEAR_QSPI_MAX_ENTRIES - 1) / FLASH_WEAR_QSPI_MAX_ENTRIES)
+  #define FLASH_WEAR_QSPI_ENTRIES         ((FLASH_WEAR_QSPI_SECTORS + FLASH_WEAR_QSPI_SECTORS_PER_ENTRY - 1) / FLASH_WEAR_QSPI_SECTORS_PER_ENTRY)
+#else
+  #define FLASH_WEAR_QSPI_ENTRIES         0
+#endif
+
+// Location of the counters in the bootloader settings page, bootloader_settings_t must fit below
+#define FLASH_WEAR_OFFSET         0x200
+
+#define FLASH_WEAR_MAGIC          0x52414557UL // "WEAR"
+
+typedef struct
+{
+  uint32_t magic;
+  uint16_t page_count;    // FLASH_WEAR_PAGES, counters are discarded if layout changes
+  uint16_t qspi_count;    // FLASH_WEAR_QSPI_ENTRIES
+  uint16_t count[FLASH_WEAR_PAGES + FLASH_WEAR_QSPI_ENTRIES + ((FLASH_WEAR_PAGES + FLASH_WEAR_QSPI_ENTRIES) & 1)];
+} flash_wear_t;
+
+// Erase count at which a page only receiving data into blank words is programmed without
+// erasing it first, 0 = disabled. Only used by the uf2 write path.
+#ifndef CFG_FLASH_WEAR_HOT_PAGE
+#define CFG_FLASH_WEAR_HOT_PAGE   0
+#endif
+
+// Load counters from the settings page, must be called before any erase
+void flash_wear_init(void);
+
+// Record erase of internal flash pages covering [addr, addr+len)
+void flash_wear_erased(uint32_t addr, uint32_t len);
+
+// Erase count of the internal flash page containing addr
+uint16_t flash_wear_count(uint32_t addr);
+
+#ifdef ENABLE_QSPI_FLASH
+// Record erase of the QSPI sector at qspi_addr (QSPI address, not XIP)
+void flash_wear_qspi_erased(uint32_t qspi_addr);
+#endif
+
+// Counters in their persisted form, written after the settings by bootloader_settings_save()
+flash_wear_t const* flash_wear_get(void);
+
+// Up to n hottest pages (qspi = false) or QSPI sectors (qspi = true) with their address and
+// erase count, hottest first. Returns number of entries filled, never-erased ones are left out
+uint32_t flash_wear_hottest(bool qspi, uint32_t* addr, uint16_t* count, uint32_t n);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* FLASH_WEAR_H_ */
@@ -58,6 +58,13 @@
 #include "qspi_flash.h"
 #endif
 
+#include "trace.h"
+#include "ram_usage.h"
+#include "bootloader_api.h"
+#include "crc16.h"
+#include "dfu_transport.h"
+#include "hci_mem_pool.h"
+
 #include "pstorage_platform.h"
 #include "nrf_mbr.h"
 
@@ -67,6 +74,7 @@
 #include "tusb.h"
 
 void usb_init(bool cdc_only);
+void usb_sd_disabled(void);
 void usb_teardown(void);
 
 // tinyusb function that handles power event (detected, ready, removed)
@@ -75,7 +83,9 @@ extern void tusb_hal_nrf_power_event(uint32_t event);
 
 #else
 #define usb_init(x)       led_state(STATE_USB_MOUNTED) // mark nrf52832 as mounted
+#define usb_sd_disabled()
 #define usb_teardown()
+#define uf2_stats_boot_phase(x)
 
 #endif
 
@@ -105,11 +115,20 @@ extern void tusb_hal_nrf_power_event(uint32_t event);
 #define DFU_MAGIC_UF2_RESET             0x57
 #define DFU_MAGIC_SKIP                  0x6d
 
+// Same values are offered to the app by bootloader_api.h
+STATIC_ASSERT(BOOTLOADER_API_DFU_OTA    == DFU_MAGIC_OTA_RESET);
+STATIC_ASSERT(BOOTLOADER_API_DFU_SERIAL == DFU_MAGIC_SERIAL_ONLY_RESET);
+STATIC_ASSERT(BOOTLOADER_API_DFU_UF2    == DFU_MAGIC_UF2_RESET);
+STATIC_ASSERT(BOOTLOADER_API_DFU_SKIP   == DFU_MAGIC_SKIP);
+
 #define DFU_DBL_RESET_MAGIC             0x5A1AD5      // SALADS
 #define DFU_DBL_RESET_APP               0x4ee5677e
 #define DFU_DBL_RESET_DELAY             500
 #define DFU_DBL_RESET_MEM               0x20007F7C
 
+// Warm handoff block must not overlap double reset magic
+STATIC_ASSERT(BOOTLOADER_HANDOFF_ADDR + sizeof(bootloader_handoff_t) <= DFU_DBL_RESET_MEM);
+
 #define BOOTLOADER_VERSION_REGISTER     NRF_TIMER2->CC[0]
 #define DFU_SERIAL_STARTUP_INTERVAL     1000
 
@@ -121,6 +140,8 @@ extern void tusb_hal_nrf_power_event(uint32_t event);
 // These value must be the same with one in dfu_transport_ble.c
 #define BLEGAP_EVENT_LENGTH             6
 #define BLEGATT_ATT_MTU_MAX             23
+#define BLEL2CAP_MPS_MAX                247
+#define BLEL2CAP_RX_QUEUE_SIZE          3
 enum {
   BLE_CONN_CFG_HIGH_BANDWIDTH = 1
 };
@@ -135,10 +156,22 @@ bool _ota_dfu = false;
 bool _ota_connected = false;
 bool _sd_inited = false;
 
+// USB and BLE both listening until one of them claims the flash, see dfu_transport_claim()
+static bool _dfu_dual = false;
+
+// Set when app jumps in with enter_dfu_warm(), see bootloader_api.h
+static bool _warm_entry = false;
+static bootloader_handoff_t _handoff;
+
 bool is_ota(void) {
   return _ota_dfu;
 }
 
+bool is_dfu_dual(void) {
+  return _dfu_dual;
+}
+
+static void handoff_consume(void);
 static void check_dfu_mode(void);
 static uint32_t ble_stack_init(void);
 
@@ -172,8 +205,16 @@ int main(void) {
   // TODO move to CF2
   BOOTLOADER_VERSION_REGISTER = (MK_BOOTLOADER_VERSION);
 
+  // Before anything that may reset: a handoff block surviving a reset is no longer warm
+  handoff_consume();
+
+  ram_usage_init();
   board_init();
 
+#ifdef CFG_TRACE
+  trace_init();
+#endif
+
 #ifdef ENABLE_QSPI_FLASH
   // Pre-initialize QSPI Flash
   if (qspi_flash_init() == QSPI_FLASH_STATUS_SUCCESS) {
@@ -186,6 +227,7 @@ int main(void) {
   bootloader_init();
   PRINTF("Bootloader Start\r\n");
   led_state(STATE_BOOTLOADER_STARTED);
+  uf2_stats_boot_phase(UF2_BOOT_INIT);
 
   // When updating SoftDevice, bootloader will reset before swapping SD
   if (bootloader_dfu_sd_in_progress()) {
@@ -197,9 +239,19 @@ int main(void) {
     led_state(STATE_WRITING_FINISHED);
   }
 
+  // Application received into QSPI staging slot is committed before anything else,
+  // an interrupted commit (e.g power loss) is resumed here on next boot
+  if (bootloader_dfu_app_staged()) {
+    led_state(STATE_WRITING_STARTED);
+    bootloader_dfu_staged_app_commit();
+    led_state(STATE_WRITING_FINISHED);
+  }
+  uf2_stats_boot_phase(UF2_BOOT_UPDATE);
+
   // Check all inputs and enter DFU if needed
   // Return when DFU process is complete (or not entered at all)
   check_dfu_mode();
+  ram_usage_report();
 
   // Reset peripherals
   board_teardown();
@@ -224,6 +276,13 @@ int main(void) {
     // clear in case we kept DFU_DBL_RESET_APP there
     (*dbl_reset_mem) = 0;
 
+#ifdef ENABLE_QSPI_XIP_APP
+    // part of the app executes from QSPI, its XIP image was validated along with the app
+    if ( qspi_flash_xip_enable() != QSPI_FLASH_STATUS_SUCCESS ) {
+      PRINTF("QSPI XIP setup failed\r\n");
+    }
+#endif
+
     // start application
     PRINTF("Starting app...\r\n");
     bootloader_app_start();
@@ -232,11 +291,24 @@ int main(void) {
   NVIC_SystemReset();
 }
 
+// Take the handoff block left by enter_dfu_warm(), it is only valid once
+static void handoff_consume(void) {
+  bootloader_handoff_t volatile* blk = (bootloader_handoff_t volatile*) BOOTLOADER_HANDOFF_ADDR;
+  if (blk->magic != BOOTLOADER_HANDOFF_MAGIC) return;
+
+  _handoff = *blk;
+  blk->magic = 0;
+
+  uint16_t const crc = crc16_compute((uint8_t const*) &_handoff, offsetof(bootloader_handoff_t, crc), NULL);
+  _warm_entry = (crc == _handoff.crc) && (_handoff.mode != DFU_MAGIC_SKIP);
+}
+
 static void check_dfu_mode(void) {
-  uint32_t const gpregret = NRF_POWER->GPREGRET;
+  // Warm entry carries the mode that would otherwise be passed in GPREGRET
+  uint32_t const gpregret = _warm_entry ? _handoff.mode : NRF_POWER->GPREGRET;
 
-  // SD is already Initialized in case of BOOTLOADER_DFU_OTA_MAGIC
-  _sd_inited = (gpregret == DFU_MAGIC_OTA_APPJUM);
+  // SD is already Initialized in case of BOOTLOADER_DFU_OTA_MAGIC or warm entry (app jumps without reset)
+  _sd_inited = (gpregret == DFU_MAGIC_OTA_APPJUM) || _warm_entry;
 
   // Start Bootloader in BLE OTA mode
   _ota_dfu = (gpregret == DFU_MAGIC_OTA_APPJUM) || (gpregret == DFU_MAGIC_OTA_RESET);
@@ -268,7 +340,8 @@ static void check_dfu_mode(void) {
   // DFU + FRESET are pressed --> OTA
   _ota_dfu = _ota_dfu || (button_pressed(BUTTON_DFU) && button_pressed(BUTTON_FRESET));
 
-  bool const valid_app = bootloader_app_is_valid();
+  // Checking the app (CRC and SHA-256 over the whole image) is only needed if DFU is not requested already
+  bool const valid_app = !dfu_start && bootloader_app_is_valid();
   bool const just_start_app = valid_app && !dfu_start && (*dbl_reset_mem) == DFU_DBL_RESET_APP;
 
   if (!just_start_app && APP_ASKS_FOR_SINGLE_TAP_RESET()) {
@@ -302,18 +375,29 @@ static void check_dfu_mode(void) {
 
   // Enter DFU mode accordingly to input
   if (dfu_start || !valid_app) {
+    // Nothing asked for a specific transport: listen on both, SoftDevice owns the flash until USB claims it
+    _dfu_dual = DFU_DUAL_TRANSPORT && is_sd_existed() && !_ota_dfu && !serial_only_dfu && !uf2_dfu &&
+                !_warm_entry && !APP_ASKS_FOR_SINGLE_TAP_RESET();
+    if (_dfu_dual) _ota_dfu = true;
+
     if (_ota_dfu) {
       led_state(STATE_BLE_DISCONNECTED);
       if (!_sd_inited) mbr_init_sd();
       _sd_inited = true;
       ble_stack_init();
-    } else {
+    }
+
+    if (!_ota_dfu || _dfu_dual) {
       led_state(STATE_USB_UNMOUNTED);
       usb_init(serial_only_dfu);
+      uf2_stats_boot_phase(UF2_BOOT_USB);
     }
 
     // Initiate an update of the firmware.
-    if (APP_ASKS_FOR_SINGLE_TAP_RESET() || uf2_dfu || serial_only_dfu) {
+    if (_warm_entry && _handoff.timeout_ms) {
+      uint32_t const timeout = (_handoff.timeout_ms == BOOTLOADER_HANDOFF_NO_TIMEOUT) ? 0 : _handoff.timeout_ms;
+      bootloader_dfu_start(_ota_dfu, timeout, timeout != 0);
+    } else if (APP_ASKS_FOR_SINGLE_TAP_RESET() || uf2_dfu || serial_only_dfu) {
       // If USB is not enumerated in 3s (eg. because we're running on battery), we restart into app.
       bootloader_dfu_start(_ota_dfu, 3000, true);
     } else {
@@ -321,14 +405,32 @@ static void check_dfu_mode(void) {
       bootloader_dfu_start(_ota_dfu, 0, false);
     }
 
-    if (_ota_dfu) {
-      disable_softdevice();
-    } else {
-      usb_teardown();
-    }
+    if (_ota_dfu) disable_softdevice();
+    if (!_ota_dfu || _dfu_dual) usb_teardown();
   }
 }
 
+bool dfu_transport_claim(bool ota) {
+  if (!_dfu_dual) return ota == _ota_dfu;
+
+  _dfu_dual = false;
+  _ota_dfu  = ota;
+
+  if (ota) {
+    // BLE has not taken any buffer before its START, the one kept by serial goes back to the pool
+    usb_teardown();
+    (void) dfu_transport_serial_close();
+    (void) hci_mem_pool_open();
+  } else {
+    // flash is written directly by USB transports, SoftDevice must be off
+    (void) dfu_transport_ble_close();
+    disable_softdevice();
+    usb_sd_disabled();
+  }
+
+  return true;
+}
+
 //--------------------------------------------------------------------+
 // BLE
 //--------------------------------------------------------------------+
@@ -385,6 +487,16 @@ static uint32_t ble_stack_init(void) {
   blecfg.conn_cfg.params.gap_conn_cfg.event_length = BLEGAP_EVENT_LENGTH;
   sd_ble_cfg_set(BLE_CONN_CFG_GAP, &blecfg, ram_start);
 
+  // L2CAP CoC channel for DFU data, MPS fits a 251 byte LL packet with Data Length Extension
+  varclr(&blecfg);
+  blecfg.conn_cfg.conn_cfg_tag = BLE_CONN_CFG_HIGH_BANDWIDTH;
+  blecfg.conn_cfg.params.l2cap_conn_cfg.rx_mps = BLEL2CAP_MPS_MAX;
+  blecfg.conn_cfg.params.l2cap_conn_cfg.tx_mps = BLE_L2CAP_MPS_MIN;
+  blecfg.conn_cfg.params.l2cap_conn_cfg.rx_queue_size = BLEL2CAP_RX_QUEUE_SIZE;
+  blecfg.conn_cfg.params.l2cap_conn_cfg.tx_queue_size = 1;
+  blecfg.conn_cfg.params.l2cap_conn_cfg.ch_count = 1;
+  sd_ble_cfg_set(BLE_CONN_CFG_L2CAP, &blecfg, ram_start);
+
   // Enable BLE stack.
   // Note: Interrupt state (enabled, forwarding) is not work properly if not enable ble
   sd_ble_enable(&ram_start);
@@ -24,6 +24,9 @@
 
 #include "boards.h"
 #include "qspi_flash.h"
+
+#define TRACE_MODULE_LEVEL  CFG_TRACE_LEVEL_QSPI
+#include "trace.h"
 #include "nrfx_qspi.h"
 #include "nrf_gpio.h"
 #include <string.h>
@@ -320,6 +323,41 @@ static qspi_flash_status_t qspi_flash_configure_quad_mode(void)
     return QSPI_FLASH_STATUS_SUCCESS;
 }
 
+#ifdef ENABLE_QSPI_XIP_APP
+// Re-activate QSPI for the application to execute in place. XIP window (0x12000000) maps
+// QSPI_XIP_APP_OFFSET and clock is raised to QSPI_XIP_SCK_FREQ. Called after board_teardown()
+// since pins are reset there, peripheral is left enabled for the app.
+qspi_flash_status_t qspi_flash_xip_enable(void)
+{
+    if (!g_qspi_initialized) {
+        return QSPI_FLASH_STATUS_ERROR;
+    }
+
+    // no program/erase must be in progress when the peripheral is re-activated
+    qspi_flash_status_t status = qspi_flash_wait_ready(1000);
+    if (status != QSPI_FLASH_STATUS_SUCCESS) {
+        return status;
+    }
+
+    nrfx_qspi_uninit();
+    g_qspi_initialized = false;
+
+    g_qspi_config.xip_offset      = QSPI_XIP_APP_OFFSET;
+    g_qspi_config.phy_if.sck_freq = QSPI_XIP_SCK_FREQ;
+
+    // Quad Enable bit is non-volatile, flash does not need to be configured again
+    if (nrfx_qspi_init(&g_qspi_config, NULL, NULL) != NRFX_SUCCESS) {
+        return QSPI_FLASH_STATUS_ERROR;
+    }
+
+    nrf_qspi_xip_offset_set(NRF_QSPI, g_qspi_config.xip_offset);
+    qspi_wait_ready();
+
+    g_qspi_initialized = true;
+    return QSPI_FLASH_STATUS_SUCCESS;
+}
+#endif
+
 // Read data from QSPI Flash
 qspi_flash_status_t qspi_flash_read(uint32_t address, uint8_t *data, size_t length)
 {
@@ -365,7 +403,7 @@ qspi_flash_status_t qspi_flash_write(uint32_t address, const uint8_t *data, size
         PRINTF("QSPI write: limited length to %u bytes\r\n", length);
     }
 
-    PRINTF("QSPI write: addr=0x%08lX, len=%u\r\n", address, length);
+    TRACE_DBG("QSPI write: addr=0x%08lX, len=%u", address, length);
 
     // Wait for previous operations to complete
     qspi_flash_status_t status = qspi_flash_wait_ready(1000);
@@ -94,6 +94,13 @@ uint8_t qspi_flash_get_status(void);
 // Set QSPI Flash XIPOFFSET
 void qspi_flash_set_xip_offset(uint32_t offset);
 
+#ifdef ENABLE_QSPI_XIP_APP
+// Configure QSPI for the application to execute in place, must be called right before jumping to app.
+// QSPI is handed over enabled: app finds pins, read mode, clock and XIP offset in NRF_QSPI registers
+// (PSEL, IFCONFIG0, IFCONFIG1, XIPOFFSET) and can run from 0x12000000 without initializing it again.
+qspi_flash_status_t qspi_flash_xip_enable(void);
+#endif
+
 // Configure W25Q16 for Quad mode (internal function)
 static qspi_flash_status_t qspi_flash_configure_quad_mode(void);
 
@@ -0,0 +1,79 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "boards.h"
+#include "app_scheduler.h"
+#include "hci_mem_pool.h"
+#include "pstorage.h"
+#include "ram_usage.h"
+#include "trace.h"
+
+// from linker script
+extern uint32_t __data_start__[];
+extern uint32_t __bss_end__[];
+extern uint32_t __HeapLimit[];
+extern uint32_t __StackLimit[];
+extern uint32_t __StackTop[];
+
+// words kept below current stack pointer while painting, for this function's own frame
+#define PAINT_MARGIN_WORDS  16
+
+void ram_usage_init(void)
+{
+  // an interrupt taken while painting would have its frame overwritten
+  uint32_t const primask = __get_PRIMASK();
+  __disable_irq();
+
+  uint32_t* const sp = (uint32_t*) __get_MSP();
+  for ( uint32_t* p = __StackLimit; p < sp - PAINT_MARGIN_WORDS; p++ ) *p = RAM_USAGE_PAINT;
+
+  __set_PRIMASK(primask);
+}
+
+void ram_usage_get(ram_usage_t* usage)
+{
+  uint32_t const* p = __StackLimit;
+  while ( (p < __StackTop) && (*p == RAM_USAGE_PAINT) ) p++;
+
+  usage->stack_size    = (uint32_t) __StackTop - (uint32_t) __StackLimit;
+  usage->stack_peak    = (uint32_t) __StackTop - (uint32_t) p;
+  usage->ram_static    = (uint32_t) __bss_end__ - (uint32_t) __data_start__;
+  usage->ram_unused    = (uint32_t) __StackLimit - (uint32_t) __HeapLimit;
+#if APP_SCHEDULER_WITH_PROFILER
+  usage->sched_peak    = app_sched_queue_utilization_get();
+#else
+  usage->sched_peak    = 0;
+#endif
+  usage->hci_peak      = hci_mem_pool_rx_peak_get();
+  usage->pstorage_peak = pstorage_queue_peak_get();
+}
+
+void ram_usage_report(void)
+{
+  ram_usage_t usage;
+  ram_usage_get(&usage);
+
+  TRACE_INF("Stack peak %lu of %lu, RAM static %lu, unused %lu", usage.stack_peak, usage.stack_size, usage.ram_static, usage.ram_unused);
+  TRACE_INF("Queue peak: scheduler %lu, hci %lu, pstorage %lu", usage.sched_peak, usage.hci_peak, usage.pstorage_peak);
+}
@@ -0,0 +1,65 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RAM_USAGE_H_
+#define RAM_USAGE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Stack high-water mark: the unused part of the stack is painted with RAM_USAGE_PAINT at startup,
+ * the deepest point reached since is where the paint ends. Peaks of the scheduler, HCI (serial
+ * DFU) and pstorage queues are kept by their modules, all are since reset i.e for the DFU mode
+ * of this boot only.
+ */
+
+#define RAM_USAGE_PAINT   0xC5C5C5C5UL
+
+typedef struct
+{
+  uint32_t stack_size;      // linker reserved stack
+  uint32_t stack_peak;      // deepest stack use since ram_usage_init()
+  uint32_t ram_static;      // .data + .bss
+  uint32_t ram_unused;      // between end of .bss/heap and stack limit
+  uint32_t sched_peak;      // scheduler queue, events. 0 unless APP_SCHEDULER_WITH_PROFILER, see sdk_config.h
+  uint32_t hci_peak;        // HCI RX memory pool, buffers
+  uint32_t pstorage_peak;   // pstorage command queue, operations
+} ram_usage_t;
+
+// Paint the unused stack, call first thing in main() before any deep call chain
+void ram_usage_init(void);
+
+void ram_usage_get(ram_usage_t* usage);
+
+// Log usage through trace (RTT), or PRINTF in debug builds
+void ram_usage_report(void);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* RAM_USAGE_H_ */
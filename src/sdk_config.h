@@ -50,7 +50,7 @@
 //==========================================================
 #define HCI_SLIP_ENABLED                   1
 
-#define HCI_UART_BAUDRATE                  UART_BAUDRATE_BAUDRATE_Baud115200
+#define HCI_UART_BAUDRATE                  UARTE_BAUDRATE_BAUDRATE_Baud115200 // initial rate, see uarte_serial.c for auto-baud
 #define HCI_UART_FLOW_CONTROL              HWFC
 #define HCI_UART_RX_PIN                    RX_PIN_NUMBER
 #define HCI_UART_TX_PIN                    TX_PIN_NUMBER
@@ -69,33 +69,27 @@
 #define HCI_RX_BUF_QUEUE_SIZE              8   // must be power of 2
 
 //==========================================================
-// <e> UART_ENABLED - nrf_drv_uart - UART/UARTE peripheral driver
-//==========================================================
-#define UART_ENABLED                       1
-#define UART_DEFAULT_CONFIG_HWFC           0
-#define UART_DEFAULT_CONFIG_PARITY         0
-#define UART_DEFAULT_CONFIG_BAUDRATE       UART_BAUDRATE_BAUDRATE_Baud115200
-#define UART_DEFAULT_CONFIG_IRQ_PRIORITY   7
-#define UART_EASY_DMA_SUPPORT              1
-#define UART_LEGACY_SUPPORT                1
-#define UART_CONFIG_LOG_ENABLED            0
-
-#define UART0_ENABLED                      1
-#define UART0_CONFIG_USE_EASY_DMA          0
-
-
-//==========================================================
-// <e> APP_UART_ENABLED - app_uart - UART driver
+// <e> APP_UART_ENABLED - app_uart - UART driver, implemented on UARTE EasyDMA by uarte_serial.c
 //==========================================================
 #define APP_UART_ENABLED                   1
-#define APP_UART_DRIVER_INSTANCE           0
+#define APP_UART_RX_CHUNK_SIZE             128 // EasyDMA transfer, RXD.MAXCNT is 8-bit on nRF52832, two of them
+#define APP_UART_RX_FLUSH_MS               2   // partial chunk is delivered after at most this long
 
 //==========================================================
 // <e> APP_SCHEDULER_ENABLED - app_scheduler - Events scheduler
 //==========================================================
 #define APP_SCHEDULER_ENABLED              1
 #define APP_SCHEDULER_WITH_PAUSE           0
-#define APP_SCHEDULER_WITH_PROFILER        0
+// Scheduler queue peak reported by ram_usage_get() (STATS.TXT, ram_usage_report()). Profiler adds
+// a compare to every event put, only enabled in debug builds unless CFG_SCHED_PROFILER=1
+#ifndef CFG_SCHED_PROFILER
+  #ifdef CFG_DEBUG
+    #define CFG_SCHED_PROFILER             1
+  #else
+    #define CFG_SCHED_PROFILER             0
+  #endif
+#endif
+#define APP_SCHEDULER_WITH_PROFILER        CFG_SCHED_PROFILER
 
 //==========================================================
 // <e> APP_TIMER_ENABLED - app_timer - Application timer functionality
@@ -0,0 +1,205 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include "sha256.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+#define ROR(x, n)     (((x) >> (n)) | ((x) << (32 - (n))))
+
+#define S0(x)         (ROR(x,  2) ^ ROR(x, 13) ^ ROR(x, 22))
+#define S1(x)         (ROR(x,  6) ^ ROR(x, 11) ^ ROR(x, 25))
+#define s0(x)         (ROR(x,  7) ^ ROR(x, 18) ^ ((x) >> 3))
+#define s1(x)         (ROR(x, 17) ^ ROR(x, 19) ^ ((x) >> 10))
+
+#define CH(x, y, z)   ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z)  (((x) & (y)) | ((z) & ((x) | (y))))
+
+// message schedule is kept as a rolling 16-word window
+#define W_LOAD(i)     (w[i])
+#define W_EXPAND(i)   (w[(i) & 15] += s1(w[((i) - 2) & 15]) + w[((i) - 7) & 15] + s0(w[((i) - 15) & 15]))
+
+#define ROUND(a, b, c, d, e, f, g, h, i, W) \
+  do { \
+    uint32_t const t1 = h + S1(e) + CH(e, f, g) + K[i] + W(i); \
+    d += t1; \
+    h  = t1 + S0(a) + MAJ(a, b, c); \
+  } while (0)
+
+// 8 rounds with variables rotated by name instead of moved
+#define ROUND8(i, W) \
+  do { \
+    ROUND(a, b, c, d, e, f, g, h, (i) + 0, W); \
+    ROUND(h, a, b, c, d, e, f, g, (i) + 1, W); \
+    ROUND(g, h, a, b, c, d, e, f, (i) + 2, W); \
+    ROUND(f, g, h, a, b, c, d, e, (i) + 3, W); \
+    ROUND(e, f, g, h, a, b, c, d, (i) + 4, W); \
+    ROUND(d, e, f, g, h, a, b, c, (i) + 5, W); \
+    ROUND(c, d, e, f, g, h, a, b, (i) + 6, W); \
+    ROUND(b, c, d, e, f, g, h, a, (i) + 7, W); \
+  } while (0)
+
+static const uint32_t K[64] =
+{
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// Process 64-byte block, input must be word aligned (REV instruction on Cortex-M4)
+static void sha256_transform (uint32_t state[8], uint32_t const* block)
+{
+  uint32_t w[16];
+
+  for ( uint32_t i = 0; i < 16; i++ ) w[i] = __builtin_bswap32(block[i]);
+
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+  ROUND8( 0, W_LOAD);
+  ROUND8( 8, W_LOAD);
+
+  for ( uint32_t i = 16; i < 64; i += 8 )
+  {
+    ROUND8(i, W_EXPAND);
+  }
+
+  state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+  state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+//--------------------------------------------------------------------+
+// API
+//--------------------------------------------------------------------+
+void sha256_init (sha256_t* ctx)
+{
+  static const uint32_t iv[8] =
+  {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+
+  memcpy(ctx->state, iv, sizeof(iv));
+  ctx->count   = 0;
+  ctx->buf_len = 0;
+}
+
+void sha256_update (sha256_t* ctx, void const* data, uint32_t len)
+{
+  uint8_t const* p_data = (uint8_t const*) data;
+  uint8_t* const buf = (uint8_t*) ctx->buf;
+
+  ctx->count += len;
+
+  // complete partial block first
+  if ( ctx->buf_len )
+  {
+    uint32_t const n = (len < SHA256_BLOCK_SIZE - ctx->buf_len) ? len : (SHA256_BLOCK_SIZE - ctx->buf_len);
+
+    memcpy(buf + ctx->buf_len, p_data, n);
+    ctx->buf_len += n;
+    p_data       += n;
+    len          -= n;
+
+    if ( ctx->buf_len < SHA256_BLOCK_SIZE ) return;
+
+    sha256_transform(ctx->state, ctx->buf);
+    ctx->buf_len = 0;
+  }
+
+  // hash directly from source when it is word aligned e.g flash or DFU buffers, else copy
+  while ( len >= SHA256_BLOCK_SIZE )
+  {
+    if ( ((uintptr_t) p_data) & 3 )
+    {
+      memcpy(buf, p_data, SHA256_BLOCK_SIZE);
+      sha256_transform(ctx->state, ctx->buf);
+    }
+    else
+    {
+      sha256_transform(ctx->state, (uint32_t const*) p_data);
+    }
+
+    p_data += SHA256_BLOCK_SIZE;
+    len    -= SHA256_BLOCK_SIZE;
+  }
+
+  if ( len )
+  {
+    memcpy(buf, p_data, len);
+    ctx->buf_len = len;
+  }
+}
+
+void sha256_final (sha256_t* ctx, uint8_t digest[SHA256_DIGEST_SIZE])
+{
+  uint8_t* const buf = (uint8_t*) ctx->buf;
+  uint32_t const bit_count = ctx->count << 3;
+
+  buf[ctx->buf_len++] = 0x80;
+
+  if ( ctx->buf_len > SHA256_BLOCK_SIZE - 8 )
+  {
+    memset(buf + ctx->buf_len, 0, SHA256_BLOCK_SIZE - ctx->buf_len);
+    sha256_transform(ctx->state, ctx->buf);
+    ctx->buf_len = 0;
+  }
+
+  // 64-bit big endian length, upper part is count >> 29
+  memset(buf + ctx->buf_len, 0, SHA256_BLOCK_SIZE - 8 - ctx->buf_len);
+  ctx->buf[14] = __builtin_bswap32(ctx->count >> 29);
+  ctx->buf[15] = __builtin_bswap32(bit_count);
+  sha256_transform(ctx->state, ctx->buf);
+
+  for ( uint32_t i = 0; i < 8; i++ )
+  {
+    uint32_t const v = __builtin_bswap32(ctx->state[i]);
+    memcpy(digest + 4*i, &v, 4);
+  }
+}
+
+void sha256_compute (void const* data, uint32_t len, uint8_t digest[SHA256_DIGEST_SIZE])
+{
+  sha256_t ctx;
+  sha256_init(&ctx);
+  sha256_update(&ctx, data, len);
+  sha256_final(&ctx, digest);
+}
+
+bool sha256_equal (uint8_t const a[SHA256_DIGEST_SIZE], uint8_t const b[SHA256_DIGEST_SIZE])
+{
+  // no early exit, time does not depend on position of first mismatch
+  volatile uint8_t diff = 0;
+
+  for ( uint32_t i = 0; i < SHA256_DIGEST_SIZE; i++ ) diff |= a[i] ^ b[i];
+
+  return diff == 0;
+}
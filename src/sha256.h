@@ -0,0 +1,61 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef SHA256_H_
+#define SHA256_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#define SHA256_DIGEST_SIZE    32
+#define SHA256_BLOCK_SIZE     64
+
+typedef struct
+{
+  uint32_t state[8];
+  uint32_t count;       // total bytes hashed, images are well below 4 GB
+  uint32_t buf_len;
+  uint32_t buf[SHA256_BLOCK_SIZE / 4];
+} sha256_t;
+
+void sha256_init   (sha256_t* ctx);
+void sha256_update (sha256_t* ctx, void const* data, uint32_t len);
+void sha256_final  (sha256_t* ctx, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+// One-shot digest of a memory range e.g flash
+void sha256_compute (void const* data, uint32_t len, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+// Compare digests in constant time
+bool sha256_equal (uint8_t const a[SHA256_DIGEST_SIZE], uint8_t const b[SHA256_DIGEST_SIZE]);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* SHA256_H_ */
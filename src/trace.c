@@ -0,0 +1,70 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "boards.h"
+#include "trace.h"
+
+#ifdef CFG_TRACE
+
+#include "SEGGER_RTT.h"
+
+#ifndef CFG_TRACE_BUFSIZE
+#define CFG_TRACE_BUFSIZE   2048
+#endif
+
+static uint8_t _trace_buf[CFG_TRACE_BUFSIZE];
+static uint32_t _trace_dropped;
+
+void trace_init(void)
+{
+  // records are skipped rather than blocking when host does not read fast enough,
+  // timing of traced code is never affected
+  SEGGER_RTT_ConfigUpBuffer(TRACE_RTT_CHANNEL, "trace", _trace_buf, sizeof(_trace_buf), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+
+  // cycle counter used for timestamps
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL  |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+void trace_write(uint32_t* rec, uint32_t count)
+{
+  rec[1] = DWT->CYCCNT;
+
+  // report the gap first so that the decoder shows where records are missing
+  if ( _trace_dropped )
+  {
+    uint32_t gap[3] = { TRACE_ID_DROPPED | (1UL << 24), rec[1], _trace_dropped };
+    if ( !SEGGER_RTT_Write(TRACE_RTT_CHANNEL, gap, sizeof(gap)) )
+    {
+      _trace_dropped++;
+      return;
+    }
+    _trace_dropped = 0;
+  }
+
+  if ( !SEGGER_RTT_Write(TRACE_RTT_CHANNEL, rec, count * 4) ) _trace_dropped++;
+}
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Deferred binary trace for hot paths (per block, per page). A record is the id of its format
+ * string, a cycle count timestamp and up to 4 raw 32-bit arguments, pushed into RTT up channel
+ * TRACE_RTT_CHANNEL without any formatting on target. Format strings live in .trace_fmt which
+ * is not loaded into flash, tools/tracedecode.py rebuilds the text from the elf.
+ *
+ * Enabled with TRACE=1 (CFG_TRACE). Arguments must be integers, %s is not supported.
+ * Without CFG_TRACE, records fall back to PRINTF in debug builds and are compiled out otherwise.
+ *
+ * Level filtering is per module at compile time: a module defines TRACE_MODULE_LEVEL before
+ * including this header, e.g CFG_TRACE_LEVEL_FLASH which can be overridden from command line.
+ */
+
+#define TRACE_LEVEL_NONE      0
+#define TRACE_LEVEL_ERROR     1
+#define TRACE_LEVEL_INFO      2
+#define TRACE_LEVEL_DEBUG     3
+
+#ifndef CFG_TRACE_LEVEL
+#define CFG_TRACE_LEVEL       TRACE_LEVEL_DEBUG
+#endif
+
+#ifndef CFG_TRACE_LEVEL_FLASH
+#define CFG_TRACE_LEVEL_FLASH CFG_TRACE_LEVEL
+#endif
+
+#ifndef CFG_TRACE_LEVEL_QSPI
+#define CFG_TRACE_LEVEL_QSPI  CFG_TRACE_LEVEL
+#endif
+
+#ifndef CFG_TRACE_LEVEL_UF2
+#define CFG_TRACE_LEVEL_UF2   CFG_TRACE_LEVEL
+#endif
+
+#ifndef TRACE_MODULE_LEVEL
+#define TRACE_MODULE_LEVEL    CFG_TRACE_LEVEL
+#endif
+
+#define TRACE_RTT_CHANNEL     1
+
+// id of the record emitted in place of records dropped while RTT buffer was full
+#define TRACE_ID_DROPPED      0xFFFFFFUL
+
+#define TRACE_ERR(...)        _TRACE_LEVEL(TRACE_LEVEL_ERROR, __VA_ARGS__)
+#define TRACE_INF(...)        _TRACE_LEVEL(TRACE_LEVEL_INFO , __VA_ARGS__)
+#define TRACE_DBG(...)        _TRACE_LEVEL(TRACE_LEVEL_DEBUG, __VA_ARGS__)
+
+#define _TRACE_LEVEL(_lvl, ...) \
+  do { \
+    if ( TRACE_MODULE_LEVEL >= (_lvl) ) { _TRACE_RECORD(__VA_ARGS__); } \
+  } while(0)
+
+#if defined(CFG_TRACE)
+
+// number of arguments after format string, up to 4
+#define _TRACE_NARG(...)                      _TRACE_NARG_(__VA_ARGS__, 4, 3, 2, 1, 0)
+#define _TRACE_NARG_(_f, _1, _2, _3, _4, N, ...) N
+
+// header word: format string id (offset in .trace_fmt) | argument count << 24, timestamp is filled by trace_write()
+#define _TRACE_RECORD(_fmt, ...) \
+  do { \
+    static char const _trace_fmt[] __attribute__ ((section(".trace_fmt"), used)) = _fmt; \
+    uint32_t _trace_rec[] = { (uint32_t) _trace_fmt | (_TRACE_NARG(_fmt, ##__VA_ARGS__) << 24), 0, ##__VA_ARGS__ }; \
+    trace_write(_trace_rec, sizeof(_trace_rec) / 4); \
+  } while(0)
+
+void trace_init  (void);
+void trace_write (uint32_t* rec, uint32_t count);
+
+#elif defined(CFG_DEBUG)
+
+#define _TRACE_RECORD(_fmt, ...)  PRINTF(_fmt "\r\n", ##__VA_ARGS__)
+
+#else
+
+#define _TRACE_RECORD(...)
+
+#endif
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,304 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "nrf.h"
+#include "nrf_gpio.h"
+#include "nrf_error.h"
+#include "app_util.h"
+#include "sdk_macros.h"
+#include "app_timer.h"
+#include "app_uart.h"
+#include "dfu_types.h"
+#include "sdk_config.h"
+
+//--------------------------------------------------------------------+
+// app_uart (without FIFO) on UARTE0 for serial DFU of nRF52832 boards.
+//
+// Reception runs in EasyDMA into two chunks, one interrupt per chunk instead of one per byte. Only
+// bytes EasyDMA has finished writing are handed to hci_slip: RXD.AMOUNT of a chunk on ENDRX, or once
+// the line went quiet, STOPRX then FLUSHRX for a partial chunk. RX is re-armed from the ENDRX
+// interrupt after the other chunk was handed over, never by a short: while the CPU is stalled (e.g.
+// flash erase) the receiver is left stopped with bytes in its FIFO, so that RTS holds the host off
+// when HWFC is enabled instead of EasyDMA overwriting a chunk not yet read.
+//
+// Baud rate starts at the one passed in and moves through _baud_rates on framing errors, after the
+// line went quiet (host retransmits the whole packet). It is locked once we send the first byte,
+// which is the ACK of a packet that passed the HCI checksum.
+//--------------------------------------------------------------------+
+
+STATIC_ASSERT(APP_UART_RX_CHUNK_SIZE <= 255);
+
+enum
+{
+  RX_RUNNING,   // STARTRX into _rx_chunk
+  RX_STOPPING,  // STOPRX for the flush, waiting for RXTO
+  RX_FLUSHING,  // FLUSHRX into _rx_chunk, waiting for ENDRX
+};
+
+static uint32_t const _baud_rates[] =
+{
+  UARTE_BAUDRATE_BAUDRATE_Baud115200,
+  UARTE_BAUDRATE_BAUDRATE_Baud1M,
+  UARTE_BAUDRATE_BAUDRATE_Baud460800,
+  UARTE_BAUDRATE_BAUDRATE_Baud230400,
+  UARTE_BAUDRATE_BAUDRATE_Baud921600,
+};
+
+APP_TIMER_DEF(_flush_timer);
+
+static app_uart_event_handler_t _event_handler;
+
+static uint8_t  _rx_buf[2][APP_UART_RX_CHUNK_SIZE] __attribute__((aligned(4)));
+static uint8_t  _rx_chunk;       // chunk loaded into RXD.PTR
+static uint8_t  _rx_state;
+static bool     _rx_partial;     // bytes received since the last ENDRX
+
+static uint8_t       _tx_byte;
+static volatile bool _tx_busy;
+
+static uint32_t      _baud_index;
+static bool          _baud_locked;
+static bool          _rx_error;
+static volatile bool _flush_tick;
+
+static void rx_start(void)
+{
+  NRF_UARTE0->RXD.PTR    = (uint32_t) _rx_buf[_rx_chunk];
+  NRF_UARTE0->RXD.MAXCNT = APP_UART_RX_CHUNK_SIZE;
+  NRF_UARTE0->TASKS_STARTRX = 1;
+}
+
+// hand over the chunk EasyDMA has just finished, then re-arm into the other one
+static void rx_end(void)
+{
+  uint8_t const* chunk  = _rx_buf[_rx_chunk];
+  uint32_t const amount = NRF_UARTE0->RXD.AMOUNT;
+
+  _rx_chunk   ^= 1;
+  _rx_partial  = false;
+
+  // stopping: RXTO follows, FIFO is flushed before the receiver is started again
+  if ( _rx_state != RX_STOPPING )
+  {
+    _rx_state = RX_RUNNING;
+    rx_start();
+  }
+
+  for ( uint32_t i = 0; i < amount; i++ )
+  {
+    app_uart_evt_t evt =
+    {
+      .evt_type   = APP_UART_DATA,
+      .data.value = chunk[i]
+    };
+
+    _event_handler(&evt);
+  }
+}
+
+static void flush_tick(void)
+{
+  // RXDRDY is never cleared but here, it only tells whether the line was active since last tick
+  bool const idle = !NRF_UARTE0->EVENTS_RXDRDY;
+  NRF_UARTE0->EVENTS_RXDRDY = 0;
+
+  if ( !idle )
+  {
+    _rx_partial = true;
+  }
+  else if ( _rx_partial && (_rx_state == RX_RUNNING) )
+  {
+    // line went quiet with a partial chunk: stop so that EasyDMA completes it
+    _rx_state = RX_STOPPING;
+    NRF_UARTE0->TASKS_STOPRX = 1;
+  }
+
+  // auto-baud: after errors, move on once the line is quiet (host waits then retransmits)
+  if ( _baud_locked || !_rx_error || !idle ) return;
+
+  _rx_error   = false;
+  _baud_index = (_baud_index + 1) % ARRAY_SIZE(_baud_rates);
+  NRF_UARTE0->BAUDRATE = _baud_rates[_baud_index];
+}
+
+// runs from scheduler, hand over to the UARTE interrupt so that handler is never re-entered
+static void flush_timer_handler(void* p_context)
+{
+  _flush_tick = true;
+  NVIC_SetPendingIRQ(UARTE0_UART0_IRQn);
+}
+
+void UARTE0_UART0_IRQHandler(void)
+{
+  if ( NRF_UARTE0->EVENTS_ENDRX )
+  {
+    NRF_UARTE0->EVENTS_ENDRX = 0;
+    rx_end();
+  }
+
+  if ( NRF_UARTE0->EVENTS_RXTO )
+  {
+    NRF_UARTE0->EVENTS_RXTO = 0;
+
+    // bytes received after STOPRX are still in the FIFO, ENDRX follows with them
+    _rx_state = RX_FLUSHING;
+    NRF_UARTE0->RXD.PTR    = (uint32_t) _rx_buf[_rx_chunk];
+    NRF_UARTE0->RXD.MAXCNT = APP_UART_RX_CHUNK_SIZE;
+    NRF_UARTE0->TASKS_FLUSHRX = 1;
+  }
+
+  if ( NRF_UARTE0->EVENTS_ERROR )
+  {
+    NRF_UARTE0->EVENTS_ERROR = 0;
+
+    uint32_t const errorsrc = NRF_UARTE0->ERRORSRC;
+    NRF_UARTE0->ERRORSRC = errorsrc;
+
+    if ( errorsrc & (UARTE_ERRORSRC_FRAMING_Msk | UARTE_ERRORSRC_BREAK_Msk) ) _rx_error = true;
+  }
+
+  if ( NRF_UARTE0->EVENTS_ENDTX )
+  {
+    NRF_UARTE0->EVENTS_ENDTX = 0;
+    _tx_busy = false;
+
+    app_uart_evt_t evt = { .evt_type = APP_UART_TX_EMPTY };
+    _event_handler(&evt);
+  }
+
+  if ( _flush_tick )
+  {
+    _flush_tick = false;
+    flush_tick();
+  }
+}
+
+uint32_t app_uart_init(const app_uart_comm_params_t* p_comm_params, app_uart_buffers_t* p_buffers,
+                       app_uart_event_handler_t event_handler, app_irq_priority_t irq_priority)
+{
+  _event_handler = event_handler;
+
+  _rx_chunk      = 0;
+  _rx_state      = RX_RUNNING;
+  _rx_partial    = false;
+  _rx_error      = false;
+  _tx_busy       = false;
+  _baud_locked   = false;
+  _flush_tick    = false;
+
+  // rate not in the table: start with it anyway, first step goes to the top of the table
+  _baud_index = ARRAY_SIZE(_baud_rates) - 1;
+  for ( uint32_t i = 0; i < ARRAY_SIZE(_baud_rates); i++ )
+  {
+    if ( _baud_rates[i] == p_comm_params->baud_rate ) _baud_index = i;
+  }
+
+  nrf_gpio_pin_set(p_comm_params->tx_pin_no);
+  nrf_gpio_cfg_output(p_comm_params->tx_pin_no);
+  nrf_gpio_cfg_input(p_comm_params->rx_pin_no, NRF_GPIO_PIN_NOPULL);
+
+  NRF_UARTE0->PSEL.TXD = p_comm_params->tx_pin_no;
+  NRF_UARTE0->PSEL.RXD = p_comm_params->rx_pin_no;
+
+  uint32_t config = (p_comm_params->use_parity ? UARTE_CONFIG_PARITY_Included : UARTE_CONFIG_PARITY_Excluded) << UARTE_CONFIG_PARITY_Pos;
+
+  if ( p_comm_params->flow_control == APP_UART_FLOW_CONTROL_ENABLED )
+  {
+    nrf_gpio_pin_set(p_comm_params->rts_pin_no);
+    nrf_gpio_cfg_output(p_comm_params->rts_pin_no);
+    nrf_gpio_cfg_input(p_comm_params->cts_pin_no, NRF_GPIO_PIN_NOPULL);
+
+    NRF_UARTE0->PSEL.RTS = p_comm_params->rts_pin_no;
+    NRF_UARTE0->PSEL.CTS = p_comm_params->cts_pin_no;
+    config |= UARTE_CONFIG_HWFC_Enabled << UARTE_CONFIG_HWFC_Pos;
+  }
+  else
+  {
+    NRF_UARTE0->PSEL.RTS = UART_PIN_DISCONNECTED;
+    NRF_UARTE0->PSEL.CTS = UART_PIN_DISCONNECTED;
+  }
+
+  NRF_UARTE0->CONFIG   = config;
+  NRF_UARTE0->BAUDRATE = p_comm_params->baud_rate;
+
+  NRF_UARTE0->ENABLE = UARTE_ENABLE_ENABLE_Enabled;
+
+  NRF_UARTE0->EVENTS_RXDRDY    = 0;
+  NRF_UARTE0->EVENTS_ENDRX     = 0;
+  NRF_UARTE0->EVENTS_ERROR     = 0;
+  NRF_UARTE0->EVENTS_ENDTX     = 0;
+  NRF_UARTE0->EVENTS_RXTO      = 0;
+
+  NRF_UARTE0->SHORTS   = 0;
+  NRF_UARTE0->INTENSET = UARTE_INTENSET_ENDRX_Msk | UARTE_INTENSET_RXTO_Msk |
+                         UARTE_INTENSET_ERROR_Msk | UARTE_INTENSET_ENDTX_Msk;
+
+  NVIC_ClearPendingIRQ(UARTE0_UART0_IRQn);
+  NVIC_SetPriority(UARTE0_UART0_IRQn, irq_priority);
+  NVIC_EnableIRQ(UARTE0_UART0_IRQn);
+
+  rx_start();
+
+  uint32_t const err_code = app_timer_create(&_flush_timer, APP_TIMER_MODE_REPEATED, flush_timer_handler);
+  VERIFY_SUCCESS(err_code);
+
+  return app_timer_start(_flush_timer, APP_TIMER_TICKS(APP_UART_RX_FLUSH_MS), NULL);
+}
+
+uint32_t app_uart_put(uint8_t byte)
+{
+  if ( _tx_busy ) return NRF_ERROR_BUSY;
+
+  // only a packet that made it through HCI is answered, current rate is the host's
+  _baud_locked = true;
+
+  _tx_busy = true;
+  _tx_byte = byte;
+
+  NRF_UARTE0->TXD.PTR       = (uint32_t) &_tx_byte;
+  NRF_UARTE0->TXD.MAXCNT    = 1;
+  NRF_UARTE0->TASKS_STARTTX = 1;
+
+  return NRF_SUCCESS;
+}
+
+uint32_t app_uart_close(void)
+{
+  (void) app_timer_stop(_flush_timer);
+
+  NVIC_DisableIRQ(UARTE0_UART0_IRQn);
+  NRF_UARTE0->INTENCLR = 0xFFFFFFFFUL;
+
+  // receiver runs until STOPRX even when no chunk is armed, unless a flush has already stopped it
+  if ( _rx_state != RX_FLUSHING )
+  {
+    if ( _rx_state == RX_RUNNING ) NRF_UARTE0->TASKS_STOPRX = 1;
+    while ( !NRF_UARTE0->EVENTS_RXTO ) {}
+  }
+
+  NRF_UARTE0->TASKS_STOPTX = 1;
+  NRF_UARTE0->ENABLE = UARTE_ENABLE_ENABLE_Disabled;
+
+  return NRF_SUCCESS;
+}
@@ -28,6 +28,14 @@
 #if CFG_TUD_MSC
 
 #include "bootloader.h"
+#include "flash_nrf5x.h"
+#include "dfu_init.h"
+#include "crc16.h"
+#include "app_scheduler.h"
+
+#ifdef ENABLE_QSPI_STAGING
+#include "qspi_flash.h"
+#endif
 
 /*------------------------------------------------------------------*/
 /* MACRO TYPEDEF CONSTANT ENUM
@@ -37,10 +45,355 @@
 /* UF2
  *------------------------------------------------------------------*/
 static WriteState _wr_state = { 0 };
+static uint8_t _app_digest[SHA256_DIGEST_SIZE];
 
 void read_block(uint32_t block_no, uint8_t *data);
 int  write_block(uint32_t block_no, uint8_t *data, WriteState *state);
 
+/*------------------------------------------------------------------*/
+/* Double buffering
+ *------------------------------------------------------------------*/
+
+// Read-ahead older than this is generated again, STATS.TXT and flash contents are live
+#define MSC_READ_AHEAD_MS   100
+
+enum {
+  MSC_CHUNK_IDLE = 0,
+  MSC_CHUNK_WRITE,       // received chunk waiting to be written by scheduler
+  MSC_CHUNK_READ_AHEAD,  // chunk following last read waiting to be generated by scheduler
+  MSC_CHUNK_READ_READY,  // chunk following last read generated
+};
+
+// Second chunk buffer next to tinyusb's own. A received chunk is handed over here and written to
+// flash by the scheduler while tinyusb already receives the next one. Likewise the chunk following
+// a read is generated here while tinyusb sends the current one.
+static struct {
+  uint8_t  state;
+  bool     write_complete; // WRITE10 status sent while its last chunk was still pending
+  uint32_t lba;
+  uint32_t count;          // bytes in buffer
+  uint32_t done;           // bytes of a write chunk processed so far
+  uint32_t ready_ms;       // when read-ahead was generated
+  uint32_t read_next;      // lba following the last READ10 chunk, 0 if none
+
+  uint8_t buf[CFG_TUD_MSC_BUFSIZE] __attribute__((aligned(4)));
+} _msc_chunk;
+
+static void msc_write_complete(void);
+static void msc_write_complete_task (void* p_event_data, uint16_t event_size);
+
+static void msc_read_blocks (uint32_t lba, uint8_t* buffer, uint32_t bufsize)
+{
+  memset(buffer, 0, bufsize);
+
+  for ( uint32_t count = 0; count < bufsize; count += 512 )
+  {
+    read_block(lba, buffer);
+
+    lba++;
+    buffer += 512;
+  }
+}
+
+static void msc_chunk_read_task (void* p_event_data, uint16_t event_size)
+{
+  (void) p_event_data; (void) event_size;
+
+  // cancelled by a write in the meantime
+  if ( _msc_chunk.state != MSC_CHUNK_READ_AHEAD ) return;
+
+  msc_read_blocks(_msc_chunk.lba, _msc_chunk.buf, _msc_chunk.count);
+
+  _msc_chunk.state    = MSC_CHUNK_READ_READY;
+  _msc_chunk.ready_ms = board_millis();
+}
+
+static void msc_chunk_write_task (void* p_event_data, uint16_t event_size)
+{
+  (void) p_event_data; (void) event_size;
+
+  // already written by msc_chunk_write_drain()
+  if ( _msc_chunk.state != MSC_CHUNK_WRITE ) return;
+
+  while ( _msc_chunk.done < _msc_chunk.count )
+  {
+    // Consider non-uf2 block write as successful
+    // only stop if write_block is busy with flashing (return 0), carry on with next scheduler run
+    if ( 0 == write_block(_msc_chunk.lba + _msc_chunk.done / 512, _msc_chunk.buf + _msc_chunk.done, &_wr_state) )
+    {
+      app_sched_event_put(NULL, 0, msc_chunk_write_task);
+      return;
+    }
+
+    _msc_chunk.done += 512;
+  }
+
+  _msc_chunk.state = MSC_CHUNK_IDLE;
+
+  if ( _msc_chunk.write_complete )
+  {
+    _msc_chunk.write_complete = false;
+    msc_write_complete();
+  }
+}
+
+// Next command arrived before scheduler got to the pending chunk: write it now. tinyusb must not
+// be told to retry instead, it would spin in tud_task() without the scheduler ever running.
+static void msc_chunk_write_drain (void)
+{
+  while ( _msc_chunk.state == MSC_CHUNK_WRITE )
+  {
+    msc_chunk_write_task(NULL, 0);
+  }
+}
+
+#ifdef ENABLE_QSPI_XIP_APP
+// XIP part received in this session is recorded with the app, so that it is validated on boot
+static void xip_part_record (dfu_update_status_t* update_status)
+{
+  if ( !_wr_state.xip_end ) return;
+
+  update_status->xip_size = _wr_state.xip_end - QSPI_XIP_APP_OFFSET;
+  update_status->xip_crc  = flash_nrf5x_qspi_crc16(QSPI_XIP_APP_OFFSET, update_status->xip_size);
+
+  PRINTF("XIP part: %lu bytes\r\n", update_status->xip_size);
+}
+#endif
+
+static inline bool xip_part_received (void)
+{
+#ifdef ENABLE_QSPI_XIP_APP
+  return _wr_state.xip_end != 0;
+#else
+  return false;
+#endif
+}
+
+// Read back part of the received bootloader, wherever it was staged
+static void boot_stage_read (uint32_t addr, void* buf, uint32_t len)
+{
+#ifdef ENABLE_QSPI_STAGING
+  if ( addr >= CFG_UF2_QSPI_XIP_OFFSET )
+  {
+    qspi_flash_read(addr - CFG_UF2_QSPI_XIP_OFFSET, (uint8_t*) buf, len);
+    return;
+  }
+#endif
+
+  memcpy(buf, (void const*) addr, len);
+}
+
+// Number of pages of the received bootloader that differ from the running one
+static uint32_t boot_pages_changed (uint32_t stage)
+{
+  uint32_t buf[64];
+  uint32_t changed = 0;
+
+  for ( uint32_t page = 0; page < DFU_BL_IMAGE_MAX_SIZE; page += CODE_PAGE_SIZE )
+  {
+    for ( uint32_t offset = page; offset < page + CODE_PAGE_SIZE; offset += sizeof(buf) )
+    {
+      boot_stage_read(stage + offset, buf, sizeof(buf));
+
+      if ( memcmp(buf, (void const*) (BOOTLOADER_ADDR_START + offset), sizeof(buf)) )
+      {
+        changed++;
+        break;
+      }
+    }
+  }
+
+  return changed;
+}
+
+#ifdef ENABLE_QSPI_STAGING
+// Move bootloader received into QSPI to the internal slot MBR copies it from. If the app reaches
+// into the slot, the pages it covers are saved next to it in the staging slot first and put back
+// by the staged commit on next boot i.e by the new bootloader.
+static bool boot_stage_commit (uint32_t stage)
+{
+  uint32_t const slot = BOOTLOADER_ADDR_NEW_RECIEVED;
+
+  if ( !uf2_boot_slot_free() )
+  {
+    uint32_t const backup = CFG_UF2_QSPI_STAGING_OFFSET + (slot - USER_FLASH_START);
+    uint32_t buf[64];
+
+    // QSPI EasyDMA cannot read from internal flash, go through RAM
+    for ( uint32_t offset = 0; offset < DFU_BL_IMAGE_MAX_SIZE; offset += sizeof(buf) )
+    {
+      memcpy(buf, (void const*) (slot + offset), sizeof(buf));
+      if ( !flash_nrf5x_write(CFG_UF2_QSPI_XIP_OFFSET + backup + offset, buf, sizeof(buf), true) ) return false;
+    }
+    if ( !flash_nrf5x_flush(true) ) return false;
+
+    uint16_t const crc = crc16_compute((uint8_t const*) slot, DFU_BL_IMAGE_MAX_SIZE, NULL);
+    if ( flash_nrf5x_qspi_crc16(backup, DFU_BL_IMAGE_MAX_SIZE) != crc ) return false;
+
+    dfu_update_status_t update_status;
+    memset(&update_status, 0, sizeof(dfu_update_status_t ));
+    update_status.status_code     = DFU_UPDATE_APP_BACKED_UP;
+    update_status.app_image_start = slot;
+    update_status.app_size        = DFU_BL_IMAGE_MAX_SIZE;
+    update_status.app_crc         = crc;
+
+    bootloader_dfu_update_process(update_status);
+
+    PRINTF("App pages under bootloader slot saved to QSPI\r\n");
+  }
+
+  if ( !flash_nrf5x_copy_from_qspi(slot, stage - CFG_UF2_QSPI_XIP_OFFSET, DFU_BL_IMAGE_MAX_SIZE) ) return false;
+
+  return flash_nrf5x_qspi_crc16(stage - CFG_UF2_QSPI_XIP_OFFSET, DFU_BL_IMAGE_MAX_SIZE) ==
+         crc16_compute((uint8_t const*) slot, DFU_BL_IMAGE_MAX_SIZE, NULL);
+}
+#endif
+
+#ifdef ENABLE_QSPI_STAGING
+STATIC_ASSERT((USER_FLASH_END - USER_FLASH_START) / CODE_PAGE_SIZE <= BOOTLOADER_STAGED_PAGES_MAX);
+
+// Code pages of the staging slot written in this session, committed on next boot
+static uint8_t _staged_pages[BOOTLOADER_STAGED_PAGES_MAX / 8];
+
+static bool staged_unit_written (uint32_t addr)
+{
+  uint32_t const unit = (addr - USER_FLASH_START) / UF2_STAGED_UNIT_SIZE;
+  return _wr_state.staged_mask[unit / 8] & (1 << (unit % 8));
+}
+
+// Units of a written page the host left out are filled in with what internal flash holds there,
+// so that the commit can copy written pages whole and leave all others alone. Runs before the
+// slot is verified, its sectors were erased on first write in this session. Return false if QSPI
+// failed to verify.
+static bool staged_pages_complete (void)
+{
+  uint32_t const first_page = _wr_state.staged_start & ~(CODE_PAGE_SIZE - 1);
+  uint32_t buf[UF2_STAGED_UNIT_SIZE / 4];
+
+  memset(_staged_pages, 0, sizeof(_staged_pages));
+
+  for ( uint32_t page_addr = first_page; page_addr < _wr_state.staged_end; page_addr += CODE_PAGE_SIZE )
+  {
+    bool written = false;
+
+    for ( uint32_t addr = page_addr; !written && addr < page_addr + CODE_PAGE_SIZE; addr += UF2_STAGED_UNIT_SIZE )
+    {
+      written = staged_unit_written(addr);
+    }
+
+    if ( !written ) continue;
+
+    uint32_t const page = (page_addr - first_page) / CODE_PAGE_SIZE;
+    _staged_pages[page / 8] |= (uint8_t) (1 << (page % 8));
+
+    for ( uint32_t addr = page_addr; addr < page_addr + CODE_PAGE_SIZE; addr += UF2_STAGED_UNIT_SIZE )
+    {
+      if ( staged_unit_written(addr) ) continue;
+
+      // QSPI EasyDMA cannot read from internal flash, go through RAM
+      memcpy(buf, (void const*) addr, sizeof(buf));
+      if ( !flash_nrf5x_write(CFG_UF2_QSPI_XIP_OFFSET + CFG_UF2_QSPI_STAGING_OFFSET + (addr - USER_FLASH_START), buf, sizeof(buf), true) )
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+// Staged range from addr to the end of its unit as internal flash holds it once committed: written
+// pages come from the slot, the others stay as they are
+static uint8_t const* staged_unit_get (uint32_t addr, uint32_t* count, uint32_t buf[UF2_STAGED_UNIT_SIZE / 4])
+{
+  uint32_t const first_page = _wr_state.staged_start & ~(CODE_PAGE_SIZE - 1);
+  uint32_t const page       = ((addr & ~(CODE_PAGE_SIZE - 1)) - first_page) / CODE_PAGE_SIZE;
+  uint32_t const unit_end   = (addr & ~(UF2_STAGED_UNIT_SIZE - 1)) + UF2_STAGED_UNIT_SIZE;
+
+  *count = ((unit_end < _wr_state.staged_end) ? unit_end : _wr_state.staged_end) - addr;
+
+  if ( !(_staged_pages[page / 8] & (1 << (page % 8))) ) return (uint8_t const*) addr;
+
+  qspi_flash_read(CFG_UF2_QSPI_STAGING_OFFSET + (addr - USER_FLASH_START), (uint8_t*) buf, *count);
+  return (uint8_t const*) buf;
+}
+
+static uint16_t staged_crc16 (void)
+{
+  uint32_t buf[UF2_STAGED_UNIT_SIZE / 4];
+  uint16_t crc = 0xFFFF;
+
+  for ( uint32_t addr = _wr_state.staged_start; addr < _wr_state.staged_end; )
+  {
+    uint32_t count;
+    uint8_t const* data = staged_unit_get(addr, &count, buf);
+
+    crc   = crc16_compute(data, count, &crc);
+    addr += count;
+  }
+
+  return crc;
+}
+
+// Digest of bank 0 once committed, same range the boot check covers. Only if the staged range
+// starts with the app, SoftDevice may come ahead of it.
+static bool staged_sha256 (uint8_t digest[SHA256_DIGEST_SIZE])
+{
+  uint32_t buf[UF2_STAGED_UNIT_SIZE / 4];
+  sha256_t sha;
+
+  if ( (_wr_state.staged_start > DFU_BANK_0_REGION_START) || (_wr_state.staged_end <= DFU_BANK_0_REGION_START) ) return false;
+
+  sha256_init(&sha);
+
+  for ( uint32_t addr = DFU_BANK_0_REGION_START; addr < _wr_state.staged_end; )
+  {
+    uint32_t count;
+    uint8_t const* data = staged_unit_get(addr, &count, buf);
+
+    sha256_update(&sha, data, count);
+    addr += count;
+  }
+
+  sha256_final(&sha, digest);
+  return true;
+}
+#endif
+
+#ifdef DFU_SIGNING_PUBKEY
+// Check signature block against the digest of received app. Digest streamed while writing is
+// used if it covers exactly the signed range, otherwise it is computed from flash.
+static bool app_signature_valid (uint8_t digest[SHA256_DIGEST_SIZE])
+{
+  uint32_t const size = _wr_state.signed_size;
+
+  if ( !_wr_state.has_signature || (_wr_state.signed_start != DFU_BANK_0_REGION_START) ||
+       (size == 0) || (size > USER_FLASH_END - DFU_BANK_0_REGION_START) )
+  {
+    return false;
+  }
+
+#ifdef ENABLE_QSPI_STAGING
+  // signed range must be exactly what is committed from staging slot on next boot
+  if ( (_wr_state.staged_start != DFU_BANK_0_REGION_START) || (_wr_state.staged_end != DFU_BANK_0_REGION_START + size) ) return false;
+
+  // digest of bank 0 as the commit leaves it
+  staged_sha256(digest);
+#else
+  if ( _wr_state.sha_next == DFU_BANK_0_REGION_START + size )
+  {
+    sha256_final(&_wr_state.sha, digest);
+  }
+  else
+  {
+    sha256_compute((void const*) DFU_BANK_0_REGION_START, size, digest);
+  }
+#endif
+
+  return dfu_init_signature_verify(digest, _wr_state.signature);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // tinyusb callbacks
 //--------------------------------------------------------------------+
@@ -117,48 +470,94 @@ int32_t tud_msc_scsi_cb (uint8_t lun, uint8_t const scsi_cmd[16], void* buffer,
 int32_t tud_msc_read10_cb (uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize)
 {
   (void) lun;
-  memset(buffer, 0, bufsize);
 
   // since we return block size each, offset should always be zero
   TU_ASSERT(offset == 0, -1);
 
-  uint32_t count = 0;
+  msc_chunk_write_drain();
 
-  while ( count < bufsize )
+  if ( (_msc_chunk.state == MSC_CHUNK_READ_READY) && (_msc_chunk.lba == lba) && (bufsize <= _msc_chunk.count) &&
+       (board_millis() - _msc_chunk.ready_ms < MSC_READ_AHEAD_MS) )
   {
-    read_block(lba, buffer);
+    memcpy(buffer, _msc_chunk.buf, bufsize);
+  }
+  else
+  {
+    msc_read_blocks(lba, buffer, bufsize);
+  }
 
-    lba++;
-    buffer += 512;
-    count  += 512;
+  // generate next chunk while this one is sent, once the host is seen reading sequentially:
+  // directory and FAT lookups would only make the scheduler render sectors nobody asks for
+  uint32_t const next = lba + bufsize / 512;
+  bool const sequential = (lba == _msc_chunk.read_next);
+
+  _msc_chunk.read_next = next;
+
+  if ( sequential && (next < CFG_UF2_NUM_BLOCKS) )
+  {
+    bool const queued = (_msc_chunk.state == MSC_CHUNK_READ_AHEAD);
+
+    _msc_chunk.state = MSC_CHUNK_READ_AHEAD;
+    _msc_chunk.lba   = next;
+    _msc_chunk.count = (CFG_UF2_NUM_BLOCKS - next < sizeof(_msc_chunk.buf) / 512) ? (CFG_UF2_NUM_BLOCKS - next) * 512 : sizeof(_msc_chunk.buf);
+
+    if ( !queued ) app_sched_event_put(NULL, 0, msc_chunk_read_task);
+  }
+  else
+  {
+    _msc_chunk.state = MSC_CHUNK_IDLE;
   }
 
-  return count;
+  return bufsize;
 }
 
 // Callback invoked when received WRITE10 command.
 // Process data in buffer to disk's storage and return number of written bytes
+// Chunk is only handed over, it is written by the scheduler while tinyusb receives the next one.
 int32_t tud_msc_write10_cb (uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize)
 {
   (void) lun;
+  (void) offset;
 
-  uint32_t count = 0;
-  while ( count < bufsize )
-  {
-    // Consider non-uf2 block write as successful
-    // only break if write_block is busy with flashing (return 0)
-    if ( 0 == write_block(lba, buffer, &_wr_state) ) break;
+  msc_chunk_write_drain();
 
-    lba++;
-    buffer += 512;
-    count  += 512;
-  }
+  // any read-ahead is dropped, flash is about to change
+  _msc_chunk.state     = MSC_CHUNK_WRITE;
+  _msc_chunk.read_next = 0;
+  _msc_chunk.lba       = lba;
+  _msc_chunk.count     = bufsize;
+  _msc_chunk.done      = 0;
+  memcpy(_msc_chunk.buf, buffer, bufsize);
+
+  app_sched_event_put(NULL, 0, msc_chunk_write_task);
 
-  return count;
+  return bufsize;
 }
 
 // Callback invoked when WRITE10 command is completed (status received and accepted by host).
 void tud_msc_write10_complete_cb(uint8_t lun)
+{
+  (void) lun;
+
+  // last chunk of the command may still be waiting for the scheduler
+  if ( _msc_chunk.state == MSC_CHUNK_WRITE )
+  {
+    _msc_chunk.write_complete = true;
+  }
+  else
+  {
+    // completing the session reads back QSPI, keep that out of the usb task
+    app_sched_event_put(NULL, 0, msc_write_complete_task);
+  }
+}
+
+static void msc_write_complete_task (void* p_event_data, uint16_t event_size)
+{
+  (void) p_event_data; (void) event_size;
+  msc_write_complete();
+}
+
+static void msc_write_complete(void)
 {
   static bool first_write = true;
 
@@ -191,19 +590,41 @@ void tud_msc_write10_complete_cb(uint8_t lun)
       dfu_update_status_t update_status;
       memset(&update_status, 0, sizeof(dfu_update_status_t ));
 
+      PRINTF("Blocks: SD %lu, App %lu, QSPI %lu, Bootloader %lu\r\n",
+             _wr_state.region_blocks[UF2_REGION_SD], _wr_state.region_blocks[UF2_REGION_APP],
+             _wr_state.region_blocks[UF2_REGION_QSPI], _wr_state.region_blocks[UF2_REGION_BOOTLOADER]);
+
+#ifdef ENABLE_QSPI_STAGING
+      bool const staged_ok = !_wr_state.staged_end || staged_pages_complete();
+#endif
+
       if ( _wr_state.update_bootloader )
       {
         // update bootloader always end with reset
         update_status.status_code = DFU_RESET;
 
         // Location of current stored new bootloader
-        uint32_t * new_bootloader = (uint32_t *) BOOTLOADER_ADDR_NEW_RECIEVED;
+        uint32_t const stage = _wr_state.boot_stage;
+        uint32_t const changed = stage ? boot_pages_changed(stage) : 0; // 0 if only UICR was received
 
-        PRINT_HEX(new_bootloader);
+        PRINT_HEX(stage);
+        PRINTF("Bootloader pages changed: %lu\r\n", changed);
 
         // skip if there is no bootloader change
-        if ( memcmp(new_bootloader, (uint8_t*) BOOTLOADER_ADDR_START, DFU_BL_IMAGE_MAX_SIZE) )
+        bool copy_bl = (changed > 0);
+
+#ifdef ENABLE_QSPI_STAGING
+        if ( copy_bl && !boot_stage_commit(stage) )
+        {
+          PRINTF("Failed to move new bootloader into internal slot\r\n");
+          copy_bl = false;
+        }
+#endif
+
+        if ( copy_bl )
         {
+          uint32_t * new_bootloader = (uint32_t *) BOOTLOADER_ADDR_NEW_RECIEVED;
+
           PRINTF("Coyping new bootloader\r\n");
 
           sd_mbr_command_t command =
@@ -218,17 +639,108 @@ void tud_msc_write10_complete_cb(uint8_t lun)
         }
 
         PRINTF("bootloader update complete\r\n");
-      }else
+      }
+      else if ( !_wr_state.region_blocks[UF2_REGION_SD] && !_wr_state.region_blocks[UF2_REGION_APP] && !xip_part_received() )
       {
+        // QSPI data only, application and its settings are untouched
+        update_status.status_code = DFU_RESET;
+
+        PRINTF("QSPI data update complete\r\n");
+      }
+#ifdef ENABLE_QSPI_STAGING
+      else if ( !staged_ok )
+      {
+        // current app is untouched, staged image is simply not committed
+        update_status.status_code = DFU_RESET;
+
+        PRINTF("Staging slot failed to verify\r\n");
+      }
+#endif
+#ifdef DFU_SIGNING_PUBKEY
+      else if ( !app_signature_valid(_app_digest) )
+      {
+#ifdef ENABLE_QSPI_STAGING
+        // current app is untouched, staged image is simply not committed
+        update_status.status_code = DFU_RESET;
+#else
+        // app is invalidated since its first write, stay in DFU mode for another try
+        update_status.status_code = DFU_BANK_0_ERASED;
+#endif
+        PRINTF("Invalid signature\r\n");
+      }
+#endif
+      else
+      {
+#ifdef ENABLE_QSPI_XIP_APP
+        xip_part_record(&update_status);
+#endif
+
+#ifdef ENABLE_QSPI_STAGING
+        if ( !_wr_state.staged_end )
+        {
+          // only the XIP part was updated, nothing to commit into internal flash
+          update_status.status_code = DFU_UPDATE_APP_COMPLETE;
+
+          PRINTF("XIP application part update complete\r\n");
+        }
+        else
+        {
+          // App is in QSPI staging slot: record it so that it is committed into internal flash on next boot
+          uint32_t const staged_size = _wr_state.staged_end - _wr_state.staged_start;
+
+          update_status.status_code     = DFU_UPDATE_APP_STAGED;
+          update_status.app_image_start = _wr_state.staged_start;
+          update_status.app_size        = staged_size;
+          update_status.app_crc         = staged_crc16();
+          update_status.p_staged_pages  = _staged_pages;
+
+          // digest of bank 0 once committed (verified against the signature above if signed) is kept
+          // until the commit, then checked on boot like for an in place update
+#ifndef DFU_SIGNING_PUBKEY
+          if ( staged_sha256(_app_digest) )
+#endif
+          {
+            update_status.app_digest_size = _wr_state.staged_end - DFU_BANK_0_REGION_START;
+            update_status.p_app_sha256    = _app_digest;
+          }
+
+          PRINTF("Application staged\r\n");
+        }
+#else
         // update App
         update_status.status_code = DFU_UPDATE_APP_COMPLETE;
 
+#ifdef DFU_SIGNING_PUBKEY
+        // digest is verified against the signature above
+        update_status.app_size     = _wr_state.signed_size;
+        update_status.p_app_sha256 = _app_digest;
+#else
+        // whole image was received in order, record its digest for boot verification
+        if ( _wr_state.sha_next && (_wr_state.sha_next != UINT32_MAX) )
+        {
+          sha256_final(&_wr_state.sha, _app_digest);
+          update_status.app_size     = _wr_state.sha_next - DFU_BANK_0_REGION_START;
+          update_status.p_app_sha256 = _app_digest;
+        }
+#endif
+
         PRINTF("Application update complete\r\n");
+#endif
       }
 
       bootloader_dfu_update_process(update_status);
 
       led_state(STATE_WRITING_FINISHED);
+
+      // DFU mode carries on, next uf2 file copied by host starts a new session
+      if ( update_status.status_code == DFU_BANK_0_ERASED )
+      {
+        memset(&_wr_state, 0, sizeof(_wr_state));
+        first_write = true;
+#ifdef ENABLE_QSPI_FLASH
+        flash_nrf5x_reset_qspi_erase_cache();
+#endif
+      }
     }
   }
 }
@@ -258,7 +770,8 @@ bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bool start, boo
       // load disk storage
     }else
     {
-      // unload disk storage
+      // unload disk storage, host is done with its view of the volume
+      uf2_meta_overlay_clear();
     }
   }
 
@@ -63,8 +63,15 @@
 #define CFG_TUD_CDC_RX_BUFSIZE      1024
 #define CFG_TUD_CDC_TX_BUFSIZE      1024
 
-// Buffer size for each read/write transfer, the more the better
+// Buffer size for each read/write transfer, the more the better. msc_uf2.c keeps a second
+// buffer of the same size so that the next transfer overlaps processing of the current one.
+#ifndef CFG_TUD_MSC_BUFSIZE
 #define CFG_TUD_MSC_BUFSIZE         (4*1024)
+#endif
+
+#if (CFG_TUD_MSC_BUFSIZE > 16*1024) || (CFG_TUD_MSC_BUFSIZE % 512)
+  #error "CFG_TUD_MSC_BUFSIZE must be a multiple of 512, up to 16 KB"
+#endif
 
 
 //--------------------------------------------------------------------+
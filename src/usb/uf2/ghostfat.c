@@ -28,7 +28,13 @@
 
 #include "uf2.h"
 #include "configkeys.h"
+
+#define TRACE_MODULE_LEVEL  CFG_TRACE_LEVEL_UF2
+#include "trace.h"
 #include "flash_nrf5x.h"
+#include "flash_wear.h"
+#include "ram_usage.h"
+#include "decompress.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -59,6 +65,15 @@ typedef struct {
     uint16_t Heads;
     uint32_t HiddenSectors;
     uint32_t TotalSectors32;
+#if CFG_UF2_FAT32
+    uint32_t SectorsPerFAT32;
+    uint16_t ExtFlags;
+    uint16_t FSVersion;
+    uint32_t RootCluster;
+    uint16_t FSInfoSector;
+    uint16_t BackupBootSector;
+    uint8_t Reserved0[12];
+#endif
     uint8_t PhysicalDriveNum;
     uint8_t Reserved;
     uint8_t ExtendedBootSig;
@@ -66,6 +81,20 @@ typedef struct {
     uint8_t VolumeLabel[11];
     uint8_t FilesystemIdentifier[8];
 } __attribute__((packed)) FAT_BootBlock;
+STATIC_ASSERT(sizeof(FAT_BootBlock) == (CFG_UF2_FAT32 ? 90 : 62));
+
+#if CFG_UF2_FAT32
+typedef struct {
+    uint32_t LeadSignature;
+    uint8_t Reserved1[480];
+    uint32_t StructSignature;
+    uint32_t FreeCount;
+    uint32_t NextFree;
+    uint8_t Reserved2[12];
+    uint32_t TrailSignature;
+} __attribute__((packed)) FAT_FSInfo;
+STATIC_ASSERT(sizeof(FAT_FSInfo) == 512);
+#endif
 
 typedef struct {
     char name[8];
@@ -87,6 +116,7 @@ STATIC_ASSERT(sizeof(DirEntry) == 32);
 struct TextFile {
   char const name[11];
   char const *content;
+  void (*render)(void); // regenerates content before each read, NULL for static files
 };
 
 
@@ -95,28 +125,60 @@ struct TextFile {
 //--------------------------------------------------------------------+
 
 #define BPB_SECTOR_SIZE           ( 512)
-#define BPB_SECTORS_PER_CLUSTER   (   1)
-#define BPB_RESERVED_SECTORS      (   1)
 #define BPB_NUMBER_OF_FATS        (   2)
-#define BPB_ROOT_DIR_ENTRIES      (  64)
 #define BPB_TOTAL_SECTORS         CFG_UF2_NUM_BLOCKS
 #define BPB_MEDIA_DESCRIPTOR_BYTE (0xF8)
+#define DIRENTRIES_PER_SECTOR     (BPB_SECTOR_SIZE/sizeof(DirEntry))
+
+#if CFG_UF2_FAT32
+// FAT32 volume sized from flash (see uf2cfg.h), root directory is the first cluster
+#define BPB_SECTORS_PER_CLUSTER   CFG_UF2_FAT32_SECTORS_PER_CLUSTER
+#define BPB_RESERVED_SECTORS      CFG_UF2_FAT32_RESERVED_SECTORS
+#define BPB_ROOT_DIR_ENTRIES      (   0)
+#define BPB_ROOT_DIR_CLUSTER      (   2)
+#define BPB_FSINFO_SECTOR         (   1)
+#define BPB_BACKUP_BOOT_SECTOR    (   6) // followed by the backup FSInfo sector
+#define FAT_ENTRY_SIZE            (4)
+#define FAT_ENTRY_EOC             (0x0FFFFFFF)
+#define FAT_ENTRIES_PER_SECTOR    (BPB_SECTOR_SIZE / FAT_ENTRY_SIZE)
+#define BPB_SECTORS_PER_FAT       CFG_UF2_FAT32_SECTORS_PER_FAT
+#define ROOT_DIR_SECTOR_COUNT     (0)
+#define FILE_FIRST_CLUSTER        (BPB_ROOT_DIR_CLUSTER + 1)
+typedef uint32_t fat_entry_t;
+#else
+#define BPB_SECTORS_PER_CLUSTER   (   1)
+#define BPB_RESERVED_SECTORS      (   1)
+#define BPB_ROOT_DIR_ENTRIES      (  64)
 #define FAT_ENTRY_SIZE            (2)
+#define FAT_ENTRY_EOC             (0xFFFF)
 #define FAT_ENTRIES_PER_SECTOR    (BPB_SECTOR_SIZE / FAT_ENTRY_SIZE)
 // NOTE: MS specification explicitly allows FAT to be larger than necessary
 #define BPB_SECTORS_PER_FAT       ( (BPB_TOTAL_SECTORS / FAT_ENTRIES_PER_SECTOR) + \
                                    ((BPB_TOTAL_SECTORS % FAT_ENTRIES_PER_SECTOR) ? 1 : 0))
-#define DIRENTRIES_PER_SECTOR     (BPB_SECTOR_SIZE/sizeof(DirEntry))
 #define ROOT_DIR_SECTOR_COUNT     (BPB_ROOT_DIR_ENTRIES/DIRENTRIES_PER_SECTOR)
+#define FILE_FIRST_CLUSTER        (2)
+typedef uint16_t fat_entry_t;
+#endif
 
 STATIC_ASSERT(BPB_SECTOR_SIZE                              ==       512); // GhostFAT does not support other sector sizes (currently)
+STATIC_ASSERT(sizeof(fat_entry_t)                          == FAT_ENTRY_SIZE);
+#if CFG_UF2_FAT32
+STATIC_ASSERT((BPB_SECTORS_PER_CLUSTER & (BPB_SECTORS_PER_CLUSTER - 1)) == 0); // FAT requirement
+STATIC_ASSERT(BPB_BACKUP_BOOT_SECTOR + 1                   < BPB_RESERVED_SECTORS);
+STATIC_ASSERT(FAT_ENTRIES_PER_SECTOR                       ==       128); // FAT requirement
+#else
 STATIC_ASSERT(BPB_SECTORS_PER_CLUSTER                      ==         1); // GhostFAT presumes one sector == one cluster (for simplicity)
+STATIC_ASSERT(FAT_ENTRIES_PER_SECTOR                       ==       256); // FAT requirement
+#endif
 STATIC_ASSERT(BPB_NUMBER_OF_FATS                           ==         2); // FAT highest compatibility
 STATIC_ASSERT(sizeof(DirEntry)                             ==        32); // FAT requirement
 STATIC_ASSERT(BPB_SECTOR_SIZE % sizeof(DirEntry)           ==         0); // FAT requirement
 STATIC_ASSERT(BPB_ROOT_DIR_ENTRIES % DIRENTRIES_PER_SECTOR ==         0); // FAT requirement
 STATIC_ASSERT(BPB_SECTOR_SIZE * BPB_SECTORS_PER_CLUSTER    <= (32*1024)); // FAT requirement (64k+ has known compatibility problems)
-STATIC_ASSERT(FAT_ENTRIES_PER_SECTOR                       ==       256); // FAT requirement
+
+#if defined(ENABLE_QSPI_XIP_APP) && defined(ENABLE_QSPI_STAGING)
+STATIC_ASSERT(QSPI_XIP_APP_OFFSET + QSPI_XIP_APP_SIZE <= CFG_UF2_QSPI_STAGING_OFFSET); // XIP window must not overlap staging slot
+#endif
 
 #define STR0(x) #x
 #define STR(x) STR0(x)
@@ -137,34 +199,83 @@ const char indexFile[] =
     "</body>"
     "</html>\n";
 
+// Rendered again on every read, padded with spaces to a fixed size since hosts only read
+// the directory entry once
+static char statsFile[BPB_SECTOR_SIZE - 1];
+static char wearFile[BPB_SECTOR_SIZE - 1];
+
+static void stats_render (void);
+static void wear_render (void);
+
 static struct TextFile const info[] = {
     {.name = "INFO_UF2TXT", .content = infoUf2File},
     {.name = "INDEX   HTM", .content = indexFile},
-
-    // current.uf2 must be the last element and its content must be NULL
-    {.name = "CURRENT UF2", .content = NULL},
+    {.name = "STATS   TXT", .content = statsFile, .render = stats_render},
+    {.name = "WEAR    TXT", .content = wearFile , .render = wear_render},
 };
 STATIC_ASSERT(ARRAY_SIZE(infoUf2File) < BPB_SECTOR_SIZE); // GhostFAT requires files to fit in one sector
 STATIC_ASSERT(ARRAY_SIZE(indexFile)   < BPB_SECTOR_SIZE); // GhostFAT requires files to fit in one sector
+STATIC_ASSERT(ARRAY_SIZE(statsFile)   < BPB_SECTOR_SIZE); // GhostFAT requires files to fit in one sector
+STATIC_ASSERT(ARRAY_SIZE(wearFile)    < BPB_SECTOR_SIZE); // GhostFAT requires files to fit in one sector
+
+// UF2 files are generated from flash on the fly, CURRENT.UF2 covers all of it and the others
+// one region each so that it can be backed up and dropped back on its own
+enum {
+  UF2_FILE_CURRENT = 0,
+  UF2_FILE_APP,
+  UF2_FILE_SOFTDEV,
+  UF2_FILE_BOOT,
+#ifdef ENABLE_QSPI_FLASH
+  UF2_FILE_QSPI,
+#endif
+  UF2_FILE_COUNT
+};
+
+static char const uf2FileNames[UF2_FILE_COUNT][11] = {
+  [UF2_FILE_CURRENT] = "CURRENT UF2",
+  [UF2_FILE_APP    ] = "APP     UF2",
+  [UF2_FILE_SOFTDEV] = "SOFTDEV UF2",
+  [UF2_FILE_BOOT   ] = "BOOT    UF2",
+#ifdef ENABLE_QSPI_FLASH
+  [UF2_FILE_QSPI   ] = "QSPI    UF2",
+#endif
+};
 
-#define NUM_FILES          (ARRAY_SIZE(info))
+typedef struct {
+  uint32_t addr;          // target address of the first block
+  uint32_t blocks;        // number of blocks
+  uint32_t family_id;
+  uint32_t first_cluster; // 0 if the file is empty
+} uf2_file_t;
+
+#define NUM_TEXT_FILES     (ARRAY_SIZE(info))
+#define NUM_FILES          (NUM_TEXT_FILES + UF2_FILE_COUNT)
 #define NUM_DIRENTRIES     (NUM_FILES + 1) // Code adds volume label as first root directory entry
 #define REQUIRED_ROOT_DIRECTORY_SECTORS ( ((NUM_DIRENTRIES+1) / DIRENTRIES_PER_SECTOR) + \
                                          (((NUM_DIRENTRIES+1) % DIRENTRIES_PER_SECTOR) ? 1 : 0))
+#if !CFG_UF2_FAT32
 STATIC_ASSERT(ROOT_DIR_SECTOR_COUNT >= REQUIRED_ROOT_DIRECTORY_SECTORS);         // FAT requirement -- Ensures BPB reserves sufficient entries for all files
 STATIC_ASSERT(NUM_DIRENTRIES < (DIRENTRIES_PER_SECTOR * ROOT_DIR_SECTOR_COUNT)); // FAT requirement -- end directory with unused entry
 STATIC_ASSERT(NUM_DIRENTRIES < BPB_ROOT_DIR_ENTRIES);                            // FAT requirement -- Ensures BPB reserves sufficient entries for all files
+#endif
 STATIC_ASSERT(NUM_DIRENTRIES < DIRENTRIES_PER_SECTOR); // GhostFAT bug workaround -- else, code overflows buffer
 
 #define NUM_SECTORS_IN_DATA_REGION (BPB_TOTAL_SECTORS - BPB_RESERVED_SECTORS - (BPB_NUMBER_OF_FATS * BPB_SECTORS_PER_FAT) - ROOT_DIR_SECTOR_COUNT)
 #define CLUSTER_COUNT              (NUM_SECTORS_IN_DATA_REGION / BPB_SECTORS_PER_CLUSTER)
 
+#if CFG_UF2_FAT32
+// Ensure cluster count results in a valid FAT32 volume, 32 away from the limit as below
+STATIC_ASSERT( CLUSTER_COUNT == CFG_UF2_FAT32_CLUSTERS );
+STATIC_ASSERT( CLUSTER_COUNT >= 0x10015 && CLUSTER_COUNT < 0x0FFFFFD5 );
+STATIC_ASSERT( BPB_SECTORS_PER_FAT * FAT_ENTRIES_PER_SECTOR >= CLUSTER_COUNT + 2 );
+#else
 // Ensure cluster count results in a valid FAT16 volume!
 STATIC_ASSERT( CLUSTER_COUNT >= 0x0FF5 && CLUSTER_COUNT < 0xFFF5 );
 
 // Many existing FAT implementations have small (1-16) off-by-one style errors
 // So, avoid being within 32 of those limits for even greater compatibility.
 STATIC_ASSERT( CLUSTER_COUNT >= 0x1015 && CLUSTER_COUNT < 0xFFD5 );
+#endif
 
 
 #define UF2_FIRMWARE_BYTES_PER_SECTOR 256
@@ -177,8 +288,16 @@ STATIC_ASSERT(TRUE_USER_FLASH_SIZE % UF2_FIRMWARE_BYTES_PER_SECTOR == 0); // UF2
 
 STATIC_ASSERT(UF2_SECTORS == ((UF2_SIZE/2) / 256)); // Not a requirement ... ensuring replacement of literal value is not a change
 
-#define UF2_FIRST_SECTOR   ((NUM_FILES + 1) * BPB_SECTORS_PER_CLUSTER) // WARNING -- code presumes each non-UF2 file content fits in single sector
-#define UF2_LAST_SECTOR    ((UF2_FIRST_SECTOR + UF2_SECTORS - 1) * BPB_SECTORS_PER_CLUSTER)
+#define UF2_FIRST_CLUSTER  (FILE_FIRST_CLUSTER + NUM_TEXT_FILES) // WARNING -- code presumes each non-UF2 file content fits in single sector
+
+// Region files cover disjoint parts of what CURRENT.UF2 covers (BOOT.UF2 adds the UICR block),
+// so all UF2 files together take at most twice its clusters plus a partial cluster each
+#define UF2_MAX_CLUSTERS   (2 * CEIL_DIV(UF2_SECTORS, BPB_SECTORS_PER_CLUSTER) + 2 * UF2_FILE_COUNT)
+
+STATIC_ASSERT(UF2_FIRST_CLUSTER + CEIL_DIV(UF2_SECTORS, BPB_SECTORS_PER_CLUSTER) <= CLUSTER_COUNT + 2); // CURRENT.UF2 must fit the volume
+#if CFG_UF2_FAT32
+STATIC_ASSERT(UF2_FIRST_CLUSTER + UF2_MAX_CLUSTERS <= CLUSTER_COUNT + 2); // FAT32 volume is sized for all UF2 files
+#endif
 
 #define FS_START_FAT0_SECTOR      BPB_RESERVED_SECTORS
 #define FS_START_FAT1_SECTOR      (FS_START_FAT0_SECTOR + BPB_SECTORS_PER_FAT)
@@ -187,7 +306,7 @@ STATIC_ASSERT(UF2_SECTORS == ((UF2_SIZE/2) / 256)); // Not a requirement ... ens
 
 
 static FAT_BootBlock const BootBlock = {
-    .JumpInstruction      = {0xeb, 0x3c, 0x90},
+    .JumpInstruction      = {0xeb, sizeof(FAT_BootBlock) - 2, 0x90}, // jump over the BPB
     .OEMInfo              = "UF2 UF2 ",
     .SectorSize           = BPB_SECTOR_SIZE,
     .SectorsPerCluster    = BPB_SECTORS_PER_CLUSTER,
@@ -196,7 +315,14 @@ static FAT_BootBlock const BootBlock = {
     .RootDirectoryEntries = BPB_ROOT_DIR_ENTRIES,
     .TotalSectors16       = (BPB_TOTAL_SECTORS > 0xFFFF) ? 0 : BPB_TOTAL_SECTORS,
     .MediaDescriptor      = BPB_MEDIA_DESCRIPTOR_BYTE,
+#if CFG_UF2_FAT32
+    .SectorsPerFAT32      = BPB_SECTORS_PER_FAT,
+    .RootCluster          = BPB_ROOT_DIR_CLUSTER,
+    .FSInfoSector         = BPB_FSINFO_SECTOR,
+    .BackupBootSector     = BPB_BACKUP_BOOT_SECTOR,
+#else
     .SectorsPerFAT        = BPB_SECTORS_PER_FAT,
+#endif
     .SectorsPerTrack      = 1,
     .Heads                = 1,
     .TotalSectors32       = (BPB_TOTAL_SECTORS > 0xFFFF) ? BPB_TOTAL_SECTORS : 0,
@@ -204,7 +330,11 @@ static FAT_BootBlock const BootBlock = {
     .ExtendedBootSig      = 0x29,
     .VolumeSerialNumber   = 0x00420042,
     .VolumeLabel          = UF2_VOLUME_LABEL,
+#if CFG_UF2_FAT32
+    .FilesystemIdentifier = "FAT32   ",
+#else
     .FilesystemIdentifier = "FAT16   ",
+#endif
 };
 
 // Use bootloaderConfig to detect BOOTLOADER ID when updating bootloader
@@ -221,16 +351,61 @@ static inline bool is_uf2_block (UF2_Block const *bl)
          (bl->magicEnd == UF2_MAGIC_END) &&
          (bl->flags & UF2_FLAG_FAMILYID) &&
          !(bl->flags & UF2_FLAG_NOFLASH) &&
-         (bl->payloadSize == UF2_FIRMWARE_BYTES_PER_SECTOR) &&
+         ((bl->payloadSize == UF2_FIRMWARE_BYTES_PER_SECTOR) ||
+          ((bl->flags & UF2_FLAG_COMPRESSED) && bl->payloadSize > 4 && bl->payloadSize <= sizeof(bl->data))) &&
          !(bl->targetAddr & 0xff);
 }
 
+// Signature block is accepted by any bootloader so that signed files complete normally,
+// it is only checked when built with DFU_SIGNING_PUBKEY
+static inline bool is_uf2_signature_block (UF2_Block const *bl)
+{
+  uint32_t magic;
+  memcpy(&magic, bl->data, 4);
+
+  return (bl->magicStart0 == UF2_MAGIC_START0) &&
+         (bl->magicStart1 == UF2_MAGIC_START1) &&
+         (bl->magicEnd == UF2_MAGIC_END) &&
+         (bl->flags & UF2_FLAG_FAMILYID) &&
+         (bl->flags & UF2_FLAG_NOFLASH) &&
+         (bl->payloadSize == UF2_SIGNATURE_SIZE) &&
+         (magic == UF2_SIGNATURE_MAGIC) &&
+         ((bl->familyID == CFG_UF2_BOARD_APP_ID) || (bl->familyID == CFG_UF2_FAMILY_APP_ID));
+}
+
 // used when upgrading application
 static inline bool in_app_space (uint32_t addr)
 {
   return USER_FLASH_START <= addr && addr < USER_FLASH_END;
 }
 
+// QSPI data written as-is e.g filesystem image used by the app, staging slot is excluded
+static inline bool in_qspi_data_space (uint32_t addr)
+{
+#if defined(ENABLE_QSPI_STAGING)
+  return CFG_UF2_QSPI_XIP_OFFSET <= addr && addr < CFG_UF2_QSPI_XIP_OFFSET + CFG_UF2_QSPI_STAGING_OFFSET;
+#elif defined(ENABLE_QSPI_FLASH)
+  return CFG_UF2_QSPI_XIP_OFFSET <= addr && addr < CFG_UF2_QSPI_XIP_OFFSET + CFG_UF2_QSPI_FLASH_SIZE;
+#else
+  (void) addr;
+  return false;
+#endif
+}
+
+#ifdef ENABLE_QSPI_XIP_APP
+// XIP part of the application, as linked at its execution address
+static inline bool in_xip_exec_space (uint32_t addr)
+{
+  return CFG_UF2_XIP_EXEC_START <= addr && addr < CFG_UF2_XIP_EXEC_START + QSPI_XIP_APP_SIZE;
+}
+
+// XIP part of the application, at its QSPI location in uf2 address space
+static inline bool in_xip_app_space (uint32_t addr)
+{
+  return CFG_UF2_QSPI_XIP_OFFSET + QSPI_XIP_APP_OFFSET <= addr && addr < CFG_UF2_QSPI_XIP_OFFSET + QSPI_XIP_APP_OFFSET + QSPI_XIP_APP_SIZE;
+}
+#endif
+
 // used when upgrading bootloader
 static inline bool in_bootloader_space (uint32_t addr)
 {
@@ -243,12 +418,186 @@ static inline bool in_uicr_space(uint32_t addr)
   return addr == 0x10001000;
 }
 
+// Live counters shown in STATS.TXT, kept since reset
+static struct {
+  uint32_t blocks;          // uf2 blocks accepted, including duplicates
+  uint32_t duplicates;      // blocks written again by host (same block number)
+  uint32_t first_ms;        // time of first block
+  uint32_t last_ms;         // time of latest block
+  uint32_t longest_stall;   // longest gap between two blocks in ms
+
+  uint32_t boot_ms[UF2_BOOT_PHASE_COUNT];
+  uint8_t  boot_recorded;   // bitmap of recorded boot phases
+} _uf2_stats;
+
 //--------------------------------------------------------------------+
 //
 //--------------------------------------------------------------------+
 
+void uf2_stats_boot_phase(uint8_t phase)
+{
+  if ( (phase >= UF2_BOOT_PHASE_COUNT) || (_uf2_stats.boot_recorded & (1u << phase)) ) return;
+
+  _uf2_stats.boot_ms[phase] = board_millis();
+  _uf2_stats.boot_recorded |= (1u << phase);
+}
+
+static void stats_block_received (void)
+{
+  uint32_t const now = board_millis();
+
+  if ( _uf2_stats.blocks == 0 )
+  {
+    _uf2_stats.first_ms = now;
+  }
+  else if ( now - _uf2_stats.last_ms > _uf2_stats.longest_stall )
+  {
+    _uf2_stats.longest_stall = now - _uf2_stats.last_ms;
+  }
+
+  _uf2_stats.last_ms = now;
+  _uf2_stats.blocks++;
+}
+
+// Append text, output is truncated at end of buffer
+static char* stats_text (char* p, char const* end, char const* s)
+{
+  while ( *s && p < end ) *p++ = *s++;
+  return p;
+}
+
+// Append "label v0/v1/...\r\n"
+static char* stats_list (char* p, char const* end, char const* label, uint32_t const* values, uint32_t count)
+{
+  char num[11];
+
+  p = stats_text(p, end, label);
+  for ( uint32_t i = 0; i < count; i++ )
+  {
+    if ( i ) p = stats_text(p, end, "/");
+    utoa(values[i], num, 10);
+    p = stats_text(p, end, num);
+  }
+
+  return stats_text(p, end, "\r\n");
+}
+
+// Append "label value\r\n"
+static char* stats_line (char* p, char const* end, char const* label, uint32_t value)
+{
+  return stats_list(p, end, label, &value, 1);
+}
+
+// pad so that size always matches the directory entry
+static void stats_pad (char* p, char const* end)
+{
+  while ( p < end ) *p++ = ' ';
+  *p = 0;
+}
+
+static void stats_render (void)
+{
+  flash_nrf5x_stats_t const* fl = flash_nrf5x_get_stats();
+  char const* end = statsFile + sizeof(statsFile) - 1;
+  char* p = statsFile;
+
+  uint32_t const elapsed = _uf2_stats.last_ms - _uf2_stats.first_ms;
+  uint32_t const bytes   = _uf2_stats.blocks * BPB_SECTOR_SIZE;
+
+  // split to avoid overflowing bytes * 1000 without 64-bit division
+  uint32_t const rate = elapsed ? ((bytes / elapsed) * 1000 + ((bytes % elapsed) * 1000) / elapsed) : 0;
+
+  p = stats_line(p, end, "Blocks received: "       , _uf2_stats.blocks);
+  p = stats_line(p, end, "Blocks duplicated: "     , _uf2_stats.duplicates);
+  p = stats_line(p, end, "Transfer ms: "           , elapsed);
+  p = stats_line(p, end, "Transfer bytes/s: "      , rate);
+  p = stats_line(p, end, "Longest stall ms: "      , _uf2_stats.longest_stall);
+  p = stats_line(p, end, "Pages erased: "          , fl->pages_erased);
+  p = stats_line(p, end, "Pages programmed: "      , fl->pages_written);
+  p = stats_line(p, end, "Pages skipped: "         , fl->pages_skipped);
+  p = stats_line(p, end, "Verify retries: "        , fl->verify_retries + fl->qspi_verify_retries);
+  p = stats_line(p, end, "Verify failures: "       , fl->verify_failures + fl->qspi_verify_failures);
+  p = stats_line(p, end, "QSPI writes: "           , fl->qspi_writes);
+  p = stats_line(p, end, "QSPI sector erases: "    , fl->qspi_erases);
+  p = stats_line(p, end, "QSPI erases skipped: "   , fl->qspi_erases_skipped);
+  p = stats_line(p, end, "Boot ms, init: "         , _uf2_stats.boot_ms[UF2_BOOT_INIT]);
+  p = stats_line(p, end, "Boot ms, update: "       , _uf2_stats.boot_ms[UF2_BOOT_UPDATE]);
+  p = stats_line(p, end, "Boot ms, usb: "          , _uf2_stats.boot_ms[UF2_BOOT_USB]);
+  p = stats_line(p, end, "Boot ms, mounted: "      , _uf2_stats.boot_ms[UF2_BOOT_MOUNTED]);
+
+  ram_usage_t ram;
+  ram_usage_get(&ram);
+
+  uint32_t const stack[]  = { ram.stack_peak, ram.stack_size };
+  uint32_t const memory[] = { ram.ram_static, ram.ram_unused };
+  uint32_t const queues[] = { ram.sched_peak, ram.hci_peak, ram.pstorage_peak };
+
+  p = stats_list(p, end, "Stack peak/size: "            , stack , ARRAY_SIZE(stack));
+  p = stats_list(p, end, "RAM static/unused: "          , memory, ARRAY_SIZE(memory));
+  p = stats_list(p, end, "Queue peak sched/hci/pstor: " , queues, ARRAY_SIZE(queues));
+
+  stats_pad(p, end);
+}
+
+// Append hottest pages or QSPI sectors as "0x000FF000: 12\r\n"
+static char* wear_hottest (char* p, char const* end, bool qspi, uint32_t n)
+{
+  uint32_t addr[8];
+  uint16_t count[8];
+  char num[11];
+
+  if ( n > ARRAY_SIZE(addr) ) n = ARRAY_SIZE(addr);
+  n = flash_wear_hottest(qspi, addr, count, n);
+
+  for ( uint32_t i = 0; i < n; i++ )
+  {
+    // 0x prefixed, zero padded to 8 digits
+    char hex[11] = "0x";
+    for ( uint32_t d = 0; d < 8; d++ ) hex[2 + d] = "0123456789ABCDEF"[(addr[i] >> (28 - 4 * d)) & 0xF];
+    hex[10] = 0;
+
+    p = stats_text(p, end, hex);
+    p = stats_text(p, end, ": ");
+    utoa(count[i], num, 10);
+    p = stats_text(p, end, num);
+    p = stats_text(p, end, "\r\n");
+  }
+
+  return p;
+}
+
+static void wear_render (void)
+{
+  flash_wear_t const* wear = flash_wear_get();
+  char const* end = wearFile + sizeof(wearFile) - 1;
+  char* p = wearFile;
+
+  uint32_t total = 0;
+  for ( uint32_t i = 0; i < FLASH_WEAR_PAGES; i++ ) total += wear->count[i];
+
+  p = stats_line(p, end, "Page erases total: ", total);
+  p = stats_text(p, end, "Hottest pages:\r\n");
+  p = wear_hottest(p, end, false, 8);
+
+#ifdef ENABLE_QSPI_FLASH
+  total = 0;
+  for ( uint32_t i = 0; i < FLASH_WEAR_QSPI_ENTRIES; i++ ) total += wear->count[FLASH_WEAR_PAGES + i];
+
+  p = stats_line(p, end, "QSPI erases total: ", total);
+  p = stats_line(p, end, "QSPI sectors per counter: ", FLASH_WEAR_QSPI_SECTORS_PER_ENTRY);
+  p = stats_text(p, end, "Hottest QSPI sectors:\r\n");
+  p = wear_hottest(p, end, true, 4);
+#endif
+
+  stats_pad(p, end);
+}
+
 void uf2_init(void)
 {
+  // content is only regenerated on read, directory entry needs the (fixed) size before that
+  stats_render();
+  wear_render();
+
   strcat(infoUf2File, "SoftDevice: ");
 
   if ( is_sd_existed() )
@@ -286,8 +635,127 @@ void uf2_init(void)
 }
 
 /*------------------------------------------------------------------*/
-/* Read CURRENT.UF2
+/* Host metadata overlay
+ *------------------------------------------------------------------*/
+
+// Host writes FAT and directory sectors along with the file, reading back the generated view
+// instead makes some OSes invalidate caches and retry. The most recent ones are kept here and
+// served back until the volume is ejected, the oldest is replaced when full.
+#if CFG_UF2_META_OVERLAY_SECTORS
+static struct {
+  uint32_t tag[CFG_UF2_META_OVERLAY_SECTORS];  // block_no + 1, 0 = unused
+  uint8_t  next;                               // replaced next if block is not kept yet
+  uint8_t  data[CFG_UF2_META_OVERLAY_SECTORS][BPB_SECTOR_SIZE] __attribute__((aligned(4)));
+} _meta_overlay;
+
+STATIC_ASSERT(CFG_UF2_META_OVERLAY_SECTORS <= 255);
+
+// Reserved, FAT and root directory sectors
+static inline bool is_meta_sector (uint32_t block_no)
+{
+#if CFG_UF2_FAT32
+  return block_no < FS_START_CLUSTERS_SECTOR + BPB_SECTORS_PER_CLUSTER;
+#else
+  return block_no < FS_START_CLUSTERS_SECTOR;
+#endif
+}
+
+static bool meta_overlay_read (uint32_t block_no, uint8_t *data)
+{
+  for ( uint32_t i = 0; i < CFG_UF2_META_OVERLAY_SECTORS; i++ )
+  {
+    if ( _meta_overlay.tag[i] == block_no + 1 )
+    {
+      memcpy(data, _meta_overlay.data[i], BPB_SECTOR_SIZE);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static void meta_overlay_write (uint32_t block_no, uint8_t const *data)
+{
+  uint32_t i;
+  for ( i = 0; i < CFG_UF2_META_OVERLAY_SECTORS; i++ )
+  {
+    if ( _meta_overlay.tag[i] == block_no + 1 ) break;
+  }
+
+  if ( i == CFG_UF2_META_OVERLAY_SECTORS )
+  {
+    i = _meta_overlay.next;
+    _meta_overlay.next = (_meta_overlay.next + 1) % CFG_UF2_META_OVERLAY_SECTORS;
+    _meta_overlay.tag[i] = block_no + 1;
+  }
+
+  memcpy(_meta_overlay.data[i], data, BPB_SECTOR_SIZE);
+}
+#endif
+
+void uf2_meta_overlay_clear(void)
+{
+#if CFG_UF2_META_OVERLAY_SECTORS
+  memset(_meta_overlay.tag, 0, sizeof(_meta_overlay.tag));
+  _meta_overlay.next = 0;
+#endif
+}
+
+/*------------------------------------------------------------------*/
+/* Read UF2 files
  *------------------------------------------------------------------*/
+
+// Sizes of region files depend on what is currently installed, files are laid out back to back
+// after the text files. A region file that does not fit the rest of a FAT16 volume is left empty.
+// Returns the first free cluster.
+static uint32_t uf2_files_get (uf2_file_t files[UF2_FILE_COUNT])
+{
+  bootloader_settings_t const* p_settings;
+  bootloader_util_settings_get(&p_settings);
+
+  // Size is only recorded along with a digest, otherwise the whole app part of CURRENT.UF2 is used
+  uint32_t const app_max  = USER_FLASH_END - DFU_BANK_0_REGION_START;
+  uint32_t const app_size = (p_settings->bank_0 != BANK_VALID_APP) ? 0 :
+                            (p_settings->bank_0_size ? MIN(p_settings->bank_0_size, app_max) : app_max);
+
+  files[UF2_FILE_CURRENT] = (uf2_file_t) { USER_FLASH_START, UF2_SECTORS, CFG_UF2_BOARD_APP_ID, 0 };
+  files[UF2_FILE_APP]     = (uf2_file_t) { DFU_BANK_0_REGION_START, CEIL_DIV(app_size, UF2_FIRMWARE_BYTES_PER_SECTOR),
+                                           CFG_UF2_BOARD_APP_ID, 0 };
+  files[UF2_FILE_SOFTDEV] = (uf2_file_t) { USER_FLASH_START, (DFU_BANK_0_REGION_START - USER_FLASH_START) / UF2_FIRMWARE_BYTES_PER_SECTOR,
+                                           CFG_UF2_BOARD_APP_ID, 0 };
+
+  // last block is the UICR, which a bootloader uf2 must carry
+  files[UF2_FILE_BOOT]    = (uf2_file_t) { BOOTLOADER_ADDR_START, (BOOTLOADER_ADDR_END - BOOTLOADER_ADDR_START) / UF2_FIRMWARE_BYTES_PER_SECTOR + 1,
+                                           CFG_UF2_FAMILY_BOOT_ID, 0 };
+
+#ifdef ENABLE_QSPI_FLASH
+  // staging slot is excluded, it could not be written back
+  #ifdef ENABLE_QSPI_STAGING
+  uint32_t const qspi_size = CFG_UF2_QSPI_STAGING_OFFSET;
+  #else
+  uint32_t const qspi_size = CFG_UF2_QSPI_FLASH_SIZE;
+  #endif
+  files[UF2_FILE_QSPI]    = (uf2_file_t) { CFG_UF2_QSPI_XIP_OFFSET, qspi_size / UF2_FIRMWARE_BYTES_PER_SECTOR,
+                                           CFG_UF2_BOARD_APP_ID, 0 };
+#endif
+
+  uint32_t cluster = UF2_FIRST_CLUSTER;
+  for (uint32_t i = 0; i < UF2_FILE_COUNT; i++) {
+    uint32_t const clusters = CEIL_DIV(files[i].blocks, BPB_SECTORS_PER_CLUSTER);
+
+    if (cluster + clusters > CLUSTER_COUNT + 2) {
+      files[i].blocks = 0;
+    }
+
+    if (files[i].blocks) {
+      files[i].first_cluster = cluster;
+      cluster += clusters;
+    }
+  }
+
+  return cluster;
+}
+
 void padded_memcpy (char *dst, char const *src, int len)
 {
   for ( int i = 0; i < len; ++i )
@@ -301,7 +769,59 @@ void padded_memcpy (char *dst, char const *src, int len)
   }
 }
 
+// Root directory sector, sectionIdx counts from the start of the root directory
+static void read_root_dir(uint32_t sectionIdx, uint8_t *data) {
+    uf2_file_t files[UF2_FILE_COUNT];
+    uf2_files_get(files);
+
+    DirEntry *d = (void *)data;
+    int remainingEntries = DIRENTRIES_PER_SECTOR;
+    if (sectionIdx == 0) { // volume label first
+        // volume label is first directory entry
+        padded_memcpy(d->name, (char const *) BootBlock.VolumeLabel, 11);
+        d->attrs = 0x28;
+        d++;
+        remainingEntries--;
+    }
+
+    for (uint32_t i = DIRENTRIES_PER_SECTOR * sectionIdx;
+         remainingEntries > 0 && i < NUM_FILES;
+         i++, d++) {
+
+        // WARNING -- code presumes text files take exactly one cluster
+        uint32_t startCluster;
+        uint32_t size;
+
+        if (i < NUM_TEXT_FILES) {
+            struct TextFile const * inf = &info[i];
+            padded_memcpy(d->name, inf->name, 11);
+            startCluster = i + FILE_FIRST_CLUSTER;
+            size = strlen(inf->content);
+        } else {
+            uf2_file_t const * f = &files[i - NUM_TEXT_FILES];
+            padded_memcpy(d->name, uf2FileNames[i - NUM_TEXT_FILES], 11);
+            startCluster = f->first_cluster;
+            size = f->blocks * BPB_SECTOR_SIZE;
+        }
+
+        d->createTimeFine   = __SECONDS_INT__ % 2 * 100;
+        d->createTime       = __DOSTIME__;
+        d->createDate       = __DOSDATE__;
+        d->lastAccessDate   = __DOSDATE__;
+        d->highStartCluster = startCluster >> 16;
+        // DIR_WrtTime and DIR_WrtDate must be supported
+        d->updateTime       = __DOSTIME__;
+        d->updateDate       = __DOSDATE__;
+        d->startCluster     = startCluster & 0xFFFF;
+        d->size = size;
+    }
+}
+
 void read_block(uint32_t block_no, uint8_t *data) {
+#if CFG_UF2_META_OVERLAY_SECTORS
+    if (is_meta_sector(block_no) && meta_overlay_read(block_no, data)) return;
+#endif
+
     memset(data, 0, BPB_SECTOR_SIZE);
     uint32_t sectionIdx = block_no;
 
@@ -310,86 +830,102 @@ void read_block(uint32_t block_no, uint8_t *data) {
         data[510] = 0x55; // Always at offsets 510/511, even when BPB_SECTOR_SIZE is larger
         data[511] = 0xaa; // Always at offsets 510/511, even when BPB_SECTOR_SIZE is larger
         // logval("data[0]", data[0]);
+#if CFG_UF2_FAT32
+    } else if (block_no < FS_START_FAT0_SECTOR) { // Requested reserved sector: FSInfo, backup boot block or unused
+        if (block_no == BPB_BACKUP_BOOT_SECTOR) {
+            read_block(0, data);
+        } else if (block_no == BPB_FSINFO_SECTOR || block_no == BPB_BACKUP_BOOT_SECTOR + 1) {
+            uf2_file_t files[UF2_FILE_COUNT];
+            uint32_t const free_cluster = uf2_files_get(files);
+
+            FAT_FSInfo *fsinfo = (void *)data;
+            fsinfo->LeadSignature   = 0x41615252;
+            fsinfo->StructSignature = 0x61417272;
+            fsinfo->FreeCount       = CLUSTER_COUNT + 2 - free_cluster;
+            fsinfo->NextFree        = free_cluster;
+            fsinfo->TrailSignature  = 0xAA550000;
+        }
+#endif
     } else if (block_no < FS_START_ROOTDIR_SECTOR) {  // Requested FAT table sector
         sectionIdx -= FS_START_FAT0_SECTOR;
         // logval("sidx", sectionIdx);
         if (sectionIdx >= BPB_SECTORS_PER_FAT) {
             sectionIdx -= BPB_SECTORS_PER_FAT; // second FAT is same as the first...
         }
+        fat_entry_t *fat = (void *)data;
         if (sectionIdx == 0) {
+            // WARNING -- code presumes all text file .content fit in one cluster
+            for (uint32_t i = 0; i < UF2_FIRST_CLUSTER; ++i) {
+                fat[i] = FAT_ENTRY_EOC;
+            }
             // first FAT entry must match BPB MediaDescriptor
             data[0] = BPB_MEDIA_DESCRIPTOR_BYTE;
-            // WARNING -- code presumes only one NULL .content for .UF2 file
-            //            and all non-NULL .content fit in one sector
-            //            and requires it be the last element of the array
-            uint32_t const end = (NUM_FILES * FAT_ENTRY_SIZE) + (2 * FAT_ENTRY_SIZE);
-            for (uint32_t i = 1; i < end; ++i) {
-                data[i] = 0xff;
-            }
-        }
-        for (uint32_t i = 0; i < FAT_ENTRIES_PER_SECTOR; ++i) { // Generate the FAT chain for the firmware "file"
-            uint32_t v = (sectionIdx * FAT_ENTRIES_PER_SECTOR) + i;
-            if (UF2_FIRST_SECTOR <= v && v <= UF2_LAST_SECTOR)
-                ((uint16_t *)(void *)data)[i] = v == UF2_LAST_SECTOR ? 0xffff : v + 1;
         }
-    } else if (block_no < FS_START_CLUSTERS_SECTOR) { // Requested root directory sector
 
-        sectionIdx -= FS_START_ROOTDIR_SECTOR;
+        uf2_file_t files[UF2_FILE_COUNT];
+        uf2_files_get(files);
 
-        DirEntry *d = (void *)data;
-        int remainingEntries = DIRENTRIES_PER_SECTOR;
-        if (sectionIdx == 0) { // volume label first
-            // volume label is first directory entry
-            padded_memcpy(d->name, (char const *) BootBlock.VolumeLabel, 11);
-            d->attrs = 0x28;
-            d++;
-            remainingEntries--;
-        }
+        uint32_t const first = sectionIdx * FAT_ENTRIES_PER_SECTOR;
+        for (uint32_t f = 0; f < UF2_FILE_COUNT; ++f) { // Generate the FAT chains for the firmware "files"
+            if (!files[f].blocks) continue;
 
-        for (uint32_t i = DIRENTRIES_PER_SECTOR * sectionIdx;
-             remainingEntries > 0 && i < NUM_FILES;
-             i++, d++) {
-
-            // WARNING -- code presumes all but last file take exactly one sector
-            uint16_t startCluster = i + 2;
-
-            struct TextFile const * inf = &info[i];
-            padded_memcpy(d->name, inf->name, 11);
-            d->createTimeFine   = __SECONDS_INT__ % 2 * 100;
-            d->createTime       = __DOSTIME__;
-            d->createDate       = __DOSDATE__;
-            d->lastAccessDate   = __DOSDATE__;
-            d->highStartCluster = startCluster >> 16;
-            // DIR_WrtTime and DIR_WrtDate must be supported
-            d->updateTime       = __DOSTIME__;
-            d->updateDate       = __DOSDATE__;
-            d->startCluster     = startCluster & 0xFFFF;
-            d->size = (inf->content ? strlen(inf->content) : UF2_SIZE);
+            uint32_t const last = files[f].first_cluster + CEIL_DIV(files[f].blocks, BPB_SECTORS_PER_CLUSTER) - 1;
+            uint32_t const end  = MIN(last + 1, first + FAT_ENTRIES_PER_SECTOR);
+            for (uint32_t v = MAX(files[f].first_cluster, first); v < end; ++v) {
+                fat[v - first] = v == last ? FAT_ENTRY_EOC : v + 1;
+            }
         }
-
+    } else if (block_no < FS_START_CLUSTERS_SECTOR) { // Requested root directory sector
+        read_root_dir(sectionIdx - FS_START_ROOTDIR_SECTOR, data);
     } else if (block_no < BPB_TOTAL_SECTORS) {
 
         sectionIdx -= FS_START_CLUSTERS_SECTOR;
-        if (sectionIdx < NUM_FILES - 1) {
-            memcpy(data, info[sectionIdx].content, strlen(info[sectionIdx].content));
+        uint32_t const cluster = 2 + (sectionIdx / BPB_SECTORS_PER_CLUSTER);
+        uint32_t const offset  = sectionIdx % BPB_SECTORS_PER_CLUSTER;
+
+#if CFG_UF2_FAT32
+        if (cluster == BPB_ROOT_DIR_CLUSTER) {
+            read_root_dir(offset, data);
+        } else
+#endif
+        if (cluster < UF2_FIRST_CLUSTER) {
+            // text files only use the first sector of their cluster
+            sectionIdx = cluster - FILE_FIRST_CLUSTER;
+            if (offset == 0) {
+                if (info[sectionIdx].render) info[sectionIdx].render();
+                memcpy(data, info[sectionIdx].content, strlen(info[sectionIdx].content));
+            }
         } else { // generate the UF2 file data on-the-fly
-            sectionIdx -= NUM_FILES - 1;
-            uint32_t addr = USER_FLASH_START + (sectionIdx * UF2_FIRMWARE_BYTES_PER_SECTOR);
-            if (addr < CFG_UF2_TOTAL_FLASH_SIZE) {
+            uf2_file_t files[UF2_FILE_COUNT];
+            uf2_files_get(files);
+
+            // CURRENT.UF2 is never empty and starts at UF2_FIRST_CLUSTER
+            uf2_file_t const * f = &files[UF2_FILE_CURRENT];
+            for (uint32_t i = 0; i < UF2_FILE_COUNT; ++i) {
+                if (files[i].blocks && files[i].first_cluster <= cluster) f = &files[i];
+            }
+
+            sectionIdx = ((cluster - f->first_cluster) * BPB_SECTORS_PER_CLUSTER) + offset;
+            uint32_t addr = f->addr + (sectionIdx * UF2_FIRMWARE_BYTES_PER_SECTOR);
+            if ((f->family_id == CFG_UF2_FAMILY_BOOT_ID) && (sectionIdx == f->blocks - 1)) {
+                addr = (uint32_t) NRF_UICR;
+            }
+
+            if ((sectionIdx < f->blocks) && (addr < CFG_UF2_TOTAL_FLASH_SIZE || in_uicr_space(addr))) {
                 UF2_Block *bl = (void *)data;
                 bl->magicStart0 = UF2_MAGIC_START0;
                 bl->magicStart1 = UF2_MAGIC_START1;
                 bl->magicEnd = UF2_MAGIC_END;
                 bl->blockNo = sectionIdx;
-                bl->numBlocks = UF2_SECTORS;
+                bl->numBlocks = f->blocks;
                 bl->targetAddr = addr;
                 bl->payloadSize = UF2_FIRMWARE_BYTES_PER_SECTOR;
                 bl->flags = UF2_FLAG_FAMILYID;
-                bl->familyID = CFG_UF2_BOARD_APP_ID;
+                bl->familyID = f->family_id;
 
                 // Check if address is in QSPI Flash range
 #ifdef ENABLE_QSPI_FLASH
-                if (addr >= CFG_UF2_QSPI_XIP_OFFSET) {
+                if (addr >= CFG_UF2_QSPI_XIP_OFFSET && addr < CFG_UF2_TOTAL_FLASH_SIZE) {
                     // Read from QSPI Flash
                     qspi_flash_read(addr - CFG_UF2_QSPI_XIP_OFFSET, bl->data, bl->payloadSize);
                 } else {
@@ -410,6 +946,205 @@ void read_block(uint32_t block_no, uint8_t *data) {
 /* Write UF2
  *------------------------------------------------------------------*/
 
+// Write application data either to internal flash or QSPI staging slot.
+// addr is the final address in application space. Return false if flash failed to verify.
+static bool write_app_data (uint32_t addr, void const *data, uint32_t len, WriteState *state)
+{
+#ifdef ENABLE_QSPI_STAGING
+  // Stream into QSPI staging slot at QSPI speed, internal flash is only touched by the
+  // commit on next boot. An interrupted transfer leaves the current application intact.
+  uint32_t const stage_addr = CFG_UF2_QSPI_XIP_OFFSET + CFG_UF2_QSPI_STAGING_OFFSET + (addr - USER_FLASH_START);
+  if ( !flash_nrf5x_write(stage_addr, data, len, true) ) return false;
+
+  if ( !state->staged_end || addr < state->staged_start ) state->staged_start = addr;
+  if ( addr + len > state->staged_end ) state->staged_end = addr + len;
+
+  uint32_t const last = (addr + len - 1 - USER_FLASH_START) / UF2_STAGED_UNIT_SIZE;
+  for ( uint32_t unit = (addr - USER_FLASH_START) / UF2_STAGED_UNIT_SIZE; unit <= last; unit++ )
+  {
+    state->staged_mask[unit / 8] |= (uint8_t) (1 << (unit % 8));
+  }
+#else
+  if ( !flash_nrf5x_write(addr, data, len, true) ) return false;
+
+  // Digest is streamed while data passes through, host OSes write the file in order in practice.
+  // Any gap or rewrite only drops the digest, the app is then booted on CRC-less validity as before.
+  // SoftDevice blocks bundled in the file are not part of the app digest.
+  if ( addr < DFU_BANK_0_REGION_START ) return true;
+
+  if ( state->sha_next == 0 && addr == DFU_BANK_0_REGION_START )
+  {
+    sha256_init(&state->sha);
+    state->sha_next = addr;
+  }
+
+  if ( state->sha_next == addr )
+  {
+    sha256_update(&state->sha, data, len);
+    state->sha_next += len;
+  }
+  else
+  {
+    state->sha_next = UINT32_MAX;
+  }
+#endif
+
+  return true;
+}
+
+// Compressed block: data[] starts with 4-byte decompressed length followed by heatshrink stream.
+// Each block is decoded on its own so that host can still write blocks in any order.
+static bool write_app_compressed (UF2_Block const *bl, WriteState *state)
+{
+  static decompress_t _decomp;
+  static uint8_t _decomp_buf[UF2_FIRMWARE_BYTES_PER_SECTOR];
+
+  uint32_t raw_len;
+  memcpy(&raw_len, bl->data, 4);
+
+  if ( (raw_len == 0) || (raw_len & 3) || !in_app_space(bl->targetAddr + raw_len - 1) ) return false;
+
+  decompress_init(&_decomp);
+
+  uint8_t const *in = bl->data + 4;
+  uint32_t in_len = bl->payloadSize - 4;
+  uint32_t addr = bl->targetAddr;
+
+  // targetAddr is 256-aligned, writing 256 bytes at a time never crosses a flash page
+  while ( raw_len )
+  {
+    uint32_t const wanted = (raw_len < sizeof(_decomp_buf)) ? raw_len : sizeof(_decomp_buf);
+    uint32_t in_used;
+    uint32_t const count = decompress_run(&_decomp, in, in_len, &in_used, _decomp_buf, wanted);
+
+    // truncated stream
+    if ( count != wanted ) return false;
+
+    if ( !write_app_data(addr, _decomp_buf, count, state) ) return false;
+
+    in      += in_used;
+    in_len  -= in_used;
+    addr    += count;
+    raw_len -= count;
+  }
+
+  return true;
+}
+
+// Region of a block for per-region accounting of multi-image sessions
+static uint8_t block_region (UF2_Block const *bl)
+{
+  if ( bl->flags & UF2_FLAG_NOFLASH ) return UF2_REGION_NONE;
+  if ( bl->familyID == CFG_UF2_FAMILY_BOOT_ID ) return UF2_REGION_BOOTLOADER;
+  if ( in_qspi_data_space(bl->targetAddr) ) return UF2_REGION_QSPI;
+  if ( bl->targetAddr < DFU_BANK_0_REGION_START ) return UF2_REGION_SD;
+
+  return UF2_REGION_APP;
+}
+
+// Count block towards completion of the uf2 file, flush once all blocks are received
+static void track_written_block (UF2_Block const *bl, WriteState *state)
+{
+  if ( bl->numBlocks )
+  {
+    // Update state num blocks if needed
+    if ( state->numBlocks != bl->numBlocks )
+    {
+      if ( bl->numBlocks >= MAX_BLOCKS || state->numBlocks )
+        state->numBlocks = 0xffffffff;
+      else
+        state->numBlocks = bl->numBlocks;
+    }
+
+    stats_block_received();
+
+    if ( bl->blockNo < MAX_BLOCKS )
+    {
+      uint8_t const mask = 1 << (bl->blockNo % 8);
+      uint32_t const pos = bl->blockNo / 8;
+
+      // only increase written number with new write (possibly prevent overwriting from OS)
+      if ( !(state->writtenMask[pos] & mask) )
+      {
+        uint8_t const region = block_region(bl);
+
+        state->writtenMask[pos] |= mask;
+        state->numWritten++;
+        if ( region < UF2_REGION_COUNT ) state->region_blocks[region]++;
+      }
+      else
+      {
+        _uf2_stats.duplicates++;
+      }
+
+      // flush last blocks
+      // TODO numWritten can be smaller than numBlocks if return early
+      if ( state->numWritten >= state->numBlocks )
+      {
+        // Failed if last page did not verify, or update bootloader without UCIR value
+        if ( !flash_nrf5x_flush(true) )
+        {
+          state->aborted = true;
+        }
+        else if ( state->update_bootloader && !state->has_uicr )
+        {
+          state->aborted = true;
+        }
+      }
+    }
+  }
+}
+
+bool uf2_boot_slot_free(void)
+{
+  bootloader_settings_t const* p_settings;
+  bootloader_util_settings_get(&p_settings);
+
+  if ( (p_settings->bank_0 == BANK_VALID_APP) &&
+       (DFU_BANK_0_REGION_START + p_settings->bank_0_size > BOOTLOADER_ADDR_NEW_RECIEVED) )
+  {
+    return false;
+  }
+
+  // app size is not always known (e.g uf2 app), slot must also be blank or still hold
+  // the copy of the running bootloader left there by the previous update
+  uint32_t const* slot    = (uint32_t const*) BOOTLOADER_ADDR_NEW_RECIEVED;
+  uint32_t const* current = (uint32_t const*) BOOTLOADER_ADDR_START;
+  bool blank    = true;
+  bool leftover = true;
+
+  for ( uint32_t i = 0; (i < DFU_BL_IMAGE_MAX_SIZE / 4) && (blank || leftover); i++ )
+  {
+    blank    = blank    && (slot[i] == 0xFFFFFFFFUL);
+    leftover = leftover && (slot[i] == current[i]);
+  }
+
+  return blank || leftover;
+}
+
+// Where the new bootloader is received. QSPI staging slot is preferred so that internal flash
+// is only touched once the image is complete, see msc_uf2.c. Otherwise it goes straight into the
+// internal slot, an app reaching into it is invalidated first rather than left half overwritten.
+static uint32_t boot_stage_select (void)
+{
+#ifdef ENABLE_QSPI_STAGING
+  return CFG_UF2_QSPI_XIP_OFFSET + CFG_UF2_QSPI_STAGING_OFFSET;
+#else
+  if ( !uf2_boot_slot_free() )
+  {
+    PRINTF("Bootloader slot overlaps app, invalidate app\r\n");
+
+    dfu_update_status_t update_status;
+    memset(&update_status, 0, sizeof(dfu_update_status_t ));
+    update_status.status_code = DFU_BANK_0_ERASED;
+
+    bootloader_dfu_update_process(update_status);
+  }
+
+  return BOOTLOADER_ADDR_NEW_RECIEVED;
+#endif
+}
+
 /**
  * Write an uf2 block wrapped by 512 sector.
  * @return number of bytes processed, only 3 following values
@@ -421,7 +1156,46 @@ int write_block (uint32_t block_no, uint8_t *data, WriteState *state)
 {
   UF2_Block *bl = (void*) data;
 
-  if ( !is_uf2_block(bl) ) return -1;
+  // Dual transport DFU: first UF2 block (signature block included) takes the flash over from BLE.
+  // Runs from the scheduler, the SoftDevice can be disabled here.
+  if ( (is_uf2_signature_block(bl) || is_uf2_block(bl)) && !dfu_transport_claim(false) ) return -1;
+
+  if ( is_uf2_signature_block(bl) )
+  {
+#ifdef DFU_SIGNING_PUBKEY
+#ifndef ENABLE_QSPI_STAGING
+    if ( bl->blockNo != 0 )
+    {
+      state->aborted = true;
+      return BPB_SECTOR_SIZE;
+    }
+#endif
+
+    memcpy(&state->signed_start, bl->data + 4, 4);
+    memcpy(&state->signed_size , bl->data + 8, 4);
+    memcpy(state->signature, bl->data + 12, sizeof(state->signature));
+    state->has_signature = true;
+#endif
+
+    track_written_block(bl, state);
+    return BPB_SECTOR_SIZE;
+  }
+
+  if ( !is_uf2_block(bl) )
+  {
+#if CFG_UF2_META_OVERLAY_SECTORS
+    if ( is_meta_sector(block_no) ) meta_overlay_write(block_no, data);
+#endif
+    return -1;
+  }
+
+  // file has more blocks than the write state tracks, refuse it before anything is written
+  if ( bl->numBlocks >= MAX_BLOCKS )
+  {
+    PRINTF("uf2 file too large: %lu blocks\r\n", bl->numBlocks);
+    state->aborted = true;
+    return -1;
+  }
 
   switch ( bl->familyID )
   {
@@ -445,11 +1219,97 @@ int write_block (uint32_t block_no, uint8_t *data, WriteState *state)
        *       USER_FLASH_START--|-------------|       |-------------|
        *                         |     MBR     |       |     MBR     |
        *                          -------------         -------------
+       *
+       * QSPI data (outside the staging slot) can be part of the same file, so that SoftDevice,
+       * application and external flash contents are provisioned with a single transfer.
        */
+
+      // new bootloader is received into app space, it cannot share a session with other images
+      if ( state->update_bootloader )
+      {
+        state->aborted = true;
+        return -1;
+      }
+
+#ifdef ENABLE_QSPI_XIP_APP
+      // XIP part linked at 0x12000000 is stored where the XIP window maps it when app is started
+      if ( in_xip_exec_space(bl->targetAddr) )
+      {
+        bl->targetAddr = CFG_UF2_QSPI_XIP_OFFSET + QSPI_XIP_APP_OFFSET + (bl->targetAddr - CFG_UF2_XIP_EXEC_START);
+      }
+#endif
+
+#ifdef DFU_SIGNING_PUBKEY
+      // signature only covers the application, SoftDevice and QSPI data cannot be verified
+      if ( (bl->targetAddr >= USER_FLASH_START) && (block_region(bl) != UF2_REGION_APP) )
+      {
+        state->aborted = true;
+        return -1;
+      }
+
+#ifndef ENABLE_QSPI_STAGING
+      // App is overwritten in place: the signature block leads the file (block 0, see dfusign.py) so
+      // that an unsigned session is refused before any app page is touched
+      if ( bl->targetAddr >= USER_FLASH_START )
+      {
+        if ( !state->has_signature )
+        {
+          PRINTF("No signature block ahead of app\r\n");
+          state->aborted = true;
+          return -1;
+        }
+
+        // first app block of a signed session, app must not boot again until the new one is verified
+        if ( !state->region_blocks[UF2_REGION_APP] )
+        {
+          dfu_update_status_t update_status;
+          memset(&update_status, 0, sizeof(dfu_update_status_t ));
+          update_status.status_code = DFU_BANK_0_ERASED;
+
+          bootloader_dfu_update_process(update_status);
+        }
+      }
+#endif
+#endif
+
       if ( in_app_space(bl->targetAddr) )
       {
-        PRINTF("Write addr = 0x%08lX, block = %ld (%ld of %ld)\r\n", bl->targetAddr, bl->blockNo, state->numWritten, bl->numBlocks);
-        flash_nrf5x_write(bl->targetAddr, bl->data, bl->payloadSize, true);
+        TRACE_DBG("Write addr = 0x%08lX, block = %ld (%ld of %ld)", bl->targetAddr, bl->blockNo, state->numWritten, bl->numBlocks);
+
+        if ( bl->flags & UF2_FLAG_COMPRESSED )
+        {
+          if ( !write_app_compressed(bl, state) )
+          {
+            PRINTF("Invalid or unwritten compressed block\r\n");
+            state->aborted = true;
+            return -1;
+          }
+        }
+        else if ( !write_app_data(bl->targetAddr, bl->data, bl->payloadSize, state) )
+        {
+          state->aborted = true;
+          return -1;
+        }
+      }else if ( in_qspi_data_space(bl->targetAddr) )
+      {
+        // compressed blocks are only decoded into internal flash
+        if ( bl->flags & UF2_FLAG_COMPRESSED ) return -1;
+
+        TRACE_DBG("Write QSPI addr = 0x%08lX, block = %ld (%ld of %ld)", bl->targetAddr, bl->blockNo, state->numWritten, bl->numBlocks);
+        if ( !flash_nrf5x_write(bl->targetAddr, bl->data, bl->payloadSize, true) )
+        {
+          state->aborted = true;
+          return -1;
+        }
+
+#ifdef ENABLE_QSPI_XIP_APP
+        // extent of the XIP part is recorded with the app, so that it is validated on boot
+        if ( in_xip_app_space(bl->targetAddr) )
+        {
+          uint32_t const end = bl->targetAddr + bl->payloadSize - CFG_UF2_QSPI_XIP_OFFSET;
+          if ( end > state->xip_end ) state->xip_end = end;
+        }
+#endif
       }else if ( bl->targetAddr < USER_FLASH_START )
       {
         // do nothing if writing to MBR, occurs when SD hex is included
@@ -467,14 +1327,16 @@ int write_block (uint32_t block_no, uint8_t *data, WriteState *state)
        * - For simplicity, the Bootloader Start Address is fixed for now.
        * - Since SoftDevice is not part of Bootloader, it MUST NOT be included as part of uf2 file.
        * - To prevent corruption/disconnection while transferring we don't directly write over Bootloader.
-       * Instead it is written to highest possible address in Application region. Once everything is received
-       * and verified, it is safely activated using MBR COPY BL command.
+       * Instead it is received into QSPI staging slot (if enabled) or the highest possible address in
+       * Application region. Once everything is received and verified, it is moved into the internal slot
+       * and safely activated using MBR COPY BL command. Only pages that differ are counted as a change.
        *
        * - Along with bootloader code, UCIR (at 0x1000100) is also included containing
        * 0x10001014 (bootloader address), and 0x10001018 (MBR Params address).
        *
-       * Note: part of the existing application can be affected when updating bootloader.
-       * TODO May be worth to have some kind crc/application integrity checking
+       * Note: internal slot is normally free space above the application. If the application reaches
+       * into it, with QSPI staging the covered pages are saved into QSPI and restored by the new bootloader
+       * on its first boot. Without QSPI the application is invalidated before the slot is written.
        *
        *                         -------------         -------------         -------------
        *                        |             |       |             |     + |     New     |
@@ -492,7 +1354,23 @@ int write_block (uint32_t block_no, uint8_t *data, WriteState *state)
        *                        |     MBR     |       |     MBR     |       |     MBR     |
        *                         -------------         -------------         -------------
        */
-      PRINTF("addr = 0x%08lX, block = %ld (%ld of %ld)\r\n", bl->targetAddr, bl->blockNo, state->numWritten, bl->numBlocks);
+      TRACE_DBG("addr = 0x%08lX, block = %ld (%ld of %ld)", bl->targetAddr, bl->blockNo, state->numWritten, bl->numBlocks);
+
+#ifdef DFU_SIGNING_PUBKEY
+      // bootloader uf2 is not signed, signed bootloader updates go through serial/OTA DFU
+      state->aborted = true;
+      return -1;
+#endif
+
+      // new bootloader is received into app space, it cannot share a session with other images
+      if ( state->region_blocks[UF2_REGION_SD] || state->region_blocks[UF2_REGION_APP] || state->region_blocks[UF2_REGION_QSPI] )
+      {
+        state->aborted = true;
+        return -1;
+      }
+
+      // compressed bootloader is not supported, UICR and CF2 config are parsed from raw data
+      if ( bl->flags & UF2_FLAG_COMPRESSED ) return -1;
 
       state->update_bootloader = true;
       if ( in_uicr_space(bl->targetAddr) )
@@ -557,9 +1435,13 @@ int write_block (uint32_t block_no, uint8_t *data, WriteState *state)
           }
         }
 
-        // Offset to write the new bootloader address (skipping the App Data)
-        uint32_t const offset_addr = BOOTLOADER_ADDR_END-USER_FLASH_END;
-        flash_nrf5x_write(bl->targetAddr-offset_addr, bl->data, bl->payloadSize, true);
+        if ( !state->boot_stage ) state->boot_stage = boot_stage_select();
+
+        if ( !flash_nrf5x_write(state->boot_stage + (bl->targetAddr - BOOTLOADER_ADDR_START), bl->data, bl->payloadSize, true) )
+        {
+          state->aborted = true;
+          return -1;
+        }
       }
 #if 0 // don't allow bundle SoftDevice to prevent confusion
       else if ( in_app_space(bl->targetAddr) )
@@ -584,43 +1466,7 @@ int write_block (uint32_t block_no, uint8_t *data, WriteState *state)
   }
 
   //------------- Update written blocks -------------//
-  if ( bl->numBlocks )
-  {
-    // Update state num blocks if needed
-    if ( state->numBlocks != bl->numBlocks )
-    {
-      if ( bl->numBlocks >= MAX_BLOCKS || state->numBlocks )
-        state->numBlocks = 0xffffffff;
-      else
-        state->numBlocks = bl->numBlocks;
-    }
-
-    if ( bl->blockNo < MAX_BLOCKS )
-    {
-      uint8_t const mask = 1 << (bl->blockNo % 8);
-      uint32_t const pos = bl->blockNo / 8;
-
-      // only increase written number with new write (possibly prevent overwriting from OS)
-      if ( !(state->writtenMask[pos] & mask) )
-      {
-        state->writtenMask[pos] |= mask;
-        state->numWritten++;
-      }
-
-      // flush last blocks
-      // TODO numWritten can be smaller than numBlocks if return early
-      if ( state->numWritten >= state->numBlocks )
-      {
-        flash_nrf5x_flush(true);
-
-        // Failed if update bootloader without UCIR value
-        if ( state->update_bootloader && !state->has_uicr )
-        {
-          state->aborted = true;
-        }
-      }
-    }
-  }
+  track_written_block(bl, state);
 
   return BPB_SECTOR_SIZE;
 }
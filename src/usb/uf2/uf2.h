@@ -31,6 +31,7 @@ SOFTWARE.
 #define UF2FORMAT_H 1
 
 #include "uf2cfg.h"
+#include "sha256.h"
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -48,15 +49,64 @@ SOFTWARE.
 #define UF2_FLAG_NOFLASH  0x00000001
 #define UF2_FLAG_FAMILYID 0x00002000
 
-#define MAX_BLOCKS (CFG_UF2_FLASH_SIZE / 256 + 100)
+// Non-standard: payload is heatshrink compressed, data[0..3] holds the decompressed length
+// followed by the stream, see decompress.h. Only supported for application blocks.
+#define UF2_FLAG_COMPRESSED 0x00100000
+
+// Signature block: NOFLASH block of the app family carrying magic, image start, image size and
+// Ed25519 signature of the SHA-256 digest of the image, see tools/dfusign.py
+#define UF2_SIGNATURE_MAGIC     0x35324445UL // "ED25"
+#define UF2_SIGNATURE_SIZE      (12 + 64)
+
+// Flash regions a single uf2 session can cover, SoftDevice + app + QSPI data can be combined
+enum {
+  UF2_REGION_SD = 0,
+  UF2_REGION_APP,
+  UF2_REGION_QSPI,
+  UF2_REGION_BOOTLOADER,
+  UF2_REGION_COUNT,
+  UF2_REGION_NONE = UF2_REGION_COUNT, // NOFLASH blocks e.g signature
+};
+
+// Blocks of one uf2 file, writtenMask costs a bit each
+#define MAX_BLOCKS (CFG_UF2_MAX_FILE_FLASH_SIZE / 256 + 100)
+
+#ifdef ENABLE_QSPI_STAGING
+// App data received into the staging slot is tracked in units of the usual uf2 payload
+#define UF2_STAGED_UNIT_SIZE  256
+#define UF2_STAGED_UNITS      ((USER_FLASH_END - USER_FLASH_START) / UF2_STAGED_UNIT_SIZE)
+#endif
+
 typedef struct {
     uint32_t numBlocks;
     uint32_t numWritten;
+    uint32_t region_blocks[UF2_REGION_COUNT]; // blocks received per region
 
     bool aborted;             // aborting update and reset
     bool update_bootloader;   // if updating bootloader (else app)
     bool has_uicr;            // if containing uicr data
     bool boot_id_matches;     // if bootloader id in cf2 config matches our VID/PID
+    uint32_t boot_stage;      // uf2 address the new bootloader is received at, 0 = not chosen yet
+
+#ifdef ENABLE_QSPI_STAGING
+    uint32_t staged_start;    // lowest app address received into QSPI staging slot
+    uint32_t staged_end;      // highest app address (exclusive) received into QSPI staging slot
+    uint8_t  staged_mask[UF2_STAGED_UNITS / 8 + 1]; // app units received into staging slot, a partly covered unit counts
+#else
+    sha256_t sha;             // digest of app written so far, only valid if blocks arrive in order
+    uint32_t sha_next;        // next expected app address, 0 = not started, UINT32_MAX = out of order
+#endif
+
+#ifdef ENABLE_QSPI_XIP_APP
+    uint32_t xip_end;         // highest QSPI address (exclusive) of the app XIP part received, 0 = none
+#endif
+
+#ifdef DFU_SIGNING_PUBKEY
+    bool has_signature;       // signature block received
+    uint32_t signed_start;    // app range covered by signature
+    uint32_t signed_size;
+    uint8_t signature[64];
+#endif
 
     uint8_t writtenMask[MAX_BLOCKS / 8 + 1];
 } WriteState;
@@ -79,6 +129,24 @@ typedef struct {
     uint32_t magicEnd;
 } UF2_Block;
 
+// Boot phases timed in STATS.TXT, in order
+enum {
+  UF2_BOOT_INIT = 0,  // bootloader_init() done
+  UF2_BOOT_UPDATE,    // pending SoftDevice swap / staged app commit done
+  UF2_BOOT_USB,       // usb_init() done
+  UF2_BOOT_MOUNTED,   // enumerated by host
+  UF2_BOOT_PHASE_COUNT
+};
+
 void uf2_init(void);
 
+// Internal slot the MBR copies a new bootloader from can be used without touching the app
+bool uf2_boot_slot_free(void);
+
+// Record time of a boot phase, only the first occurrence is kept
+void uf2_stats_boot_phase(uint8_t phase);
+
+// Drop host metadata writes kept by the volume, host sees the generated view again
+void uf2_meta_overlay_clear(void);
+
 #endif
@@ -1,8 +1,10 @@
 #include "boards.h"
 #include "dfu_types.h"
 
-// Virtual disk size: just under 32MB
-#define CFG_UF2_NUM_BLOCKS            0x10109
+// Host FAT and directory sector writes kept in RAM and served back on read, 512 bytes each, 0 = off
+#ifndef CFG_UF2_META_OVERLAY_SECTORS
+  #define CFG_UF2_META_OVERLAY_SECTORS  8
+#endif
 
 // Family ID for updating Bootloader
 #define CFG_UF2_FAMILY_BOOT_ID        0xd663823c
@@ -22,13 +24,82 @@
     #define CFG_UF2_QSPI_FLASH_SIZE   QSPI_FLASH_SIZE
     #define CFG_UF2_QSPI_XIP_OFFSET   QSPI_XIP_OFFSET
     #define CFG_UF2_TOTAL_FLASH_SIZE  (CFG_UF2_FLASH_SIZE + CFG_UF2_QSPI_FLASH_SIZE)
+
+    // QSPI part of a single uf2 file that is accepted, the write state keeps one bit per block
+    // so it is capped rather than grown with the chip. Larger files are refused.
+    #ifndef CFG_UF2_QSPI_MAX_FILE_SIZE
+      #define CFG_UF2_QSPI_MAX_FILE_SIZE  (2*1024*1024)
+    #endif
+
+    #if CFG_UF2_QSPI_FLASH_SIZE > CFG_UF2_QSPI_MAX_FILE_SIZE
+      #define CFG_UF2_MAX_FILE_FLASH_SIZE (CFG_UF2_FLASH_SIZE + CFG_UF2_QSPI_MAX_FILE_SIZE)
+    #else
+      #define CFG_UF2_MAX_FILE_FLASH_SIZE CFG_UF2_TOTAL_FLASH_SIZE
+    #endif
+
+    // Staged application update: uf2 app image is received into a slot at the top of QSPI,
+    // then committed into internal flash in a single pass once the transfer is complete.
+    #ifdef ENABLE_QSPI_STAGING
+      #define CFG_UF2_QSPI_STAGING_SIZE   ((USER_FLASH_END - USER_FLASH_START + CODE_PAGE_SIZE - 1) & ~(CODE_PAGE_SIZE - 1))
+      #define CFG_UF2_QSPI_STAGING_OFFSET (CFG_UF2_QSPI_FLASH_SIZE - CFG_UF2_QSPI_STAGING_SIZE)
+    #endif
+
+    // Part of the application linked at the XIP window address is stored at QSPI_XIP_APP_OFFSET
+    #ifdef ENABLE_QSPI_XIP_APP
+      #define CFG_UF2_XIP_EXEC_START      0x12000000
+    #endif
   #else
     #define CFG_UF2_TOTAL_FLASH_SIZE  CFG_UF2_FLASH_SIZE
+    #define CFG_UF2_MAX_FILE_FLASH_SIZE CFG_UF2_FLASH_SIZE
   #endif
 #elif defined(NRF52833_XXAA)
   #define CFG_UF2_FAMILY_APP_ID       0x621E937A
   #define CFG_UF2_FLASH_SIZE          (512*1024)  // 512 kB
   #define CFG_UF2_TOTAL_FLASH_SIZE    CFG_UF2_FLASH_SIZE
+  #define CFG_UF2_MAX_FILE_FLASH_SIZE CFG_UF2_FLASH_SIZE
+#endif
+
+// Virtual disk size: just under 32MB FAT16, enough for a CURRENT.UF2 (twice the flash size) of up to 15MB flash.
+// Per-region files that no longer fit after it (above about 7MB flash) are left empty.
+// Larger flash gets a FAT32 volume sized from it instead, see ghostfat.c
+#if defined(CFG_UF2_TOTAL_FLASH_SIZE) && (CFG_UF2_TOTAL_FLASH_SIZE > 15*1024*1024)
+  #define CFG_UF2_FAT32                   1
+
+  // one 512-byte sector per 256 bytes of flash, once for CURRENT.UF2 and once for region files
+  #define CFG_UF2_FAT32_UF2_SECTORS       (2 * CFG_UF2_TOTAL_FLASH_SIZE / 256)
+
+  // Clusters grow with flash, keeping the cluster count (and FAT size) just above the FAT32 minimum
+  #if   CFG_UF2_FAT32_UF2_SECTORS >= 64 * 0x10015
+    #define CFG_UF2_FAT32_SECTORS_PER_CLUSTER  64
+  #elif CFG_UF2_FAT32_UF2_SECTORS >= 32 * 0x10015
+    #define CFG_UF2_FAT32_SECTORS_PER_CLUSTER  32
+  #elif CFG_UF2_FAT32_UF2_SECTORS >= 16 * 0x10015
+    #define CFG_UF2_FAT32_SECTORS_PER_CLUSTER  16
+  #elif CFG_UF2_FAT32_UF2_SECTORS >= 8 * 0x10015
+    #define CFG_UF2_FAT32_SECTORS_PER_CLUSTER  8
+  #elif CFG_UF2_FAT32_UF2_SECTORS >= 4 * 0x10015
+    #define CFG_UF2_FAT32_SECTORS_PER_CLUSTER  4
+  #elif CFG_UF2_FAT32_UF2_SECTORS >= 2 * 0x10015
+    #define CFG_UF2_FAT32_SECTORS_PER_CLUSTER  2
+  #else
+    #define CFG_UF2_FAT32_SECTORS_PER_CLUSTER  1
+  #endif
+
+  // UF2 files plus 16 clusters for root directory, text files and partial clusters, never below the FAT32 minimum
+  // (kept 32 away from it, many FAT implementations have off-by-one style errors there)
+  #define CFG_UF2_FAT32_CLUSTERS_MIN      0x10015
+  #define CFG_UF2_FAT32_CLUSTERS_USED     (CEIL_DIV(CFG_UF2_FAT32_UF2_SECTORS, CFG_UF2_FAT32_SECTORS_PER_CLUSTER) + 16)
+  #define CFG_UF2_FAT32_CLUSTERS          ((CFG_UF2_FAT32_CLUSTERS_USED > CFG_UF2_FAT32_CLUSTERS_MIN) ? \
+                                           CFG_UF2_FAT32_CLUSTERS_USED : CFG_UF2_FAT32_CLUSTERS_MIN)
+
+  #define CFG_UF2_FAT32_RESERVED_SECTORS  32
+  #define CFG_UF2_FAT32_SECTORS_PER_FAT   CEIL_DIV((CFG_UF2_FAT32_CLUSTERS + 2) * 4, 512)
+
+  #define CFG_UF2_NUM_BLOCKS              (CFG_UF2_FAT32_RESERVED_SECTORS + 2 * CFG_UF2_FAT32_SECTORS_PER_FAT + \
+                                           CFG_UF2_FAT32_CLUSTERS * CFG_UF2_FAT32_SECTORS_PER_CLUSTER)
+#else
+  #define CFG_UF2_FAT32                   0
+  #define CFG_UF2_NUM_BLOCKS              0x10109
 #endif
 
 // Application Address Space
@@ -41,5 +112,20 @@
 // Bootloader end address
 #define BOOTLOADER_ADDR_END           BOOTLOADER_MBR_PARAMS_PAGE_ADDRESS
 
-// Address where new bootloader is written before activation (skip application data)
+// Address where MBR copies new bootloader from on activation (skip application data).
+// Free space above the app, see uf2_boot_slot_free()
 #define BOOTLOADER_ADDR_NEW_RECIEVED  (USER_FLASH_END-DFU_BL_IMAGE_MAX_SIZE)
+
+#if defined(ENABLE_QSPI_STAGING) && !defined(ENABLE_QSPI_FLASH)
+  #error "ENABLE_QSPI_STAGING requires ENABLE_QSPI_FLASH"
+#endif
+
+#ifdef ENABLE_QSPI_XIP_APP
+  #ifndef ENABLE_QSPI_FLASH
+    #error "ENABLE_QSPI_XIP_APP requires ENABLE_QSPI_FLASH"
+  #endif
+
+  #if (QSPI_XIP_APP_OFFSET % 4096) || (QSPI_XIP_APP_OFFSET + QSPI_XIP_APP_SIZE > QSPI_FLASH_SIZE)
+    #error "QSPI_XIP_APP_OFFSET must be sector aligned and the XIP window must fit in QSPI flash"
+  #endif
+#endif
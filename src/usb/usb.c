@@ -47,6 +47,18 @@ static void power_event_handler(nrfx_power_usb_evt_t event) {
   tusb_hal_nrf_power_event((uint32_t) event);
 }
 
+static void power_nrfx_init(void) {
+  // Power module init
+  const nrfx_power_config_t pwr_cfg = {0};
+  nrfx_power_init(&pwr_cfg);
+
+  // Register USB power handler
+  const nrfx_power_usbevt_config_t config = {.handler = power_event_handler};
+  nrfx_power_usbevt_init(&config);
+
+  nrfx_power_usbevt_enable();
+}
+
 // Forward USB interrupt events to TinyUSB IRQ Handler
 void USBD_IRQHandler(void) {
   tud_int_handler(0);
@@ -72,15 +84,7 @@ void usb_init(bool cdc_only) {
     sd_power_usbremoved_enable(true);
     sd_power_usbregstatus_get(&usb_reg);
   } else {
-    // Power module init
-    const nrfx_power_config_t pwr_cfg = {0};
-    nrfx_power_init(&pwr_cfg);
-
-    // Register USB power handler
-    const nrfx_power_usbevt_config_t config = {.handler = power_event_handler};
-    nrfx_power_usbevt_init(&config);
-
-    nrfx_power_usbevt_enable();
+    power_nrfx_init();
 
     usb_reg = NRF_POWER->USBREGSTATUS;
   }
@@ -103,6 +107,16 @@ void usb_init(bool cdc_only) {
   #endif
 }
 
+// SoftDevice disabled while USB is running (dual transport DFU taken by USB):
+// power events come from POWER peripheral from now on, and HFXO is no longer requested through SD
+void usb_sd_disabled(void) {
+  power_nrfx_init();
+
+  NRF_CLOCK->EVENTS_HFCLKSTARTED = 0;
+  NRF_CLOCK->TASKS_HFCLKSTART = 1;
+  while (!NRF_CLOCK->EVENTS_HFCLKSTARTED) {}
+}
+
 void usb_teardown(void) {
   // Simulate an disconnect which cause pullup disable, USB perpheral disable and hclk disable
   tusb_hal_nrf_power_event(NRFX_POWER_USB_EVT_REMOVED);
@@ -113,8 +127,10 @@ void usb_teardown(void) {
 //--------------------------------------------------------------------+
 void tud_mount_cb(void) {
   led_state(STATE_USB_MOUNTED);
+  uf2_stats_boot_phase(UF2_BOOT_MOUNTED);
 }
 
 void tud_umount_cb(void) {
   led_state(STATE_USB_UNMOUNTED);
+  uf2_meta_overlay_clear();
 }
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+
+# The MIT License (MIT)
+#
+# Copyright (c) 2026 Adafruit Industries
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""Generate an in-place delta patch for serial/OTA DFU (src/delta.c).
+
+  dfudelta.py old.bin new.bin -o app.patch
+
+Send app.patch as application data with DFU_UPDATE_APP_DELTA set in the start packet. The start
+packet carries the size of new.bin, the init packet extended data carries CRC16 of new.bin,
+flags, then CRC16 and size of old.bin as printed by this tool. With DFU_INIT_FLAG_SHA256 set in
+flags, the SHA-256 digest of new.bin goes between flags and the base image info, followed by the
+signature when signed with dfusign.py.
+"""
+
+import argparse
+import bisect
+import struct
+
+PAGE_SIZE = 4096
+KEY_LEN = 8
+MIN_COPY = 12     # copy header is 9 bytes, shorter matches are cheaper as literals
+MAX_CANDIDATES = 16
+
+OP_COPY = 0
+OP_INSERT = 1
+
+
+def crc16(data):
+    """crc16_compute() from nRF SDK: CRC-16-CCITT, initial 0xFFFF"""
+    crc = 0xFFFF
+    for b in data:
+        crc = ((crc >> 8) & 0xFF) | ((crc << 8) & 0xFFFF)
+        crc ^= b
+        crc ^= (crc & 0xFF) >> 4
+        crc ^= (crc << 12) & 0xFFFF
+        crc ^= ((crc & 0xFF) << 5) & 0xFFFF
+    return crc
+
+
+def match_len(old, new, src, dst):
+    n = 0
+    while dst + n < len(new) and src + n < len(old) and old[src + n] == new[dst + n]:
+        # new image is written page by page over the old one, only read pages not yet rewritten
+        if src + n < ((dst + n) & ~(PAGE_SIZE - 1)):
+            break
+        n += 1
+    return n
+
+
+def diff(old, new):
+    index = {}
+    for i in range(len(old) - KEY_LEN + 1):
+        index.setdefault(old[i:i + KEY_LEN], []).append(i)
+
+    patch = bytearray()
+    literal = bytearray()
+    pos = 0
+
+    def flush_literal():
+        if literal:
+            patch.extend(struct.pack("<BI", OP_INSERT, len(literal)) + literal)
+            literal.clear()
+
+    while pos < len(new):
+        page_start = pos & ~(PAGE_SIZE - 1)
+        best_len, best_src = 0, 0
+
+        # same offset is the common case for unchanged code
+        if pos < len(old):
+            best_len, best_src = match_len(old, new, pos, pos), pos
+
+        cands = index.get(new[pos:pos + KEY_LEN], [])
+        first = bisect.bisect_left(cands, page_start)
+        for src in cands[first:first + MAX_CANDIDATES]:
+            n = match_len(old, new, src, pos)
+            if n > best_len:
+                best_len, best_src = n, src
+
+        if best_len >= MIN_COPY:
+            flush_literal()
+            patch.extend(struct.pack("<BII", OP_COPY, best_src, best_len))
+            pos += best_len
+        else:
+            literal.append(new[pos])
+            pos += 1
+
+    flush_literal()
+    return bytes(patch)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("old")
+    parser.add_argument("new")
+    parser.add_argument("-o", "--output", required=True)
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        old = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+
+    patch = diff(old, new)
+    # transports only accept word sized packets, applier stops at the image size from start packet
+    patch += bytes(-len(patch) % 4)
+
+    with open(args.output, "wb") as f:
+        f.write(patch)
+
+    print("{}: {} bytes ({:.1f}% of new image)".format(args.output, len(patch), 100.0 * len(patch) / len(new)))
+    print("new image: size {} crc16 0x{:04X}".format(len(new), crc16(new)))
+    print("base image: size {} crc16 0x{:04X}".format(len(old), crc16(old)))
+
+
+if __name__ == "__main__":
+    main()
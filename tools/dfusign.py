@@ -0,0 +1,229 @@
+#!/usr/bin/env python3
+
+# The MIT License (MIT)
+#
+# Copyright (c) 2026 Adafruit Industries
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""Sign firmware for bootloaders built with a public key (src/ed25519.c).
+
+  dfusign.py keygen key.bin                       create a private key, prints make arguments
+  dfusign.py pubkey key.bin                       print make arguments for an existing key
+  dfusign.py sign key.bin app.uf2 -o app.s.uf2    put a signature block in front of an uf2 file
+  dfusign.py sign key.bin app.bin -o app.ext      write init packet extended data for serial/OTA DFU
+
+The bootloader is built with `make BOARD=... SIGNING_PUBKEY=...` and then refuses unsigned updates.
+The signature is Ed25519 over the SHA-256 digest of the image, so the bootloader only needs the
+digest it already streams while writing.
+
+Serial/OTA: extended data is CRC16 (2), flags (2) = DFU_INIT_FLAG_SHA256 | DFU_INIT_FLAG_SIGNED,
+SHA-256 digest (32) and signature (64). It replaces the CRC16 that nrfutil appends to the init packet.
+Sign a delta patch with the digest of the new image and append the base image info after it.
+
+UF2: sign before running uf2compress.py, signature block is a NOFLASH block of the app family.
+It is block 0 of the file: bootloaders writing the app in place refuse app blocks received before it.
+"""
+
+import argparse
+import hashlib
+import os
+import struct
+import sys
+
+from dfudelta import crc16
+
+# ------------- Ed25519, RFC 8032 section 6 -------------
+P = 2 ** 255 - 19
+L = 2 ** 252 + 27742317777372353535851937790883648493
+D = -121665 * pow(121666, P - 2, P) % P
+SQRT_M1 = pow(2, (P - 1) // 4, P)
+
+
+def point_add(p, q):
+    a = (p[1] - p[0]) * (q[1] - q[0]) % P
+    b = (p[1] + p[0]) * (q[1] + q[0]) % P
+    c = 2 * p[3] * q[3] * D % P
+    d = 2 * p[2] * q[2] % P
+    e, f, g, h = b - a, d - c, d + c, b + a
+    return (e * f, g * h, f * g, e * h)
+
+
+def point_mul(s, p):
+    q = (0, 1, 1, 0)
+    while s > 0:
+        if s & 1:
+            q = point_add(q, p)
+        p = point_add(p, p)
+        s >>= 1
+    return q
+
+
+def point_compress(p):
+    zinv = pow(p[2], P - 2, P)
+    x, y = p[0] * zinv % P, p[1] * zinv % P
+    return int.to_bytes(y | ((x & 1) << 255), 32, "little")
+
+
+def recover_x(y, sign):
+    x2 = (y * y - 1) * pow(D * y * y + 1, P - 2, P)
+    x = pow(x2, (P + 3) // 8, P)
+    if (x * x - x2) % P != 0:
+        x = x * SQRT_M1 % P
+    if x & 1 != sign:
+        x = P - x
+    return x
+
+
+G_Y = 4 * pow(5, P - 2, P) % P
+G_X = recover_x(G_Y, 0)
+G = (G_X, G_Y, 1, G_X * G_Y % P)
+
+
+def sha512_int(data):
+    return int.from_bytes(hashlib.sha512(data).digest(), "little")
+
+
+def secret_expand(secret):
+    h = hashlib.sha512(secret).digest()
+    a = int.from_bytes(h[:32], "little")
+    a &= (1 << 254) - 8
+    a |= (1 << 254)
+    return a, h[32:]
+
+
+def public_key(secret):
+    a, _ = secret_expand(secret)
+    return point_compress(point_mul(a, G))
+
+
+def sign(secret, msg):
+    a, prefix = secret_expand(secret)
+    pub = point_compress(point_mul(a, G))
+    r = sha512_int(prefix + msg) % L
+    rs = point_compress(point_mul(r, G))
+    h = sha512_int(rs + pub + msg) % L
+    s = (r + h * a) % L
+    return rs + int.to_bytes(s, 32, "little")
+
+
+# ------------- Image formats -------------
+UF2_MAGIC_START0 = 0x0A324655
+UF2_MAGIC_START1 = 0x9E5D5157
+UF2_MAGIC_END = 0x0AB16F30
+UF2_FLAG_NOFLASH = 0x00000001
+UF2_FLAG_FAMILYID = 0x00002000
+UF2_FLAG_COMPRESSED = 0x00100000
+UF2_BOOT_FAMILY_ID = 0xd663823c
+UF2_DATA_SIZE = 476
+UF2_SIGNATURE_MAGIC = 0x35324445  # "ED25", must match uf2.h
+
+DFU_INIT_FLAG_SHA256 = 0x0002
+DFU_INIT_FLAG_SIGNED = 0x0004
+
+
+def make_args(secret):
+    return "SIGNING_PUBKEY=" + ",".join("0x{:02x}".format(b) for b in public_key(secret))
+
+
+def sign_uf2(secret, buf):
+    blocks = []
+    for ptr in range(0, len(buf), 512):
+        hd = list(struct.unpack("<8I", buf[ptr:ptr + 32]))
+        if hd[0] == UF2_MAGIC_START0 and hd[1] == UF2_MAGIC_START1:
+            blocks.append((hd, buf[ptr + 32:ptr + 32 + hd[4]]))
+
+    app = [(hd, data) for hd, data in blocks if hd[7] != UF2_BOOT_FAMILY_ID and not hd[2] & UF2_FLAG_NOFLASH]
+    if any(hd[2] & UF2_FLAG_COMPRESSED for hd, _ in app):
+        sys.exit("sign the uf2 before compressing it")
+    if len(app) != len(blocks):
+        sys.exit("only application uf2 files can be signed")
+
+    app.sort(key=lambda b: b[0][3])
+    start = app[0][0][3]
+    image = bytearray()
+    for hd, data in app:
+        if hd[3] != start + len(image):
+            sys.exit("image has a gap at 0x{:08X}, signed images must be contiguous".format(start + len(image)))
+        image += data
+
+    digest = hashlib.sha256(image).digest()
+    payload = struct.pack("<III", UF2_SIGNATURE_MAGIC, start, len(image)) + sign(secret, digest)
+
+    family = app[0][0][7]
+    total = len(blocks) + 1
+    hd = [UF2_MAGIC_START0, UF2_MAGIC_START1, UF2_FLAG_NOFLASH | UF2_FLAG_FAMILYID, start, len(payload),
+          0, total, family]
+    out = bytearray(struct.pack("<8I", *hd) + payload + bytes(UF2_DATA_SIZE - len(payload)) + struct.pack("<I", UF2_MAGIC_END))
+
+    for i, (hd, data) in enumerate(blocks):
+        hd[5], hd[6] = i + 1, total
+        out += struct.pack("<8I", *hd) + data + bytes(UF2_DATA_SIZE - len(data)) + struct.pack("<I", UF2_MAGIC_END)
+
+    print("signed {} bytes at 0x{:08X}, sha256 {}".format(len(image), start, digest.hex()))
+    return bytes(out)
+
+
+def sign_bin(secret, image):
+    digest = hashlib.sha256(image).digest()
+    print("signed {} bytes, sha256 {}".format(len(image), digest.hex()))
+    return struct.pack("<HH", crc16(image), DFU_INIT_FLAG_SHA256 | DFU_INIT_FLAG_SIGNED) + digest + sign(secret, digest)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    p = sub.add_parser("keygen")
+    p.add_argument("key")
+    p = sub.add_parser("pubkey")
+    p.add_argument("key")
+    p = sub.add_parser("sign")
+    p.add_argument("key")
+    p.add_argument("input")
+    p.add_argument("-o", "--output", required=True)
+    args = parser.parse_args()
+
+    if args.cmd == "keygen":
+        if os.path.exists(args.key):
+            sys.exit("{} exists, refusing to overwrite".format(args.key))
+        secret = os.urandom(32)
+        with open(args.key, "wb") as f:
+            f.write(secret)
+        print(make_args(secret))
+        return
+
+    with open(args.key, "rb") as f:
+        secret = f.read()
+    if len(secret) != 32:
+        sys.exit("{} is not a 32-byte Ed25519 private key".format(args.key))
+
+    if args.cmd == "pubkey":
+        print(make_args(secret))
+        return
+
+    with open(args.input, "rb") as f:
+        buf = f.read()
+
+    out = sign_uf2(secret, buf) if args.input.lower().endswith(".uf2") else sign_bin(secret, buf)
+    with open(args.output, "wb") as f:
+        f.write(out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,308 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "nrf_error.h"
+#include "boards.h"
+#include "nrfx_nvmc.h"
+#include "qspi_flash.h"
+#include "bootloader.h"
+#include "bootloader_settings.h"
+#include "ram_usage.h"
+#include "app_scheduler.h"
+#include "nrf_mbr.h"
+#include "tusb.h"
+#include "flash_host.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+#define FLASH_SIZE        (1024*1024)
+#define FLASH_PAGE_SIZE   4096
+
+// MBR page stays unmapped, mmap refuses page 0. Firmware never writes it, see write_block()
+#define FLASH_MAP_START   0x1000
+
+// FICR + UICR
+#define UICR_MAP_START    0x10000000UL
+#define UICR_MAP_SIZE     0x2000
+
+#define SD_S140_6_1_1_SIZE  0x26000
+
+static flash_host_stats_t _stats;
+static int _update_status = -1;
+
+static uint8_t _qspi[QSPI_FLASH_SIZE];
+
+// pages programmed in this session, to count rewrites
+static uint8_t _page_written[FLASH_SIZE / FLASH_PAGE_SIZE / 8];
+static uint8_t _qspi_page_written[QSPI_FLASH_SIZE / W25Q16_PAGE_SIZE / 8];
+
+static uint32_t _stuck_addr;
+
+static bool mark_written (uint8_t* mask, uint32_t idx)
+{
+  bool const was = mask[idx / 8] & (1 << (idx % 8));
+  mask[idx / 8] |= (uint8_t) (1 << (idx % 8));
+  return was;
+}
+
+// Programming flash can only clear bits
+static void program (uint8_t* dst, uint8_t const* src, uint32_t len)
+{
+  for ( uint32_t i = 0; i < len; i++ ) dst[i] &= src[i];
+
+  if ( _stuck_addr && ((uintptr_t) dst <= _stuck_addr) && (_stuck_addr < (uintptr_t) dst + len) )
+  {
+    *(uint8_t*) (uintptr_t) _stuck_addr |= 1;
+  }
+}
+
+static void* map_fixed (uint32_t addr, uint32_t len)
+{
+  void* p = mmap((void*) (uintptr_t) addr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  return (p == (void*) (uintptr_t) addr) ? p : NULL;
+}
+
+bool flash_host_init (void)
+{
+  uint8_t* flash = map_fixed(FLASH_MAP_START, FLASH_SIZE - FLASH_MAP_START);
+  uint8_t* uicr  = map_fixed(UICR_MAP_START, UICR_MAP_SIZE);
+
+  if ( !flash || !uicr ) return false;
+
+  memset(flash, 0xff, FLASH_SIZE - FLASH_MAP_START);
+  memset(uicr , 0xff, UICR_MAP_SIZE);
+  memset(_qspi, 0xff, sizeof(_qspi));
+
+  uint32_t const sd_info[] = { 0xFFFFFF2C, SD_MAGIC_NUMBER, SD_S140_6_1_1_SIZE, 0xFFFFFFFF, 140, 6001001 };
+  memcpy((void*) (uintptr_t) SOFTDEVICE_INFO_STRUCT_ADDRESS, sd_info, sizeof(sd_info));
+
+  return true;
+}
+
+void flash_host_load (uint32_t addr, void const* data, uint32_t len)
+{
+  if ( addr >= QSPI_XIP_OFFSET )
+  {
+    memcpy(_qspi + (addr - QSPI_XIP_OFFSET), data, len);
+  }
+  else
+  {
+    memcpy((void*) (uintptr_t) addr, data, len);
+  }
+}
+
+void flash_host_stuck_bit (uint32_t addr)
+{
+  _stuck_addr = addr;
+}
+
+flash_host_stats_t const* flash_host_stats (void)
+{
+  return &_stats;
+}
+
+int flash_host_update_status (void)
+{
+  return _update_status;
+}
+
+//--------------------------------------------------------------------+
+// NVMC
+//--------------------------------------------------------------------+
+void nrfx_nvmc_page_erase (uint32_t address)
+{
+  memset((void*) (uintptr_t) address, 0xff, FLASH_PAGE_SIZE);
+
+  _stats.page_erases++;
+  _stats.flash_us += FLASH_HOST_PAGE_ERASE_US;
+}
+
+void nrfx_nvmc_word_write (uint32_t address, uint32_t value)
+{
+  program((uint8_t*) (uintptr_t) address, (uint8_t const*) &value, 4);
+
+  _stats.words_written++;
+  _stats.flash_us += FLASH_HOST_WORD_WRITE_US;
+}
+
+void nrfx_nvmc_words_write (uint32_t address, void const * src, uint32_t num_words)
+{
+  program((uint8_t*) (uintptr_t) address, src, 4 * num_words);
+
+  if ( mark_written(_page_written, address / FLASH_PAGE_SIZE) ) _stats.bytes_rewritten += 4 * num_words;
+
+  _stats.words_written += num_words;
+  _stats.flash_us += (uint64_t) FLASH_HOST_WORD_WRITE_US * num_words;
+}
+
+//--------------------------------------------------------------------+
+// QSPI
+//--------------------------------------------------------------------+
+qspi_flash_status_t qspi_flash_init (void)
+{
+  return QSPI_FLASH_STATUS_SUCCESS;
+}
+
+qspi_flash_status_t qspi_flash_read (uint32_t address, uint8_t *data, size_t length)
+{
+  if ( address + length > QSPI_FLASH_SIZE ) return QSPI_FLASH_STATUS_ERROR;
+
+  memcpy(data, _qspi + address, length);
+  return QSPI_FLASH_STATUS_SUCCESS;
+}
+
+qspi_flash_status_t qspi_flash_write (uint32_t address, const uint8_t *data, size_t length)
+{
+  if ( address + length > QSPI_FLASH_SIZE ) return QSPI_FLASH_STATUS_ERROR;
+
+  program(_qspi + address, data, length);
+
+  // page program command cannot cross a 256 byte flash page
+  for ( uint32_t page = address / W25Q16_PAGE_SIZE; page <= (address + length - 1) / W25Q16_PAGE_SIZE; page++ )
+  {
+    if ( mark_written(_qspi_page_written, page) ) _stats.bytes_rewritten += W25Q16_PAGE_SIZE;
+
+    _stats.qspi_page_programs++;
+    _stats.flash_us += FLASH_HOST_QSPI_PROGRAM_US;
+  }
+
+  return QSPI_FLASH_STATUS_SUCCESS;
+}
+
+qspi_flash_status_t qspi_flash_erase_sector (uint32_t address)
+{
+  if ( address >= QSPI_FLASH_SIZE ) return QSPI_FLASH_STATUS_ERROR;
+
+  memset(_qspi + (address & ~(W25Q16_SECTOR_SIZE - 1)), 0xff, W25Q16_SECTOR_SIZE);
+
+  _stats.qspi_sector_erases++;
+  _stats.flash_us += FLASH_HOST_QSPI_ERASE_US;
+
+  return QSPI_FLASH_STATUS_SUCCESS;
+}
+
+//--------------------------------------------------------------------+
+// Rest of the bootloader the UF2 write path calls into
+//--------------------------------------------------------------------+
+uint32_t board_millis (void)
+{
+  return (uint32_t) (_stats.flash_us / 1000);
+}
+
+bool dfu_transport_claim (bool ota)
+{
+  return true;
+}
+
+void bootloader_util_settings_get (const bootloader_settings_t ** pp_bootloader_settings)
+{
+  *pp_bootloader_settings = (bootloader_settings_t const*) (uintptr_t) BOOTLOADER_SETTINGS_ADDRESS;
+}
+
+void bootloader_dfu_update_process (dfu_update_status_t update_status)
+{
+  _update_status = update_status.status_code;
+}
+
+void led_state (uint32_t state)
+{
+}
+
+uint32_t sd_mbr_command (sd_mbr_command_t* param)
+{
+  return NRF_ERROR_NOT_SUPPORTED;
+}
+
+bool tud_msc_set_sense (uint8_t lun, uint8_t sense_key, uint8_t add_sense_code, uint8_t add_sense_qualifier)
+{
+  return true;
+}
+
+void ram_usage_get (ram_usage_t* usage)
+{
+  memset(usage, 0, sizeof(ram_usage_t));
+}
+
+char* utoa (unsigned value, char* str, int base)
+{
+  char tmp[33];
+  int n = 0;
+
+  do
+  {
+    tmp[n++] = "0123456789abcdefghijklmnopqrstuvwxyz"[value % base];
+    value /= base;
+  } while ( value );
+
+  for ( int i = 0; i < n; i++ ) str[i] = tmp[n - 1 - i];
+  str[n] = 0;
+
+  return str;
+}
+
+//--------------------------------------------------------------------+
+// Scheduler, events are run in order by app_sched_execute() as in main loop
+//--------------------------------------------------------------------+
+#define SCHED_QUEUE_SIZE      16
+#define SCHED_MAX_EVENT_DATA  16
+
+typedef struct
+{
+  app_sched_event_handler_t handler;
+  uint16_t size;
+  uint8_t data[SCHED_MAX_EVENT_DATA];
+} sched_event_t;
+
+static sched_event_t _sched_queue[SCHED_QUEUE_SIZE];
+static uint32_t _sched_head, _sched_tail;
+
+uint32_t app_sched_event_put (void const * p_event_data, uint16_t event_size, app_sched_event_handler_t handler)
+{
+  if ( event_size > SCHED_MAX_EVENT_DATA ) return NRF_ERROR_INVALID_LENGTH;
+  if ( _sched_tail - _sched_head >= SCHED_QUEUE_SIZE ) return NRF_ERROR_NO_MEM;
+
+  sched_event_t* ev = &_sched_queue[_sched_tail % SCHED_QUEUE_SIZE];
+  ev->handler = handler;
+  ev->size    = event_size;
+  if ( event_size ) memcpy(ev->data, p_event_data, event_size);
+
+  _sched_tail++;
+  return NRF_SUCCESS;
+}
+
+void app_sched_execute (void)
+{
+  while ( _sched_head != _sched_tail )
+  {
+    sched_event_t ev = _sched_queue[_sched_head % SCHED_QUEUE_SIZE];
+    _sched_head++;
+
+    ev.handler(ev.size ? ev.data : NULL, ev.size);
+  }
+}
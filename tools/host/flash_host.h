@@ -0,0 +1,68 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef FLASH_HOST_H_
+#define FLASH_HOST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Host stand-in for the nRF52840 flash behind src/flash_nrf5x.c and src/usb/uf2/ghostfat.c.
+ * Internal flash is mapped at its device address so that the firmware reads it like on target,
+ * NVMC and QSPI operations are counted and charged with datasheet timings. Results are
+ * deterministic estimates to compare changes with, not measurements.
+ */
+
+// nRF52840 product specification (max) and W25Q16JV datasheet (typical), in microseconds
+#define FLASH_HOST_PAGE_ERASE_US        85000
+#define FLASH_HOST_WORD_WRITE_US        41
+#define FLASH_HOST_QSPI_ERASE_US        45000
+#define FLASH_HOST_QSPI_PROGRAM_US      700
+
+typedef struct
+{
+  uint32_t page_erases;
+  uint32_t words_written;
+  uint32_t qspi_sector_erases;
+  uint32_t qspi_page_programs;   // 256-byte program commands
+  uint32_t bytes_rewritten;      // programmed more than once in the session e.g blocks out of order
+  uint64_t flash_us;
+} flash_host_stats_t;
+
+// Map erased flash with S140 6.1.1 (app at 0x26000) recorded in the SoftDevice info struct.
+// False if the host does not allow mapping low addresses (vm.mmap_min_addr above 0x1000)
+bool flash_host_init (void);
+
+// Device contents before the update, nothing is counted
+void flash_host_load (uint32_t addr, void const* data, uint32_t len);
+
+// Bit 0 of the internal flash byte at addr can no longer be programmed, 0 clears the fault
+void flash_host_stuck_bit (uint32_t addr);
+
+flash_host_stats_t const* flash_host_stats (void);
+
+// Last status given to bootloader_dfu_update_process(), -1 if none
+int flash_host_update_status (void);
+
+#endif /* FLASH_HOST_H_ */
@@ -0,0 +1,260 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* Replay a UF2 file through the bootloader's write path (write_block() in ghostfat.c and
+ * src/flash_nrf5x.c) built for the host, with NVMC and QSPI counted and timed by flash_host.c.
+ *
+ *   flashsim app.uf2                    flash app.uf2 onto blank flash
+ *   flashsim app.uf2 --base old.bin     flash onto a device holding old.bin, unchanged pages are skipped
+ *   flashsim app.uf2 --shuffle 1        host writes the blocks in a (seeded) random order
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "boards.h"
+#include "flash_nrf5x.h"
+#include "uf2.h"
+#include "flash_host.h"
+
+// skipped by ctest, see SKIP_RETURN_CODE
+#define EXIT_SKIP   77
+
+int write_block (uint32_t block_no, uint8_t *data, WriteState *state);
+
+static WriteState _wr_state;
+
+typedef struct
+{
+  uint32_t sectors;
+  uint32_t blocks;
+  uint32_t compressed_blocks;
+  uint32_t image_bytes;
+} replay_stats_t;
+
+static uint8_t* read_file (char const* path, uint32_t* len)
+{
+  FILE* f = fopen(path, "rb");
+  if ( !f ) return NULL;
+
+  fseek(f, 0, SEEK_END);
+  long const size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  uint8_t* buf = malloc(size ? size : 1);
+  if ( buf && (fread(buf, 1, size, f) != (size_t) size) )
+  {
+    free(buf);
+    buf = NULL;
+  }
+  fclose(f);
+
+  *len = (uint32_t) size;
+  return buf;
+}
+
+// xorshift32, same order for the same seed on every host
+static uint32_t rand_next (uint32_t* s)
+{
+  *s ^= *s << 13;
+  *s ^= *s >> 17;
+  *s ^= *s << 5;
+  return *s;
+}
+
+static void shuffle (uint32_t* order, uint32_t count, uint32_t seed)
+{
+  uint32_t s = seed ? seed : 1;
+  for ( uint32_t i = count - 1; i > 0; i-- )
+  {
+    uint32_t const j = rand_next(&s) % (i + 1);
+    uint32_t const tmp = order[i];
+    order[i] = order[j];
+    order[j] = tmp;
+  }
+}
+
+static void count_block (UF2_Block const* bl, uint8_t* seen, replay_stats_t* st)
+{
+  if ( (bl->magicStart0 != UF2_MAGIC_START0) || (bl->magicStart1 != UF2_MAGIC_START1) ) return;
+  if ( bl->flags & UF2_FLAG_NOFLASH ) return;
+  if ( bl->blockNo >= MAX_BLOCKS || (seen[bl->blockNo / 8] & (1 << (bl->blockNo % 8))) ) return;
+
+  seen[bl->blockNo / 8] |= (uint8_t) (1 << (bl->blockNo % 8));
+  st->blocks++;
+
+  if ( bl->flags & UF2_FLAG_COMPRESSED )
+  {
+    uint32_t raw_len;
+    memcpy(&raw_len, bl->data, 4);
+
+    st->compressed_blocks++;
+    st->image_bytes += raw_len;
+  }
+  else
+  {
+    st->image_bytes += bl->payloadSize;
+  }
+}
+
+static char const* session_result (WriteState const* state)
+{
+  if ( state->aborted ) return "aborted";
+  if ( state->numBlocks && (state->numWritten >= state->numBlocks) ) return "complete";
+  return "incomplete";
+}
+
+static void usage (char const* prog)
+{
+  fprintf(stderr, "usage: %s input.uf2 [--base file] [--base-addr addr] [--shuffle seed] [--usb-kbps n] [--json]\n", prog);
+}
+
+int main (int argc, char* argv[])
+{
+  char const* input     = NULL;
+  char const* base_path = NULL;
+  uint32_t base_addr    = 0;
+  uint32_t usb_kbps     = 600;   // host to MSC write throughput in KB/s
+  uint32_t seed         = 0;
+  bool do_shuffle       = false;
+  bool json             = false;
+
+  for ( int i = 1; i < argc; i++ )
+  {
+    bool const has_value = (i + 1 < argc);
+
+    if      ( !strcmp(argv[i], "--base")      && has_value ) base_path = argv[++i];
+    else if ( !strcmp(argv[i], "--base-addr") && has_value ) base_addr = strtoul(argv[++i], NULL, 0);
+    else if ( !strcmp(argv[i], "--usb-kbps")  && has_value ) usb_kbps  = strtoul(argv[++i], NULL, 0);
+    else if ( !strcmp(argv[i], "--shuffle")   && has_value ) { seed = strtoul(argv[++i], NULL, 0); do_shuffle = true; }
+    else if ( !strcmp(argv[i], "--json") ) json = true;
+    else if ( argv[i][0] != '-' && !input ) input = argv[i];
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if ( !input || !usb_kbps )
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  if ( !flash_host_init() )
+  {
+    fprintf(stderr, "cannot map flash at its device address, check vm.mmap_min_addr\n");
+    return EXIT_SKIP;
+  }
+
+  uint32_t uf2_len;
+  uint8_t* uf2 = read_file(input, &uf2_len);
+  if ( !uf2 )
+  {
+    fprintf(stderr, "cannot read %s\n", input);
+    return 1;
+  }
+
+  if ( base_path )
+  {
+    uint32_t base_len;
+    uint8_t* base = read_file(base_path, &base_len);
+    if ( !base )
+    {
+      fprintf(stderr, "cannot read %s\n", base_path);
+      return 1;
+    }
+
+    flash_host_load(base_addr, base, base_len);
+    free(base);
+  }
+
+  uint32_t const count = uf2_len / 512;
+  uint32_t* order = malloc((count ? count : 1) * sizeof(uint32_t));
+  for ( uint32_t i = 0; i < count; i++ ) order[i] = i;
+  if ( do_shuffle && count ) shuffle(order, count, seed);
+
+  static uint8_t seen[MAX_BLOCKS / 8 + 1];
+  replay_stats_t st = { 0 };
+  uint8_t sector[512];
+
+  // file is placed at the start of the data region, block number only matters for non-uf2 sectors
+  for ( uint32_t i = 0; i < count; i++ )
+  {
+    // write_block() may rewrite the block header, keep the file intact
+    memcpy(sector, uf2 + 512 * order[i], 512);
+
+    count_block((UF2_Block const*) sector, seen, &st);
+    write_block(order[i], sector, &_wr_state);
+    st.sectors++;
+  }
+
+  free(order);
+  free(uf2);
+
+  flash_nrf5x_stats_t const* fs = flash_nrf5x_get_stats();
+  flash_host_stats_t const* hs = flash_host_stats();
+
+  uint64_t const transfer_us = (uint64_t) st.sectors * 512 * 1000000 / (usb_kbps * 1024);
+  uint64_t const transfer_ms = transfer_us / 1000;
+  uint64_t const flash_ms    = hs->flash_us / 1000;
+  uint64_t const total_ms    = (transfer_us + hs->flash_us) / 1000;
+
+  if ( json )
+  {
+    printf("{\n");
+    printf("  \"result\": \"%s\",\n", session_result(&_wr_state));
+    printf("  \"blocks\": %u,\n", st.blocks);
+    printf("  \"compressed_blocks\": %u,\n", st.compressed_blocks);
+    printf("  \"image_bytes\": %u,\n", st.image_bytes);
+    printf("  \"sectors\": %u,\n", st.sectors);
+    printf("  \"pages_written\": %u,\n", fs->pages_written);
+    printf("  \"pages_skipped\": %u,\n", fs->pages_skipped);
+    printf("  \"page_erases\": %u,\n", hs->page_erases);
+    printf("  \"words_written\": %u,\n", hs->words_written);
+    printf("  \"qspi_sector_erases\": %u,\n", hs->qspi_sector_erases);
+    printf("  \"qspi_page_programs\": %u,\n", hs->qspi_page_programs);
+    printf("  \"bytes_rewritten\": %u,\n", hs->bytes_rewritten);
+    printf("  \"transfer_ms\": %llu,\n", (unsigned long long) transfer_ms);
+    printf("  \"flash_ms\": %llu,\n", (unsigned long long) flash_ms);
+    printf("  \"total_ms\": %llu\n", (unsigned long long) total_ms);
+    printf("}\n");
+  }
+  else
+  {
+    printf("result        : %s\n", session_result(&_wr_state));
+    printf("blocks        : %u (%u compressed), %u image bytes\n", st.blocks, st.compressed_blocks, st.image_bytes);
+    printf("internal flash: %u pages written, %u unchanged pages skipped, %u erases, %u words\n",
+           fs->pages_written, fs->pages_skipped, hs->page_erases, hs->words_written);
+    printf("qspi          : %u sector erases, %u page programs\n", hs->qspi_sector_erases, hs->qspi_page_programs);
+    printf("rewritten     : %u bytes programmed more than once\n", hs->bytes_rewritten);
+    printf("time          : %llu ms transfer + %llu ms flash = %llu ms (%.1f KB/s of image)\n",
+           (unsigned long long) transfer_ms, (unsigned long long) flash_ms, (unsigned long long) total_ms,
+           total_ms ? st.image_bytes / 1024.0 * 1000 / total_ms : 0);
+  }
+
+  return _wr_state.aborted ? 1 : 0;
+}
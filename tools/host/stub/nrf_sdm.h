@@ -0,0 +1,38 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef NRF_SDM_H
+#define NRF_SDM_H
+
+#include <stdint.h>
+
+// layout of the SoftDevice info struct, see SoftDevice API nrf_sdm.h
+#define MBR_SIZE                        0x1000
+#define SOFTDEVICE_INFO_STRUCT_OFFSET   0x2000
+#define SOFTDEVICE_INFO_STRUCT_ADDRESS  (SOFTDEVICE_INFO_STRUCT_OFFSET + MBR_SIZE)
+#define SD_SIZE_GET(baseaddr)           (*((uint32_t *) ((baseaddr) + SOFTDEVICE_INFO_STRUCT_OFFSET + 0x08)))
+#define SD_ID_GET(baseaddr)             (*((uint32_t *) ((baseaddr) + SOFTDEVICE_INFO_STRUCT_OFFSET + 0x10)) & 0xFFFF)
+#define SD_VERSION_GET(baseaddr)        (*((uint32_t *) ((baseaddr) + SOFTDEVICE_INFO_STRUCT_OFFSET + 0x14)))
+
+#endif
@@ -0,0 +1,152 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Ed25519 verification of src/ed25519.c against RFC 8032 section 7.1 vectors, plus signatures
+// that must be refused: non-canonical S, keys and R that are not curve points, tampered data.
+// Run with --bench for verification time.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ed25519.h"
+
+typedef struct
+{
+  char const* name;
+  char const* public_key;
+  char const* msg;
+  char const* signature;
+  bool valid;
+} ed25519_vector_t;
+
+#define TEST1_KEY   "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a"
+#define TEST1_SIG   "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e065224901555fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b"
+#define TEST1_R     "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e06522490155"
+
+// SHA-512 of "abc"
+#define SHA_ABC     "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f"
+
+static ed25519_vector_t const _vectors[] =
+{
+  // RFC 8032 7.1
+  { "TEST 1", TEST1_KEY, "", TEST1_SIG, true },
+  { "TEST 2", "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c", "72",
+    "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00", true },
+  { "TEST 3", "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025", "af82",
+    "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a", true },
+  { "TEST SHA(abc)", "ec172b93ad5e563bf4932c70e1245034c35467ef2efd4d64ebf819683467e2bf", SHA_ABC,
+    "dc2a4459e7369633a52b1bf277839a00201009a3efbf3ecb69bea2186c26b58909351fc9ac90b3ecfdfbc7c66431e0303dca179c138ac17ad9bef1177331a704", true },
+
+  // S + L verifies mathematically, must be refused as non-canonical
+  { "S + L", TEST1_KEY, "",
+    TEST1_R "4c8c7872aa064e049dbb3013fbf29380d25bf5f0595bbe24655141438e7a101b", false },
+  { "S = L", TEST1_KEY, "",
+    TEST1_R "edd3f55c1a631258d69cf7a2def9de1400000000000000000000000000000010", false },
+
+  // y = 2 has no x on the curve
+  { "key off curve", "0200000000000000000000000000000000000000000000000000000000000000", "", TEST1_SIG, false },
+  { "R off curve", TEST1_KEY, "",
+    "0200000000000000000000000000000000000000000000000000000000000000" "5fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b", false },
+  // y = p is the non-canonical encoding of y = 0
+  { "key y >= p", "edffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f", "", TEST1_SIG, false },
+  // x = 0 with sign bit set
+  { "key -0", "0100000000000000000000000000000000000000000000000000000000000080", "", TEST1_SIG, false },
+
+  // tampered data
+  { "message", TEST1_KEY, "00", TEST1_SIG, false },
+  { "R bit", TEST1_KEY, "",
+    "e4564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e065224901555fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b", false },
+  { "S bit", TEST1_KEY, "",
+    TEST1_R "5eb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b", false },
+};
+
+static uint32_t hex_decode (char const* hex, uint8_t* out, uint32_t max)
+{
+  uint32_t len = strlen(hex) / 2;
+  if ( len > max ) len = max;
+
+  for ( uint32_t i = 0; i < len; i++ )
+  {
+    unsigned v;
+    sscanf(hex + 2*i, "%02x", &v);
+    out[i] = (uint8_t) v;
+  }
+
+  return len;
+}
+
+static bool check_vector (ed25519_vector_t const* v)
+{
+  uint8_t key[ED25519_PUBLIC_KEY_SIZE];
+  uint8_t sig[ED25519_SIGNATURE_SIZE];
+  uint8_t msg[64];
+
+  hex_decode(v->public_key, key, sizeof(key));
+  hex_decode(v->signature, sig, sizeof(sig));
+  uint32_t const len = hex_decode(v->msg, msg, sizeof(msg));
+
+  bool const ok = (ed25519_verify(sig, msg, len, key) == v->valid);
+
+  printf("%s ed25519 %s (%s)\n", ok ? "PASS" : "FAIL", v->name, v->valid ? "accept" : "refuse");
+  return ok;
+}
+
+// Bootloader verifies a signature over the image digest, a short message: time is in the point math
+static void bench (void)
+{
+  ed25519_vector_t const* v = &_vectors[3];
+  uint32_t const rounds = 200;
+  uint8_t key[ED25519_PUBLIC_KEY_SIZE];
+  uint8_t sig[ED25519_SIGNATURE_SIZE];
+  uint8_t msg[64];
+
+  hex_decode(v->public_key, key, sizeof(key));
+  hex_decode(v->signature, sig, sizeof(sig));
+  uint32_t const len = hex_decode(v->msg, msg, sizeof(msg));
+
+  clock_t const start = clock();
+  for ( uint32_t r = 0; r < rounds; r++ )
+  {
+    if ( !ed25519_verify(sig, msg, len, key) ) exit(1);
+  }
+  double const secs = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+  printf("ed25519: %.3f ms per verify (%u in %.3f s)\n", 1000 * secs / rounds, rounds, secs);
+}
+
+int main (int argc, char const* argv[])
+{
+  bool ok = true;
+
+  for ( uint32_t i = 0; i < sizeof(_vectors)/sizeof(_vectors[0]); i++ )
+  {
+    ok = check_vector(&_vectors[i]) && ok;
+  }
+
+  if ( argc > 1 && !strcmp(argv[1], "--bench") ) bench();
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// UF2 write path (ghostfat.c write_block() and flash_nrf5x.c) on host flash: blocks in order,
+// reversed and shuffled must leave the image in flash, a rewrite of the same image must not
+// erase any page and an oversized file must be refused before anything is written. A page that
+// fails to verify aborts the session.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "boards.h"
+#include "flash_nrf5x.h"
+#include "uf2.h"
+#include "flash_host.h"
+
+#define APP_ADDR      0x26000
+#define APP_SIZE      (40*1024 + 128)   // last page partly used
+#define APP_BLOCKS    ((APP_SIZE + 255) / 256)
+
+int write_block (uint32_t block_no, uint8_t *data, WriteState *state);
+
+static WriteState _wr_state;
+static uint8_t _image[APP_BLOCKS * 256];
+
+static void make_block (uint8_t* sector, uint32_t block_no, uint32_t num_blocks)
+{
+  UF2_Block* bl = (UF2_Block*) sector;
+
+  memset(sector, 0, 512);
+  bl->magicStart0 = UF2_MAGIC_START0;
+  bl->magicStart1 = UF2_MAGIC_START1;
+  bl->magicEnd    = UF2_MAGIC_END;
+  bl->flags       = UF2_FLAG_FAMILYID;
+  bl->targetAddr  = APP_ADDR + block_no * 256;
+  bl->payloadSize = 256;
+  bl->blockNo     = block_no;
+  bl->numBlocks   = num_blocks;
+  bl->familyID    = CFG_UF2_FAMILY_APP_ID;
+  memcpy(bl->data, _image + block_no * 256, 256);
+}
+
+// Write the image as one session in the given block order
+static void write_image (uint32_t const* order)
+{
+  uint8_t sector[512];
+
+  memset(&_wr_state, 0, sizeof(_wr_state));
+  for ( uint32_t i = 0; i < APP_BLOCKS; i++ )
+  {
+    make_block(sector, order[i], APP_BLOCKS);
+    write_block(order[i], sector, &_wr_state);
+  }
+}
+
+static bool check (char const* name, bool ok)
+{
+  printf("%s %s\n", ok ? "PASS" : "FAIL", name);
+  return ok;
+}
+
+static bool session_complete (void)
+{
+  return !_wr_state.aborted && (_wr_state.numWritten == APP_BLOCKS) && (_wr_state.numBlocks == APP_BLOCKS);
+}
+
+static bool image_in_flash (void)
+{
+  return 0 == memcmp((void const*) (uintptr_t) APP_ADDR, _image, APP_SIZE);
+}
+
+int main (void)
+{
+  bool ok = true;
+  uint32_t order[APP_BLOCKS];
+
+  if ( !flash_host_init() )
+  {
+    printf("SKIP cannot map flash at its device address\n");
+    return 77;
+  }
+
+  flash_nrf5x_stats_t const* fs = flash_nrf5x_get_stats();
+  flash_host_stats_t const* hs = flash_host_stats();
+
+  for ( uint32_t i = 0; i < APP_SIZE; i++ ) _image[i] = (uint8_t) (i * 13 + (i >> 8));
+
+  // in order
+  for ( uint32_t i = 0; i < APP_BLOCKS; i++ ) order[i] = i;
+  write_image(order);
+  ok = check("in order", session_complete() && image_in_flash() && (hs->page_erases == 11) && !hs->bytes_rewritten) && ok;
+
+  // same image again, reversed: every page already matches
+  uint32_t const erases = hs->page_erases;
+  uint32_t const skipped = fs->pages_skipped;
+  for ( uint32_t i = 0; i < APP_BLOCKS; i++ ) order[i] = APP_BLOCKS - 1 - i;
+  write_image(order);
+  ok = check("unchanged image", session_complete() && image_in_flash() &&
+             (hs->page_erases == erases) && (fs->pages_skipped - skipped == 11)) && ok;
+
+  // new image, shuffled
+  for ( uint32_t i = 0; i < APP_SIZE; i++ ) _image[i] ^= 0x5a;
+  for ( uint32_t i = APP_BLOCKS - 1; i > 0; i-- )
+  {
+    uint32_t const j = (i * 2654435761u) % (i + 1);
+    uint32_t const tmp = order[i];
+    order[i] = order[j];
+    order[j] = tmp;
+  }
+  write_image(order);
+  ok = check("shuffled", session_complete() && image_in_flash()) && ok;
+
+  // file larger than the write state can track
+  uint8_t sector[512];
+  uint32_t const words = hs->words_written;
+  memset(&_wr_state, 0, sizeof(_wr_state));
+  make_block(sector, 0, MAX_BLOCKS);
+  sector[32] ^= 0xff;
+  write_block(0, sector, &_wr_state);
+  flash_nrf5x_flush(true);
+  ok = check("oversized file", _wr_state.aborted && (hs->words_written == words) && image_in_flash()) && ok;
+
+  // bit stuck at 1 where the new image has it cleared
+  uint32_t const failures = fs->verify_failures;
+  for ( uint32_t i = 0; i < APP_SIZE; i++ ) _image[i] ^= 0xa5;
+  _image[5000] &= 0xfe;
+  flash_host_stuck_bit(APP_ADDR + 5000);
+  for ( uint32_t i = 0; i < APP_BLOCKS; i++ ) order[i] = i;
+  write_image(order);
+  flash_host_stuck_bit(0);
+  ok = check("verify failure", _wr_state.aborted && (fs->verify_failures == failures + 1)) && ok;
+
+  return ok ? 0 : 1;
+}
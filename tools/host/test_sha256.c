@@ -0,0 +1,149 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// SHA-256 of src/sha256.c against FIPS 180-4 / NIST CAVP vectors, streamed in every split the
+// uf2 write path can produce. Run with --bench for throughput.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sha256.h"
+
+typedef struct
+{
+  char const* msg;
+  uint32_t repeat;
+  char const* digest;
+} sha256_vector_t;
+
+static sha256_vector_t const _vectors[] =
+{
+  { "", 1,
+    "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+  { "abc", 1,
+    "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+  { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+    "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+  { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 1,
+    "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1" },
+  { "a", 1000000,
+    "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" },
+  // 64-byte message, padding spills into a second block
+  { "0123456701234567012345670123456701234567012345670123456701234567", 1,
+    "8182cadb21af0e37c06414ece08e19c65bdb22c396d48ba7341012eea9ffdfdd" },
+};
+
+static void hex_decode (char const* hex, uint8_t* out, uint32_t len)
+{
+  for ( uint32_t i = 0; i < len; i++ )
+  {
+    unsigned v;
+    sscanf(hex + 2*i, "%02x", &v);
+    out[i] = (uint8_t) v;
+  }
+}
+
+// Message of a vector, repeat times concatenated
+static uint8_t* vector_message (sha256_vector_t const* v, uint32_t* len)
+{
+  uint32_t const msg_len = strlen(v->msg);
+
+  *len = msg_len * v->repeat;
+  uint8_t* buf = malloc(*len + 1);
+
+  for ( uint32_t i = 0; i < v->repeat; i++ ) memcpy(buf + i*msg_len, v->msg, msg_len);
+
+  return buf;
+}
+
+static bool check_vector (sha256_vector_t const* v)
+{
+  uint8_t expected[SHA256_DIGEST_SIZE];
+  uint8_t digest[SHA256_DIGEST_SIZE];
+  uint32_t len;
+  uint8_t* msg = vector_message(v, &len);
+  bool ok = true;
+
+  hex_decode(v->digest, expected, sizeof(expected));
+
+  sha256_compute(msg, len, digest);
+  ok = ok && sha256_equal(digest, expected);
+
+  // streamed in chunks: odd sizes, one block, and the 256 byte uf2 payload
+  static uint32_t const chunks[] = { 1, 3, 63, 64, 65, 256, 476 };
+
+  for ( uint32_t c = 0; c < sizeof(chunks)/sizeof(chunks[0]); c++ )
+  {
+    sha256_t sha;
+    sha256_init(&sha);
+
+    for ( uint32_t offset = 0; offset < len; offset += chunks[c] )
+    {
+      uint32_t const count = (len - offset < chunks[c]) ? (len - offset) : chunks[c];
+      sha256_update(&sha, msg + offset, count);
+    }
+
+    sha256_final(&sha, digest);
+    ok = ok && sha256_equal(digest, expected);
+  }
+
+  free(msg);
+
+  printf("%s sha256 \"%.16s\" x%u\n", ok ? "PASS" : "FAIL", v->msg, v->repeat);
+  return ok;
+}
+
+// Throughput over a buffer the size of a full nRF52840 app region
+static void bench (void)
+{
+  uint32_t const len = 1024 * 1024;
+  uint32_t const rounds = 64;
+  uint8_t* buf = malloc(len);
+  uint8_t digest[SHA256_DIGEST_SIZE];
+
+  for ( uint32_t i = 0; i < len; i++ ) buf[i] = (uint8_t) (i * 7);
+
+  clock_t const start = clock();
+  for ( uint32_t r = 0; r < rounds; r++ ) sha256_compute(buf, len, digest);
+  double const secs = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+  printf("sha256: %.1f MB/s (%u MB in %.3f s)\n", rounds / secs, rounds, secs);
+  free(buf);
+}
+
+int main (int argc, char const* argv[])
+{
+  bool ok = true;
+
+  for ( uint32_t i = 0; i < sizeof(_vectors)/sizeof(_vectors[0]); i++ )
+  {
+    ok = check_vector(&_vectors[i]) && ok;
+  }
+
+  if ( argc > 1 && !strcmp(argv[1], "--bench") ) bench();
+
+  return ok ? 0 : 1;
+}
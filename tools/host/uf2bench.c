@@ -0,0 +1,637 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Adafruit Industries
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/* UF2 drag-and-drop benchmark: replay host WRITE10 traces through tud_msc_write10_cb() of
+ * src/usb/msc_uf2.c built for the host, with flash counted and timed by flash_host.c.
+ *
+ *   uf2bench                               run all scenarios, compare against uf2bench_baseline.txt
+ *   uf2bench --update                      run and store results as the new baseline
+ *   uf2bench --dump-trace DIR              write the synthetic traces, e.g to compare with captured ones
+ *   uf2bench --trace t.txt app.uf2 [--base old.bin]   replay a captured trace of copying app.uf2
+ *
+ * Trace lines are "<lba> <sector count> <first uf2 file sector | ->", "-" being FAT/directory or
+ * other metadata. Captured traces (e.g usbmon, Wireshark) are converted into this form by resolving
+ * which file sector each LBA holds.
+ *
+ * Synthetic traces model what each host is known to do rather than byte exact recordings:
+ *   linux    data in order in 120 KB requests, FAT/directory only written at sync (after the data)
+ *   windows  directory entry first, data in order in 64 KB requests, FAT updated every 1 MB
+ *   macos    metadata files first, 64 KB requests with neighbouring requests swapped, and the
+ *            start of the file written a second time halfway through
+ * Each request is handed to msc_uf2.c in CFG_TUD_MSC_BUFSIZE chunks with the scheduler run in
+ * between, as tud_task() does. Replay stops once the bootloader ends the session (it resets).
+ * A metric higher than baseline is reported as a regression and exits with status 1.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "boards.h"
+#include "tusb.h"
+#include "app_scheduler.h"
+#include "flash_nrf5x.h"
+#include "uf2.h"
+#include "flash_host.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+#define APP_START   0x26000     // after S140 6.1.1
+#define FILE_LBA    1024        // first cluster of the copied file, anywhere in the data region
+#define EXIT_SKIP   77          // skipped by ctest, see SKIP_RETURN_CODE
+
+#define USB_KBPS    600         // host to MSC write throughput in KB/s
+
+typedef struct
+{
+  uint32_t lba;
+  uint32_t count;
+  int32_t  file_sector;         // -1 for metadata
+} trace_req_t;
+
+typedef struct
+{
+  trace_req_t* reqs;
+  uint32_t count;
+} trace_t;
+
+typedef struct
+{
+  uint32_t total_ms;
+  uint32_t page_erases;
+  uint32_t pages_written;
+  uint32_t qspi_sector_erases;
+  uint32_t qspi_page_programs;
+  uint32_t bytes_rewritten;
+} bench_result_t;
+
+#define METRIC_COUNT  (sizeof(bench_result_t) / sizeof(uint32_t))
+
+static char const* const _metric_names[METRIC_COUNT] =
+{
+  "total_ms", "page_erases", "pages_written", "qspi_sector_erases", "qspi_page_programs", "bytes_rewritten"
+};
+
+typedef struct
+{
+  uint8_t* data;
+  uint32_t len;
+} buf_t;
+
+//--------------------------------------------------------------------+
+// Images and traces
+//--------------------------------------------------------------------+
+
+// xorshift32, same images on every host
+static uint32_t rand_next (uint32_t* s)
+{
+  *s ^= *s << 13;
+  *s ^= *s >> 17;
+  *s ^= *s << 5;
+  return *s;
+}
+
+// Firmware-like data: random code interleaved with compressible runs
+static void image (uint8_t* out, uint32_t size, uint32_t seed)
+{
+  uint32_t s = seed * 2654435761u + 1;
+
+  for ( uint32_t pos = 0; pos < size; )
+  {
+    if ( rand_next(&s) % 10 < 3 )
+    {
+      uint8_t const value = (uint8_t) rand_next(&s);
+      for ( uint32_t n = 8 + rand_next(&s) % 56; n && pos < size; n-- ) out[pos++] = value;
+    }
+    else
+    {
+      for ( uint32_t n = 16 + rand_next(&s) % 112; n && pos < size; n-- ) out[pos++] = (uint8_t) rand_next(&s);
+    }
+  }
+}
+
+typedef struct
+{
+  uint32_t addr;
+  uint8_t const* data;
+  uint32_t len;
+} region_t;
+
+static buf_t make_uf2 (region_t const* regions, uint32_t count)
+{
+  uint32_t num_blocks = 0;
+  for ( uint32_t r = 0; r < count; r++ ) num_blocks += (regions[r].len + 255) / 256;
+
+  buf_t uf2 = { calloc(num_blocks, 512), num_blocks * 512 };
+  uint32_t block_no = 0;
+
+  for ( uint32_t r = 0; r < count; r++ )
+  {
+    for ( uint32_t pos = 0; pos < regions[r].len; pos += 256 )
+    {
+      UF2_Block* bl = (UF2_Block*) (uf2.data + 512 * block_no);
+      uint32_t const len = (regions[r].len - pos < 256) ? (regions[r].len - pos) : 256;
+
+      bl->magicStart0 = UF2_MAGIC_START0;
+      bl->magicStart1 = UF2_MAGIC_START1;
+      bl->magicEnd    = UF2_MAGIC_END;
+      bl->flags       = UF2_FLAG_FAMILYID;
+      bl->targetAddr  = regions[r].addr + pos;
+      bl->payloadSize = 256;
+      bl->blockNo     = block_no++;
+      bl->numBlocks   = num_blocks;
+      bl->familyID    = CFG_UF2_FAMILY_APP_ID;
+      memcpy(bl->data, regions[r].data + pos, len);
+    }
+  }
+
+  return uf2;
+}
+
+static void trace_add (trace_t* t, uint32_t lba, uint32_t count, int32_t file_sector)
+{
+  t->reqs = realloc(t->reqs, (t->count + 1) * sizeof(trace_req_t));
+  t->reqs[t->count++] = (trace_req_t) { lba, count, file_sector };
+}
+
+static void trace_data (trace_t* t, uint32_t first, uint32_t last, uint32_t nsectors, uint32_t per_request)
+{
+  for ( uint32_t r = first; r < last; r++ )
+  {
+    uint32_t const s = r * per_request;
+    trace_add(t, FILE_LBA + s, (nsectors - s < per_request) ? (nsectors - s) : per_request, (int32_t) s);
+  }
+}
+
+static uint32_t request_count (uint32_t nsectors, uint32_t per_request)
+{
+  return (nsectors + per_request - 1) / per_request;
+}
+
+static trace_t trace_linux (uint32_t nsectors)
+{
+  trace_t t = { 0 };
+  trace_data(&t, 0, request_count(nsectors, 240), nsectors, 240);
+  trace_add(&t, 1, 2, -1);
+  trace_add(&t, 259, 2, -1);
+  trace_add(&t, 517, 1, -1);
+  return t;
+}
+
+static trace_t trace_windows (uint32_t nsectors)
+{
+  trace_t t = { 0 };
+  uint32_t const reqs = request_count(nsectors, 128);
+
+  trace_add(&t, 517, 1, -1);
+  for ( uint32_t r = 0; r < reqs; r++ )
+  {
+    trace_data(&t, r, r + 1, nsectors, 128);
+    if ( (r + 1) % 16 == 0 )
+    {
+      trace_add(&t, 1, 1, -1);
+      trace_add(&t, 259, 1, -1);
+    }
+  }
+  trace_add(&t, 1, 1, -1);
+  trace_add(&t, 259, 1, -1);
+  trace_add(&t, 517, 1, -1);
+  return t;
+}
+
+static trace_t trace_macos (uint32_t nsectors)
+{
+  trace_t t = { 0 };
+  uint32_t const reqs = request_count(nsectors, 128);
+
+  trace_add(&t, 517, 1, -1);
+  trace_add(&t, FILE_LBA - 8, 8, -1);
+  trace_add(&t, FILE_LBA - 16, 8, -1);
+
+  // neighbouring requests swapped, start of the file written again halfway through
+  uint32_t const half = reqs / 2;
+  for ( uint32_t r = 0; r < reqs; r++ )
+  {
+    uint32_t const swapped = ((r ^ 1) < reqs && (r | 1) < reqs) ? (r ^ 1) : r;
+
+    if ( r == half ) trace_data(&t, (1 < reqs) ? 1 : 0, (1 < reqs) ? 2 : 1, nsectors, 128);
+    trace_data(&t, swapped, swapped + 1, nsectors, 128);
+  }
+  trace_add(&t, 1, 2, -1);
+  trace_add(&t, 259, 2, -1);
+  return t;
+}
+
+typedef struct
+{
+  char const* name;
+  trace_t (*make) (uint32_t nsectors);
+} host_t;
+
+static host_t const _hosts[] =
+{
+  { "linux"  , trace_linux   },
+  { "windows", trace_windows },
+  { "macos"  , trace_macos   },
+};
+
+static bool trace_load (char const* path, trace_t* t)
+{
+  FILE* f = fopen(path, "r");
+  if ( !f ) return false;
+
+  char line[128];
+  while ( fgets(line, sizeof(line), f) )
+  {
+    char* hash = strchr(line, '#');
+    if ( hash ) *hash = 0;
+
+    char sector[16];
+    unsigned long lba, count;
+    if ( sscanf(line, "%li %li %15s", (long*) &lba, (long*) &count, sector) != 3 ) continue;
+
+    trace_add(t, lba, count, strcmp(sector, "-") ? (int32_t) strtol(sector, NULL, 0) : -1);
+  }
+
+  fclose(f);
+  return true;
+}
+
+static bool trace_dump (char const* path, trace_t const* t)
+{
+  FILE* f = fopen(path, "w");
+  if ( !f ) return false;
+
+  for ( uint32_t i = 0; i < t->count; i++ )
+  {
+    if ( t->reqs[i].file_sector < 0 ) fprintf(f, "%u %u -\n", t->reqs[i].lba, t->reqs[i].count);
+    else                              fprintf(f, "%u %u %d\n", t->reqs[i].lba, t->reqs[i].count, t->reqs[i].file_sector);
+  }
+
+  fclose(f);
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Replay
+//--------------------------------------------------------------------+
+
+// Runs in a child process: msc_uf2.c and flash_nrf5x.c keep session state in statics, every
+// replay starts from a freshly booted bootloader.
+static int replay_child (buf_t const* uf2, trace_t const* trace, buf_t const* base, bench_result_t* res)
+{
+  if ( !flash_host_init() ) return EXIT_SKIP;
+  if ( base ) flash_host_load(APP_START, base->data, base->len);
+
+  static uint8_t chunk[CFG_TUD_MSC_BUFSIZE];
+  uint32_t const chunk_sectors = CFG_TUD_MSC_BUFSIZE / 512;
+  uint32_t sectors = 0;
+
+  for ( uint32_t i = 0; (i < trace->count) && (flash_host_update_status() < 0); i++ )
+  {
+    trace_req_t const* req = &trace->reqs[i];
+
+    for ( uint32_t done = 0; done < req->count; done += chunk_sectors )
+    {
+      uint32_t const n = (req->count - done < chunk_sectors) ? (req->count - done) : chunk_sectors;
+
+      memset(chunk, 0, sizeof(chunk));
+      for ( uint32_t s = 0; (s < n) && (req->file_sector >= 0); s++ )
+      {
+        uint32_t const file_sector = (uint32_t) req->file_sector + done + s;
+        if ( (file_sector + 1) * 512 <= uf2->len ) memcpy(chunk + 512 * s, uf2->data + 512 * file_sector, 512);
+      }
+
+      tud_msc_write10_cb(0, req->lba + done, done * 512, chunk, n * 512);
+      app_sched_execute();
+      sectors += n;
+    }
+
+    tud_msc_write10_complete_cb(0);
+    app_sched_execute();
+  }
+
+  // session did not end, image is not (completely) in flash
+  if ( flash_host_update_status() < 0 ) return 1;
+
+  flash_nrf5x_stats_t const* fs = flash_nrf5x_get_stats();
+  flash_host_stats_t const* hs = flash_host_stats();
+  uint64_t const transfer_us = (uint64_t) sectors * 512 * 1000000 / (USB_KBPS * 1024);
+
+  res->total_ms           = (uint32_t) ((transfer_us + hs->flash_us) / 1000);
+  res->page_erases        = hs->page_erases;
+  res->pages_written      = fs->pages_written;
+  res->qspi_sector_erases = hs->qspi_sector_erases;
+  res->qspi_page_programs = hs->qspi_page_programs;
+  res->bytes_rewritten    = hs->bytes_rewritten;
+
+  return 0;
+}
+
+// 0 on success, otherwise exit status of the replay
+static int replay (buf_t const* uf2, trace_t const* trace, buf_t const* base, bench_result_t* res)
+{
+  int fds[2];
+  if ( pipe(fds) ) return 1;
+
+  fflush(stdout);
+  pid_t const pid = fork();
+  if ( pid < 0 ) return 1;
+
+  if ( pid == 0 )
+  {
+    close(fds[0]);
+
+    bench_result_t r = { 0 };
+    int const rc = replay_child(uf2, trace, base, &r);
+    if ( rc == 0 && write(fds[1], &r, sizeof(r)) != sizeof(r) ) _exit(1);
+    _exit(rc);
+  }
+
+  close(fds[1]);
+  ssize_t const count = read(fds[0], res, sizeof(*res));
+  close(fds[0]);
+
+  int status;
+  waitpid(pid, &status, 0);
+
+  if ( !WIFEXITED(status) ) return 1;
+  if ( WEXITSTATUS(status) ) return WEXITSTATUS(status);
+  return (count == sizeof(*res)) ? 0 : 1;
+}
+
+//--------------------------------------------------------------------+
+// Scenarios
+//--------------------------------------------------------------------+
+#define SCENARIO_COUNT  5
+
+typedef struct
+{
+  char const* name;
+  buf_t uf2;
+  buf_t base;             // device contents at APP_START before the update, if any
+} scenario_t;
+
+static void scenarios_make (scenario_t* sc)
+{
+  static uint8_t app_64k[64*1024], app_256k[256*1024], app_768k[768*1024], qspi_512k[512*1024];
+  static uint8_t app_256k_v2[256*1024];
+
+  image(app_64k, sizeof(app_64k), 1);
+  image(app_256k, sizeof(app_256k), 2);
+  image(app_768k, sizeof(app_768k), 3);
+  image(qspi_512k, sizeof(qspi_512k), 4);
+
+  // same app with a few small changes, device holds the previous version
+  memcpy(app_256k_v2, app_256k, sizeof(app_256k));
+  for ( uint32_t off = 0; off < sizeof(app_256k_v2); off += 64*1024 ) image(app_256k_v2 + off + 100, 64, off + 5);
+
+  sc[0] = (scenario_t) { "app64k"          , make_uf2((region_t[]) { { APP_START, app_64k, sizeof(app_64k) } }, 1), { 0 } };
+  sc[1] = (scenario_t) { "app256k"         , make_uf2((region_t[]) { { APP_START, app_256k, sizeof(app_256k) } }, 1), { 0 } };
+  sc[2] = (scenario_t) { "app768k"         , make_uf2((region_t[]) { { APP_START, app_768k, sizeof(app_768k) } }, 1), { 0 } };
+  sc[3] = (scenario_t) { "app256k+qspi512k", make_uf2((region_t[]) { { APP_START, app_256k, sizeof(app_256k) },
+                                                                     { QSPI_XIP_OFFSET, qspi_512k, sizeof(qspi_512k) } }, 2), { 0 } };
+  sc[4] = (scenario_t) { "app256k-update"  , make_uf2((region_t[]) { { APP_START, app_256k_v2, sizeof(app_256k_v2) } }, 1),
+                                             { app_256k, sizeof(app_256k) } };
+}
+
+//--------------------------------------------------------------------+
+// Baseline: one line "<scenario>/<host> <metric values in _metric_names order>" per run
+//--------------------------------------------------------------------+
+typedef struct
+{
+  char key[64];
+  uint32_t values[METRIC_COUNT];
+} baseline_entry_t;
+
+static uint32_t baseline_load (char const* path, baseline_entry_t* entries, uint32_t max)
+{
+  FILE* f = fopen(path, "r");
+  if ( !f ) return 0;
+
+  char line[256];
+  uint32_t n = 0;
+  while ( (n < max) && fgets(line, sizeof(line), f) )
+  {
+    baseline_entry_t* e = &entries[n];
+    uint32_t* v = e->values;
+
+    if ( line[0] == '#' ) continue;
+    if ( sscanf(line, "%63s %u %u %u %u %u %u", e->key, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) == 1 + METRIC_COUNT ) n++;
+  }
+
+  fclose(f);
+  return n;
+}
+
+static baseline_entry_t const* baseline_find (baseline_entry_t const* entries, uint32_t count, char const* key)
+{
+  for ( uint32_t i = 0; i < count; i++ )
+  {
+    if ( !strcmp(entries[i].key, key) ) return &entries[i];
+  }
+  return NULL;
+}
+
+static buf_t read_file (char const* path)
+{
+  buf_t buf = { 0 };
+  FILE* f = fopen(path, "rb");
+  if ( !f ) return buf;
+
+  fseek(f, 0, SEEK_END);
+  buf.len = (uint32_t) ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  buf.data = malloc(buf.len ? buf.len : 1);
+  if ( fread(buf.data, 1, buf.len, f) != buf.len )
+  {
+    free(buf.data);
+    buf.data = NULL;
+  }
+
+  fclose(f);
+  return buf;
+}
+
+static void print_result (char const* key, bench_result_t const* res)
+{
+  uint32_t const* v = (uint32_t const*) res;
+  printf("%-28s %9u %7u %7u %7u %7u %9u\n", key, v[0], v[1], v[2], v[3], v[4], v[5]);
+}
+
+static void usage (char const* prog)
+{
+  fprintf(stderr, "usage: %s [--baseline file] [--update] [--dump-trace dir]\n"
+                  "       %s --trace trace.txt app.uf2 [--base old.bin]\n", prog, prog);
+}
+
+int main (int argc, char* argv[])
+{
+  char const* baseline_path = UF2BENCH_BASELINE;
+  char const* dump_dir   = NULL;
+  char const* trace_path = NULL;
+  char const* uf2_path   = NULL;
+  char const* base_path  = NULL;
+  bool update = false;
+
+  for ( int i = 1; i < argc; i++ )
+  {
+    bool const has_value = (i + 1 < argc);
+
+    if      ( !strcmp(argv[i], "--baseline")   && has_value ) baseline_path = argv[++i];
+    else if ( !strcmp(argv[i], "--dump-trace") && has_value ) dump_dir = argv[++i];
+    else if ( !strcmp(argv[i], "--base")       && has_value ) base_path = argv[++i];
+    else if ( !strcmp(argv[i], "--trace")      && (i + 2 < argc) ) { trace_path = argv[++i]; uf2_path = argv[++i]; }
+    else if ( !strcmp(argv[i], "--update") ) update = true;
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  printf("%-28s %9s %7s %7s %7s %7s %9s\n", "scenario", "total ms", "erases", "pages", "q.erase", "q.prog", "rewritten");
+
+  // captured trace
+  if ( trace_path )
+  {
+    trace_t trace = { 0 };
+    buf_t const uf2 = read_file(uf2_path);
+    buf_t const base = base_path ? read_file(base_path) : (buf_t) { 0 };
+
+    if ( !trace_load(trace_path, &trace) || !uf2.data || (base_path && !base.data) )
+    {
+      fprintf(stderr, "cannot read %s, %s or %s\n", trace_path, uf2_path, base_path ? base_path : "-");
+      return 1;
+    }
+
+    bench_result_t res;
+    int const rc = replay(&uf2, &trace, base_path ? &base : NULL, &res);
+    if ( rc )
+    {
+      printf("%-28s %s\n", trace_path, (rc == EXIT_SKIP) ? "SKIP cannot map flash at its device address" : "FAILED, update did not complete");
+      return rc;
+    }
+
+    print_result(trace_path, &res);
+    return 0;
+  }
+
+  scenario_t sc[SCENARIO_COUNT];
+  scenarios_make(sc);
+
+  baseline_entry_t baseline[SCENARIO_COUNT * 3];
+  uint32_t const baseline_count = update ? 0 : baseline_load(baseline_path, baseline, SCENARIO_COUNT * 3);
+  if ( !update && !baseline_count ) fprintf(stderr, "no baseline in %s\n", baseline_path);
+
+  FILE* out = update ? fopen(baseline_path, "w") : NULL;
+  if ( update && !out )
+  {
+    fprintf(stderr, "cannot write %s\n", baseline_path);
+    return 1;
+  }
+  if ( out )
+  {
+    fprintf(out, "# scenario/host");
+    for ( uint32_t m = 0; m < METRIC_COUNT; m++ ) fprintf(out, " %s", _metric_names[m]);
+    fprintf(out, "\n");
+  }
+
+  uint32_t regressions = 0;
+
+  for ( uint32_t s = 0; s < SCENARIO_COUNT; s++ )
+  {
+    for ( uint32_t h = 0; h < sizeof(_hosts) / sizeof(_hosts[0]); h++ )
+    {
+      char key[64];
+      snprintf(key, sizeof(key), "%s/%s", sc[s].name, _hosts[h].name);
+
+      trace_t trace = _hosts[h].make(sc[s].uf2.len / 512);
+
+      if ( dump_dir )
+      {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s-%s.txt", dump_dir, sc[s].name, _hosts[h].name);
+        if ( !trace_dump(path, &trace) ) fprintf(stderr, "cannot write %s\n", path);
+      }
+
+      bench_result_t res;
+      int const rc = replay(&sc[s].uf2, &trace, sc[s].base.data ? &sc[s].base : NULL, &res);
+      free(trace.reqs);
+
+      if ( rc == EXIT_SKIP )
+      {
+        printf("SKIP cannot map flash at its device address\n");
+        return EXIT_SKIP;
+      }
+
+      if ( rc )
+      {
+        printf("%-28s FAILED, update did not complete\n", key);
+        regressions++;
+        continue;
+      }
+
+      print_result(key, &res);
+
+      if ( out )
+      {
+        uint32_t const* v = (uint32_t const*) &res;
+        fprintf(out, "%s %u %u %u %u %u %u\n", key, v[0], v[1], v[2], v[3], v[4], v[5]);
+        continue;
+      }
+
+      baseline_entry_t const* ref = baseline_find(baseline, baseline_count, key);
+      if ( !ref ) continue;
+
+      uint32_t const* v = (uint32_t const*) &res;
+      for ( uint32_t m = 0; m < METRIC_COUNT; m++ )
+      {
+        if ( v[m] > ref->values[m] )
+        {
+          printf("REGRESSION %s %s: %u > %u\n", key, _metric_names[m], v[m], ref->values[m]);
+          regressions++;
+        }
+        else if ( v[m] < ref->values[m] )
+        {
+          printf("improved   %s %s: %u < %u\n", key, _metric_names[m], v[m], ref->values[m]);
+        }
+      }
+    }
+  }
+
+  if ( out )
+  {
+    fclose(out);
+    printf("baseline updated: %s\n", baseline_path);
+    return regressions ? 1 : 0;
+  }
+
+  printf("%u regressions against %s\n", regressions, baseline_path);
+  return regressions ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+
+# The MIT License (MIT)
+#
+# Copyright (c) 2026 Adafruit Industries
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""Decode the binary trace written by the bootloader to RTT up channel 1 (src/trace.h).
+
+  tracedecode.py _build/build-board/board_bootloader.elf trace.bin
+  tracedecode.py board_bootloader.elf trace.bin --cpu-mhz 64
+
+trace.bin is a raw capture of the channel, e.g from JLinkRTTLogger -RTTChannel 1. Format
+strings are not in the firmware image, they are read back from the .trace_fmt section of
+the elf built together with the running bootloader.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+TRACE_ID_DROPPED = 0xFFFFFF
+
+
+def load_formats(elf_path):
+    """Return {offset: format string} from the .trace_fmt section of an ELF32 little endian file."""
+    with open(elf_path, 'rb') as f:
+        elf = f.read()
+
+    if elf[:4] != b'\x7fELF' or elf[4] != 1 or elf[5] != 1:
+        sys.exit('{}: not a 32-bit little endian elf'.format(elf_path))
+
+    shoff, = struct.unpack_from('<I', elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from('<HHH', elf, 0x2E)
+
+    def section(i):
+        name, _type, _flags, addr, offset, size = struct.unpack_from('<IIIIII', elf, shoff + i * shentsize)
+        return name, addr, offset, size
+
+    _, _, strtab_off, _ = section(shstrndx)
+
+    for i in range(shnum):
+        name, addr, offset, size = section(i)
+        end = elf.index(b'\0', strtab_off + name)
+        if elf[strtab_off + name:end] != b'.trace_fmt':
+            continue
+
+        formats = {}
+        data = elf[offset:offset + size]
+        pos = 0
+        while pos < len(data):
+            end = data.find(b'\0', pos)
+            if end < 0:
+                end = len(data)
+            if end > pos:
+                formats[addr + pos] = data[pos:end].decode('ascii', 'replace')
+            pos = end + 1
+        return formats
+
+    sys.exit('{}: no .trace_fmt section, build with TRACE=1'.format(elf_path))
+
+
+# C conversion -> python: drop length modifiers, everything else is passed as an integer
+_conv = re.compile(r'%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|j|t)?([diouxXcp%])')
+
+
+def c_format(fmt, args):
+    it = iter(args)
+
+    def conv(m):
+        flags, spec = m.group(1), m.group(2)
+        if spec == '%':
+            return '%'
+        val = next(it, 0)
+        if spec in 'di':
+            val = struct.unpack('<i', struct.pack('<I', val))[0]
+            spec = 'd'
+        elif spec == 'u':
+            spec = 'd'
+        elif spec == 'p':
+            return '0x%08x' % val
+        return ('%' + flags + spec) % val
+
+    return _conv.sub(conv, fmt)
+
+
+def decode(stream, formats, cpu_hz):
+    """Yield (seconds, text) for each record in the captured byte stream."""
+    pos = 0
+    wraps = 0
+    last = None
+
+    while pos + 8 <= len(stream):
+        hdr, cycles = struct.unpack_from('<II', stream, pos)
+        fid, nargs = hdr & 0xFFFFFF, hdr >> 24
+        if nargs > 4 or pos + 8 + nargs * 4 > len(stream):
+            # not a record boundary (capture started mid record or is truncated): resync word by word
+            pos += 4
+            continue
+
+        args = struct.unpack_from('<%dI' % nargs, stream, pos + 8)
+        pos += 8 + nargs * 4
+
+        # CYCCNT is 32-bit, wraps every ~67 s at 64 MHz
+        if last is not None and cycles < last:
+            wraps += 1
+        last = cycles
+        t = (wraps * (1 << 32) + cycles) / cpu_hz
+
+        if fid == TRACE_ID_DROPPED:
+            yield t, '*** {} record(s) dropped ***'.format(args[0] if args else '?')
+        elif fid in formats:
+            yield t, c_format(formats[fid], args)
+        else:
+            yield t, '<unknown id 0x{:06x}> {}'.format(fid, ' '.join('0x%08x' % a for a in args))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('elf', help='bootloader elf matching the running firmware')
+    parser.add_argument('trace', help='raw capture of RTT up channel 1')
+    parser.add_argument('--cpu-mhz', type=float, default=64, help='core clock for timestamps (default 64)')
+    args = parser.parse_args()
+
+    formats = load_formats(args.elf)
+    with open(args.trace, 'rb') as f:
+        stream = f.read()
+
+    prev = None
+    for t, text in decode(stream, formats, args.cpu_mhz * 1e6):
+        delta = 0 if prev is None else t - prev
+        prev = t
+        print('{:12.6f} (+{:9.6f}) {}'.format(t, delta, text))
+
+
+if __name__ == '__main__':
+    main()
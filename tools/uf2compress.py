@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+
+# The MIT License (MIT)
+#
+# Copyright (c) 2026 Adafruit Industries
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""Compress firmware for the bootloader's streaming decoder (src/decompress.c).
+
+  uf2compress.py app.uf2 -o app.z.uf2   compress application blocks of an uf2 file
+  uf2compress.py --bin app.bin -o app.z  compress a raw image for serial/OTA DFU,
+                                         package it with DFU_INIT_FLAG_COMPRESSED set
+"""
+
+import argparse
+import struct
+
+WINDOW_BITS = 8     # must match DECOMPRESS_WINDOW_BITS
+LOOKAHEAD_BITS = 4  # must match DECOMPRESS_LOOKAHEAD_BITS
+
+UF2_MAGIC_START0 = 0x0A324655
+UF2_MAGIC_START1 = 0x9E5D5157
+UF2_MAGIC_END = 0x0AB16F30
+UF2_FLAG_NOFLASH = 0x00000001
+UF2_FLAG_FAMILYID = 0x00002000
+UF2_FLAG_COMPRESSED = 0x00100000
+UF2_BOOT_FAMILY_ID = 0xd663823c
+UF2_DATA_SIZE = 476
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.cur = 0
+        self.count = 0
+
+    def put(self, value, bits):
+        for i in reversed(range(bits)):
+            self.cur = (self.cur << 1) | ((value >> i) & 1)
+            self.count += 1
+            if self.count == 8:
+                self.out.append(self.cur)
+                self.cur = 0
+                self.count = 0
+
+    def finish(self):
+        if self.count:
+            self.out.append(self.cur << (8 - self.count))
+        return bytes(self.out)
+
+
+def compress(data):
+    """Greedy LZSS with heatshrink bit layout"""
+    data = bytes(data)
+    window = 1 << WINDOW_BITS
+    max_len = 1 << LOOKAHEAD_BITS
+    # back reference costs 1 + W + L bits, only worth it when longer than a literal
+    min_len = (1 + WINDOW_BITS + LOOKAHEAD_BITS) // 9 + 1
+    bw = BitWriter()
+    chains = {}
+    pos = 0
+
+    while pos < len(data):
+        best_len, best_off = 0, 0
+        for cand in reversed(chains.get(data[pos:pos + 2], [])):
+            off = pos - cand
+            if off > window:
+                break
+            n = 0
+            while n < max_len and pos + n < len(data) and data[pos + n] == data[pos + n - off]:
+                n += 1
+            if n > best_len:
+                best_len, best_off = n, off
+                if n == max_len:
+                    break
+
+        step = best_len if best_len >= min_len else 1
+        if step > 1:
+            bw.put(0, 1)
+            bw.put(best_off - 1, WINDOW_BITS)
+            bw.put(best_len - 1, LOOKAHEAD_BITS)
+        else:
+            bw.put(1, 1)
+            bw.put(data[pos], 8)
+
+        for i in range(pos, pos + step):
+            chains.setdefault(data[i:i + 2], []).append(i)
+        pos += step
+
+    return bw.finish()
+
+
+def read_uf2(buf):
+    blocks = []
+    for ptr in range(0, len(buf), 512):
+        hd = struct.unpack("<8I", buf[ptr:ptr + 32])
+        if hd[0] != UF2_MAGIC_START0 or hd[1] != UF2_MAGIC_START1:
+            continue
+        flags, addr, size, family = hd[2], hd[3], hd[4], hd[7]
+        blocks.append((flags, addr, family, buf[ptr + 32:ptr + 32 + size]))
+    return blocks
+
+
+def keep_raw(flags, family):
+    # bootloader blocks are parsed by the bootloader, NOFLASH blocks carry e.g. the signature
+    return family == UF2_BOOT_FAMILY_ID or flags & UF2_FLAG_NOFLASH
+
+
+def compress_uf2(buf):
+    # group consecutive payloads into runs, raw blocks are kept as-is
+    runs = []
+    for flags, addr, family, data in read_uf2(buf):
+        last = runs[-1] if runs else None
+        if (not keep_raw(flags, family) and last and last[0] == flags and last[2] == family
+                and last[1] + len(last[3]) == addr):
+            last[3] += data
+        else:
+            runs.append([flags, addr, family, bytearray(data)])
+
+    out = []
+    for flags, addr, family, data in runs:
+        pos = 0
+        while pos < len(data):
+            if keep_raw(flags, family):
+                out.append((flags, addr + pos, family, bytes(data[pos:pos + 256])))
+                pos += 256
+                continue
+
+            # grow the chunk 256 bytes at a time while it still fits in one block
+            n = min(256, len(data) - pos)
+            stream = compress(data[pos:pos + n])
+            while pos + n < len(data):
+                nxt = compress(data[pos:pos + n + 256])
+                if len(nxt) + 4 > UF2_DATA_SIZE:
+                    break
+                n, stream = min(n + 256, len(data) - pos), nxt
+
+            if len(stream) + 4 > UF2_DATA_SIZE:
+                n = min(256, len(data) - pos)
+                out.append((flags, addr + pos, family, bytes(data[pos:pos + n])))
+            else:
+                payload = struct.pack("<I", n) + stream
+                out.append((flags | UF2_FLAG_COMPRESSED, addr + pos, family, payload))
+            pos += n
+
+    result = bytearray()
+    for i, (flags, addr, family, payload) in enumerate(out):
+        hd = struct.pack("<8I", UF2_MAGIC_START0, UF2_MAGIC_START1, flags | UF2_FLAG_FAMILYID,
+                         addr, len(payload), i, len(out), family)
+        block = hd + payload + bytes(UF2_DATA_SIZE - len(payload)) + struct.pack("<I", UF2_MAGIC_END)
+        result += block
+    return bytes(result)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input")
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("--bin", action="store_true", help="input is a raw binary image")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        buf = f.read()
+
+    if args.bin:
+        out = compress(buf)
+        # transports only accept word sized packets, decoder stops at the image size from start packet
+        out += bytes(-len(out) % 4)
+    else:
+        out = compress_uf2(buf)
+
+    with open(args.output, "wb") as f:
+        f.write(out)
+
+    print("{}: {} -> {} bytes ({:.0f}%)".format(args.output, len(buf), len(out), 100.0 * len(out) / len(buf)))
+
+
+if __name__ == "__main__":
+    main()